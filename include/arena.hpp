@@ -0,0 +1,47 @@
+#pragma once
+
+#include <type_traits>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include <memory>
+
+/* Bump allocator that owns every node of a parsed program.
+Nodes are carved out of large blocks and handed out as raw
+pointers, which stay valid until the arena is reset or
+destroyed, at which point the whole tree is freed at once */
+class Arena {
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t used;
+    };
+
+    // Nodes own strings and vectors, so their destructors still have to run
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<Block> blocks;
+    std::vector<Destructor> destructors;
+    size_t block_size;
+
+    void* allocate(size_t size, size_t alignment);
+public:
+    explicit Arena(size_t block_size = 64 * 1024);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            destructors.push_back({object, [](void* object) { static_cast<T*>(object)->~T(); }});
+        return object;
+    }
+
+    void reset();
+    size_t bytes_used();
+};
\ No newline at end of file
@@ -10,7 +10,7 @@
 #include "common.hpp"
 #include "token.hpp"
 
-struct AST : ExpressionVisitor<std::any> {
+struct AST : ExpressionVisitor<std::any>, StatementVisitor {
     /* Nodes are an Expression or a Statement,
     and hold a vector of subsequent Node refs */
     struct Node {
@@ -21,22 +21,42 @@ struct AST : ExpressionVisitor<std::any> {
         Node(std::variant<const Expression*, const Statement*> type);
     };
 
+    // Statements print one per line, indented by how deeply they're nested
+    std::string printed;
+    int depth = 0;
+
     AST() = default;
     
-    std::string print(ShrExprPtr expression);
+    std::string print(ExprPtr expression);
+    std::string print(StmtPtr statement);
+    void print_line(std::string_view text);
     template<class... E>
-    std::string parenthesize(std::string label, E... expressions);
+    std::string parenthesize(std::string_view label, E... expressions);
     static void test();
 
-    std::any visit_unary_expression(ShrUnaryExprPtr expression);
-    std::any visit_binary_expression(ShrBinaryExprPtr expression);
-    std::any visit_ternary_expression(ShrTernaryExprPtr expression);
-    std::any visit_literal_expression(ShrLiteralExprPtr expression);
-    std::any visit_group_expression(ShrGroupExprPtr expression);
-    std::any visit_assign_expression(ShrAssignExprPtr expression);
-    std::any visit_range_expression(ShrRangeExprPtr expression);
-    std::any visit_access_expression(ShrAccessExprPtr expression);
-    std::any visit_call_expression(ShrCallExprPtr expression);
-    std::any visit_logical_expression(ShrLogicalExprPtr expression);
-    std::any visit_bitwise_expression(ShrBitwiseExprPtr expression);
+    std::any visit_unary_expression(const UnaryExpression& expression);
+    std::any visit_binary_expression(const BinaryExpression& expression);
+    std::any visit_ternary_expression(const TernaryExpression& expression);
+    std::any visit_literal_expression(const LiteralExpression& expression);
+    std::any visit_group_expression(const GroupExpression& expression);
+    std::any visit_variable_expression(const VariableExpression& expression);
+    std::any visit_assign_expression(const AssignExpression& expression);
+    std::any visit_range_expression(const RangeExpression& expression);
+    std::any visit_access_expression(const AccessExpression& expression);
+    std::any visit_call_expression(const CallExpression& expression);
+    std::any visit_logical_expression(const LogicalExpression& expression);
+    std::any visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <map>
+
+#include "value.hpp"
+
+enum OpCode : uint8_t {
+    // Values
+    OP_CONSTANT, OP_VOID, OP_POP,
+    // Variables
+    OP_DEFINE_GLOBAL, OP_GET_GLOBAL, OP_SET_GLOBAL,
+    OP_GET_LOCAL, OP_SET_LOCAL,
+    OP_CHECK_TYPE,
+    // Math Operators
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW, OP_MOD,
+    OP_NEG, OP_INC, OP_DEC,
+    // Logical Operators
+    OP_LESS, OP_GREATER, OP_LESS_EQ, OP_GREATER_EQ,
+    OP_NOT_EQ, OP_EQ, OP_L_OR, OP_L_AND, OP_L_XOR, OP_L_NOT,
+    // Bitwise Operators
+    OP_B_OR, OP_B_AND, OP_B_XOR, OP_B_NOT,
+    OP_LSHFT, OP_RSHFT, OP_CHK,
+    // Integer Operators, for operands the Typechecker proved are both i64
+    OP_ADD_INT, OP_SUB_INT, OP_MUL_INT,
+    OP_LESS_INT, OP_GREATER_INT, OP_LESS_EQ_INT, OP_GREATER_EQ_INT,
+    OP_NOT_EQ_INT, OP_EQ_INT,
+    // Control Flow
+    OP_JUMP, OP_JUMP_IF_FALSE, OP_LOOP,
+    // Built-in Functions
+    OP_PRINT, OP_TYPEOF,
+    OP_RETURN
+};
+
+// The integer operator for op, or op itself if it has none
+OpCode int_opcode(OpCode op);
+
+/* A compiled program: a flat instruction stream with 16-bit
+operands, a constant pool, and the names of the global slots
+(for error messages) */
+struct Chunk {
+    std::vector<uint8_t> code;
+    std::vector<Value> constants;
+    std::vector<std::string> global_names;
+    // The index of each value in the pool, keyed by Value::key()
+    std::map<std::string, uint32_t> constant_indices;
+
+    void write(uint8_t byte);
+    void write_short(uint16_t operand);
+    uint16_t read_short(size_t offset) const;
+    // Equal values share one index, which the caller checks fits in an operand
+    uint32_t add_constant(const Value& value);
+};
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+#include <stdint.h>
+#include <string>
+
+#include "bytecode.hpp"
+
+/* On-disk cache of a compiled program (.tdac), written by "tilda compile"
+and loaded instead of scanning, parsing and compiling the source again.
+A cache is only used if it was built from the exact same source by the
+same format version, which the header's hash covers. Files are written in
+native byte order, so they aren't meant to be moved between machines */
+struct Cache {
+    // Bump whenever the opcodes or the Compiler's output change
+    static constexpr uint32_t version = 4;
+
+    // FNV-1a over version and src
+    static uint64_t hash(std::string_view src);
+    // foo.tda -> foo.tdac
+    static std::string path_for(const std::string& source_path);
+    static bool save(const std::string& path, uint64_t hash, const Chunk& chunk);
+    // False (and chunk untouched) if path is missing, stale or malformed
+    static bool load(const std::string& path, uint64_t hash, Chunk& chunk);
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+#include <any>
+#include <map>
+
+#include "interpreter.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "value.hpp"
+#include "token.hpp"
+
+/* Compiles the AST into a tree of closures, for --engine=closure. Each
+node is compiled once into a callable bound to its operands' closures,
+its variable's slot and, where the Typechecker proved the operand types,
+the operator for them, so running it is a chain of indirect calls, with
+no accept() double dispatch or switch over the operand types. It runs on
+an Interpreter's state (scopes, call depth, the return flag, and the passes
+a function's body goes through on its first call), so it behaves the same */
+class ClosureCompiler : ExpressionVisitor<std::any>, StatementVisitor {
+public:
+    typedef std::function<Value()> Eval;
+    typedef std::function<void()> Exec;
+    // A condition, already reduced to its truthiness
+    typedef std::function<bool()> Test;
+private:
+    // Compiled on the function's first call, and shared by every call site
+    struct Body {
+        bool is_compiled = false;
+        std::vector<Exec> statements;
+    };
+
+    Interpreter& interpreter;
+    std::map<const FunctionStatement*, std::unique_ptr<Body>> bodies;
+    // Statement visitors can't return, so the statement just compiled is left here
+    Exec compiled;
+
+    Eval compile(ExprPtr expression);
+    Exec compile(StmtPtr statement);
+    std::vector<Exec> compile(std::span<const StmtPtr> statements);
+    Test compile_condition(ExprPtr expression);
+    std::any visit_unary_expression(const UnaryExpression& expression);
+    std::any visit_binary_expression(const BinaryExpression& expression);
+    std::any visit_ternary_expression(const TernaryExpression& expression);
+    std::any visit_literal_expression(const LiteralExpression& expression);
+    std::any visit_group_expression(const GroupExpression& expression);
+    std::any visit_variable_expression(const VariableExpression& expression);
+    std::any visit_assign_expression(const AssignExpression& expression);
+    std::any visit_range_expression(const RangeExpression& expression);
+    std::any visit_access_expression(const AccessExpression& expression);
+    std::any visit_call_expression(const CallExpression& expression);
+    std::any visit_logical_expression(const LogicalExpression& expression);
+    std::any visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
+public:
+    ClosureCompiler(Interpreter& interpreter);
+    // Compiles statements and runs them, persisting globals and functions across calls (i.e. REPL lines)
+    void run(std::span<const StmtPtr> statements);
+};
\ No newline at end of file
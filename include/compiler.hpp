@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <string>
+#include <any>
+#include <map>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "bytecode.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+// Lowers parsed statements into a Chunk for the VM
+class Compiler : ExpressionVisitor<std::any>, StatementVisitor {
+    struct Local {
+        std::string_view identifier;
+        int depth;
+    };
+
+    Chunk chunk;
+    std::vector<Local> locals;
+    int scope_depth = 0;
+    // Globals are resolved to slots, and persist across compilations (i.e. REPL lines)
+    std::map<std::string, uint16_t, std::less<>> global_slots;
+    std::vector<std::string> global_names;
+
+    void compile(ExprPtr expression);
+    void compile(StmtPtr statement);
+    void emit(uint8_t byte);
+    void emit(OpCode op, uint16_t operand);
+    void emit_constant(Value value);
+    size_t emit_jump(OpCode op);
+    void patch_jump(size_t offset);
+    void emit_loop(size_t loop_start);
+    void begin_scope();
+    void end_scope();
+    int resolve_local(std::string_view identifier);
+    uint16_t resolve_global(std::string_view identifier);
+    void throw_error(std::string message);
+    std::any visit_unary_expression(const UnaryExpression& expression);
+    std::any visit_binary_expression(const BinaryExpression& expression);
+    std::any visit_ternary_expression(const TernaryExpression& expression);
+    std::any visit_literal_expression(const LiteralExpression& expression);
+    std::any visit_group_expression(const GroupExpression& expression);
+    std::any visit_variable_expression(const VariableExpression& expression);
+    std::any visit_assign_expression(const AssignExpression& expression);
+    std::any visit_range_expression(const RangeExpression& expression);
+    std::any visit_access_expression(const AccessExpression& expression);
+    std::any visit_call_expression(const CallExpression& expression);
+    std::any visit_logical_expression(const LogicalExpression& expression);
+    std::any visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
+public:
+    Compiler() = default;
+    Chunk compile(std::span<const StmtPtr> statements);
+};
\ No newline at end of file
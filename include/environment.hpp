@@ -1,18 +1,36 @@
 #pragma once
 
-#include <memory>
-#include <string>
-#include <any>
-#include <map>
+#include <stdint.h>
+#include <vector>
 
-class Environment : std::enable_shared_from_this<Environment> {
-    std::shared_ptr<Environment> enclosing;
-    std::map<std::string, std::any> values;
-    void throw_error(std::string message);
+#include "value.hpp"
+
+/* Every scope's variables live in one contiguous value stack.
+A scope is just the index its slots start at, so entering and
+leaving a block only moves the top of the stack, and once the
+stack has grown to fit the deepest scope nothing is allocated.
+Variables are found by the (depth, slot) the Resolver gave them,
+where a depth of -1 means the global scope */
+class Environment {
+    std::vector<Value> values;
+    // Start of every open scope in values, innermost last
+    std::vector<size_t> scopes = {0};
+    // Number of global slots defined so far
+    size_t globals = 0;
+    size_t index(int depth, int slot);
 public:
-    Environment();
-    Environment(std::shared_ptr<Environment> enclosing);
-    void define(std::string identifier, std::any value);
-    void assign(std::string identifier, std::any value);
-    std::any get(std::string identifier);
+    // Number of times the value or scope stacks had to grow
+    size_t allocations = 0;
+
+    Environment() = default;
+    // The last arguments values pushed become the new scope's first slots
+    void push_scope(size_t arguments = 0);
+    void push(Value value);
+    void pop_scope();
+    void reset();
+    void define(int slot, Value value);
+    void assign(int depth, int slot, Value value);
+    Value get(int depth, int slot);
+    // A function can run before a global it uses has been declared
+    bool is_defined(int depth, int slot);
 };
\ No newline at end of file
@@ -2,12 +2,12 @@
 
 #include <iostream>
 #include <optional>
-#include <memory>
 #include <vector>
 #include <any>
 
 #include "common.hpp"
 #include "token.hpp"
+#include "value.hpp"
 
 struct Expression;
 struct UnaryExpression;
@@ -22,143 +22,185 @@ struct AccessExpression;
 struct CallExpression;
 struct LogicalExpression;
 struct BitwiseExpression;
-
-typedef std::shared_ptr<Expression> ShrExprPtr;
-typedef std::shared_ptr<UnaryExpression> ShrUnaryExprPtr;
-typedef std::shared_ptr<BinaryExpression> ShrBinaryExprPtr;
-typedef std::shared_ptr<TernaryExpression> ShrTernaryExprPtr;
-typedef std::shared_ptr<LiteralExpression> ShrLiteralExprPtr;
-typedef std::shared_ptr<GroupExpression> ShrGroupExprPtr;
-typedef std::shared_ptr<VariableExpression> ShrVariableExprPtr;
-typedef std::shared_ptr<AssignExpression> ShrAssignExprPtr;
-typedef std::shared_ptr<RangeExpression> ShrRangeExprPtr;
-typedef std::shared_ptr<AccessExpression> ShrAccessExprPtr;
-typedef std::shared_ptr<CallExpression> ShrCallExprPtr;
-typedef std::shared_ptr<LogicalExpression> ShrLogicalExprPtr;
-typedef std::shared_ptr<BitwiseExpression> ShrBitwiseExprPtr;
+struct FunctionStatement;
+
+typedef Expression* ExprPtr;
+
+// Same signatures as Interpreter::apply_unary and apply_binary
+typedef Value (*UnaryHandler)(TokenType type, const Value& operand);
+typedef Value (*BinaryHandler)(TokenType type, const Value& l_operand, const Value& r_operand);
+
+enum class Quickened : uint8_t { UNSEEN, SPECIALIZED, GENERIC, STATIC };
+
+/* The first time the Interpreter runs an operator node, it rewrites it
+into a handler specialized for the operand types it saw (i.e. i64 + i64),
+guarded by a check of those types. When the guard fails, the node goes
+back to the generic operator for good, so it can't flip back and forth.
+When the Typechecker already proved the operand types, the node is
+STATIC instead, and the handler runs without the guard */
+template<typename Handler>
+struct Quickening {
+    Quickened state = Quickened::UNSEEN;
+    LiteralType l_type = LiteralType::VOID;
+    LiteralType r_type = LiteralType::VOID;
+    Handler handler = nullptr;
+};
 
 template<typename T>
 struct ExpressionVisitor {
-    virtual T visit_unary_expression(ShrUnaryExprPtr expression) = 0;
-    virtual T visit_binary_expression(ShrBinaryExprPtr expression) = 0;
-    virtual T visit_ternary_expression(ShrTernaryExprPtr expression) = 0;
-    virtual T visit_literal_expression(ShrLiteralExprPtr expression) = 0;
-    virtual T visit_group_expression(ShrGroupExprPtr expression) = 0;
-    virtual T visit_variable_expression(ShrVariableExprPtr expression) = 0;
-    virtual T visit_assign_expression(ShrAssignExprPtr expression) = 0;
-    virtual T visit_range_expression(ShrRangeExprPtr expression) = 0;
-    virtual T visit_access_expression(ShrAccessExprPtr expression) = 0;
-    virtual T visit_call_expression(ShrCallExprPtr expression) = 0;
-    virtual T visit_logical_expression(ShrLogicalExprPtr expression) = 0;
-    virtual T visit_bitwise_expression(ShrBitwiseExprPtr expression) = 0;
+    virtual T visit_unary_expression(const UnaryExpression& expression) = 0;
+    virtual T visit_binary_expression(const BinaryExpression& expression) = 0;
+    virtual T visit_ternary_expression(const TernaryExpression& expression) = 0;
+    virtual T visit_literal_expression(const LiteralExpression& expression) = 0;
+    virtual T visit_group_expression(const GroupExpression& expression) = 0;
+    virtual T visit_variable_expression(const VariableExpression& expression) = 0;
+    virtual T visit_assign_expression(const AssignExpression& expression) = 0;
+    virtual T visit_range_expression(const RangeExpression& expression) = 0;
+    virtual T visit_access_expression(const AccessExpression& expression) = 0;
+    virtual T visit_call_expression(const CallExpression& expression) = 0;
+    virtual T visit_logical_expression(const LogicalExpression& expression) = 0;
+    virtual T visit_bitwise_expression(const BitwiseExpression& expression) = 0;
     virtual ~ExpressionVisitor() = default;
 };
 
 struct Expression {
-    virtual std::any accept(ExpressionVisitor<std::any>& expression_visitor) = 0;
+    // Set by the Typechecker, VOID when the type is only known at runtime
+    mutable LiteralType static_type = LiteralType::VOID;
+    virtual std::any accept(ExpressionVisitor<std::any>& expression_visitor) const = 0;
+    virtual Value accept(ExpressionVisitor<Value>& expression_visitor) const = 0;
     virtual ~Expression() = default;
 };
 
-struct UnaryExpression : Expression, public std::enable_shared_from_this<UnaryExpression> {
+struct UnaryExpression : Expression {
     TokenType type;
-    ShrExprPtr operand;
+    ExprPtr operand;
     bool postfix;
+    // Set by the Interpreter
+    mutable Quickening<UnaryHandler> quickening;
 
-    UnaryExpression(TokenType type, ShrExprPtr operand, bool postfix);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    UnaryExpression(TokenType type, ExprPtr operand, bool postfix);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct BinaryExpression : Expression, public std::enable_shared_from_this<BinaryExpression> {
+struct BinaryExpression : Expression {
     TokenType type;
-    ShrExprPtr l_operand;
-    ShrExprPtr r_operand;
-
-    BinaryExpression(TokenType type, ShrExprPtr l_operand, ShrExprPtr r_operand);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    ExprPtr l_operand;
+    ExprPtr r_operand;
+    // Set by the Interpreter
+    mutable Quickening<BinaryHandler> quickening;
+
+    BinaryExpression(TokenType type, ExprPtr l_operand, ExprPtr r_operand);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct TernaryExpression : Expression, public std::enable_shared_from_this<TernaryExpression> {
+struct TernaryExpression : Expression {
     TokenType type;
-    ShrExprPtr condition;
-    ShrExprPtr l_operand;
-    ShrExprPtr r_operand;
+    ExprPtr condition;
+    ExprPtr l_operand;
+    ExprPtr r_operand;
 
-    TernaryExpression(TokenType type, ShrExprPtr condition, ShrExprPtr l_operand, ShrExprPtr r_operand);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    TernaryExpression(TokenType type, ExprPtr condition, ExprPtr l_operand, ExprPtr r_operand);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct LiteralExpression : Expression, public std::enable_shared_from_this<LiteralExpression> {
+struct LiteralExpression : Expression {
     TokenType type;
-    std::any value;
+    Value value;
 
-    LiteralExpression(TokenType type, std::any value);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    LiteralExpression(TokenType type, Value value);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct GroupExpression : Expression, public std::enable_shared_from_this<GroupExpression> {
-    ShrExprPtr expression;
+struct GroupExpression : Expression {
+    ExprPtr expression;
 
-    GroupExpression(ShrExprPtr expression);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    GroupExpression(ExprPtr expression);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct VariableExpression : Expression, public std::enable_shared_from_this<VariableExpression> {
+struct VariableExpression : Expression {
     Token identifier;
+    // Set by the Resolver
+    mutable int depth = -1;
+    mutable int slot = -1;
 
     VariableExpression(Token identifier);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct AssignExpression : Expression, public std::enable_shared_from_this<AssignExpression> {
+struct AssignExpression : Expression {
     Token identifier;
-    ShrExprPtr expression;
-
-    AssignExpression(Token identifier, ShrExprPtr expression);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    ExprPtr expression;
+    // Set by the Resolver
+    mutable int depth = -1;
+    mutable int slot = -1;
+    // Set by the Typechecker when the value has to be checked against the variable's type at runtime
+    mutable LiteralType checked_type = LiteralType::VOID;
+
+    AssignExpression(Token identifier, ExprPtr expression);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct RangeExpression : Expression, public std::enable_shared_from_this<RangeExpression> {
-    ShrExprPtr l_operand;
-    ShrExprPtr r_operand;
+struct RangeExpression : Expression {
+    ExprPtr l_operand;
+    ExprPtr r_operand;
 
-    RangeExpression(ShrExprPtr l_operand, ShrExprPtr r_operand);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    RangeExpression(ExprPtr l_operand, ExprPtr r_operand);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct AccessExpression : Expression, public std::enable_shared_from_this<AccessExpression> {
-    ShrExprPtr l_operand;
-    ShrExprPtr r_operand;
+struct AccessExpression : Expression {
+    ExprPtr l_operand;
+    ExprPtr r_operand;
 
-    AccessExpression(ShrExprPtr l_operand, ShrExprPtr r_operand);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    AccessExpression(ExprPtr l_operand, ExprPtr r_operand);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct CallExpression : Expression, public std::enable_shared_from_this<CallExpression> {
-    /* this would have to be an ShrExprPtr if
+struct CallExpression : Expression {
+    /* this would have to be an ExprPtr if
     function pointers were added to the language */
     Token function_name;
-    std::vector<ShrExprPtr> arguments;
+    std::vector<ExprPtr> arguments;
+    // Set by the Resolver
+    mutable const FunctionStatement* function = nullptr;
 
-    CallExpression(Token function_name, std::vector<ShrExprPtr> arguments);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    CallExpression(Token function_name, std::vector<ExprPtr> arguments);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct LogicalExpression : Expression, public std::enable_shared_from_this<LogicalExpression> {
+struct LogicalExpression : Expression {
     TokenType type;
-    ShrExprPtr l_operand;
+    ExprPtr l_operand;
     // r_operand is optional for LogicalExpressions
-    ShrExprPtr r_operand;
+    ExprPtr r_operand;
+    // Set by the Interpreter
+    mutable Quickening<BinaryHandler> quickening;
 
-    LogicalExpression(TokenType type, ShrExprPtr l_operand, ShrExprPtr r_operand);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    LogicalExpression(TokenType type, ExprPtr l_operand, ExprPtr r_operand);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
 
-struct BitwiseExpression : Expression, public std::enable_shared_from_this<BitwiseExpression> {
+struct BitwiseExpression : Expression {
     TokenType type;
-    ShrExprPtr l_operand;
+    ExprPtr l_operand;
     // r_operand is optional for BitwiseExpressions
-    ShrExprPtr r_operand;
+    ExprPtr r_operand;
+    // Set by the Interpreter
+    mutable Quickening<BinaryHandler> quickening;
 
-    BitwiseExpression(TokenType type, ShrExprPtr l_operand, ShrExprPtr r_operand);
-    std::any accept(ExpressionVisitor<std::any>& expression_visitor) override;
+    BitwiseExpression(TokenType type, ExprPtr l_operand, ExprPtr r_operand);
+    std::any accept(ExpressionVisitor<std::any>& expression_visitor) const override;
+    Value accept(ExpressionVisitor<Value>& expression_visitor) const override;
 };
\ No newline at end of file
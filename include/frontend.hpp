@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string_view>
+#include <sstream>
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "scanner.hpp"
+#include "parser.hpp"
+#include "arena.hpp"
+
+/* Scans and parses a whole file. With more than one job, the source is
+first split between top-level statements, and the sections are scanned
+and parsed on a pool of threads, each with its own Scanner, Parser and
+Arena. The result (diagnostics included) is the same as one sequential
+parse. The sections own the tokens and AST, so a FrontEnd has to outlive
+the statements parse() returns */
+class FrontEnd {
+    struct Section {
+        std::string_view src;
+        int first_line;
+        std::unique_ptr<Scanner> scanner;
+        Arena arena;
+        std::unique_ptr<Parser> parser;
+        // Warnings, printed in order once every section is done
+        std::ostringstream out;
+        std::vector<StmtPtr> statements;
+        std::string scan_error;
+        std::string parse_error;
+    };
+
+    std::vector<std::unique_ptr<Section>> sections;
+
+    static void parse_section(Section& section);
+public:
+    // Splits src into at most count sections, at newlines outside of any brackets
+    static std::vector<std::string_view> split(std::string_view src, size_t count);
+    std::vector<StmtPtr> parse(std::string_view src, int jobs);
+    size_t tokens();
+    size_t token_bytes();
+    size_t arena_bytes();
+};
\ No newline at end of file
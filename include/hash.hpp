@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string_view>
+#include <stdint.h>
+#include <utility>
+#include <array>
+#include <bit>
+
+/* Perfect hash over a fixed set of words, built entirely at
+compile time. The constructor searches for a multiplier that
+sends every word to its own slot, so a lookup is one hash
+and one string compare, and nothing is built at startup.
+Words are keyed on their first two characters, last character
+and length, so no two words may share all four */
+template<typename T, size_t N>
+class PerfectHash {
+public:
+    struct Entry {
+        std::string_view word;
+        T value;
+    };
+private:
+    static constexpr uint32_t BITS = std::bit_width(2 * N - 1);
+    static constexpr size_t SIZE = size_t(1) << BITS;
+    static constexpr uint8_t EMPTY = 0xFF;
+    static_assert(N < EMPTY, "Too many words for a PerfectHash");
+
+    std::array<Entry, N> entries;
+    std::array<uint8_t, SIZE> slots{};
+    uint32_t seed = 0;
+
+    static constexpr uint32_t key(std::string_view word) {
+        return static_cast<uint8_t>(word[0])
+            | static_cast<uint8_t>(word[word.size() > 1 ? 1 : 0]) << 8
+            | static_cast<uint8_t>(word.back()) << 16
+            | static_cast<uint32_t>(word.size()) << 24;
+    }
+
+    constexpr uint32_t slot(std::string_view word) const {
+        return static_cast<uint32_t>(key(word) * seed) >> (32 - BITS);
+    }
+public:
+    constexpr PerfectHash(std::array<Entry, N> entries) :
+        entries(entries) {
+        for (uint32_t attempt = 0; attempt < (1 << 16); attempt++) {
+            // Odd multipliers only, an even one throws away the key's low bit
+            seed = 0x9E3779B1u + 2 * attempt;
+            slots.fill(EMPTY);
+            bool is_perfect = true;
+            for (size_t i = 0; i < N && is_perfect; i++) {
+                uint8_t& entry = slots[slot(entries[i].word)];
+                if (entry != EMPTY)
+                    is_perfect = false;
+                entry = static_cast<uint8_t>(i);
+            }
+            if (is_perfect)
+                return;
+        }
+        // Not a constant expression, so a word set without a perfect hash fails to compile
+        throw "No perfect hash found for these words";
+    }
+
+    // The value for word, or fallback if it isn't one of the words
+    constexpr T find(std::string_view word, T fallback) const {
+        if (word.empty())
+            return fallback;
+        uint8_t entry = slots[slot(word)];
+        if (entry == EMPTY || entries[entry].word != word)
+            return fallback;
+        return entries[entry].value;
+    }
+};
\ No newline at end of file
@@ -1,52 +1,96 @@
 #pragma once
 
-#include <memory>
+#include <span>
 #include <vector>
 #include <string>
-#include <any>
 
 #include "environment.hpp"
 #include "expression.hpp"
 #include "statement.hpp"
+#include "value.hpp"
 #include "token.hpp"
 
-struct Interpreter : ExpressionVisitor<std::any>, StatementVisitor {
-    std::shared_ptr<Environment> environment = std::make_shared<Environment>(Environment());
-    std::any evaluate(ShrExprPtr expression);
-    void execute(ShrStmtPtr statement);
-    void execute_block(std::vector<ShrStmtPtr> statements, std::shared_ptr<Environment> environment);
-    std::string get_type(ShrExprPtr expression);
-    bool get_truthiness(std::any operand);
-    bool get_equality(std::any l_operand, std::any r_operand);
-    void throw_error(std::string message);
-    bool check_number_operand(TokenType type, std::any operand);
-    bool check_number_operands(TokenType type, std::any l_operand, std::any r_operand);
-    std::string to_string(std::any value);
-    std::any visit_unary_expression(ShrUnaryExprPtr expression);
-    std::any visit_binary_expression(ShrBinaryExprPtr expression);
-    std::any visit_ternary_expression(ShrTernaryExprPtr expression);
-    std::any visit_literal_expression(ShrLiteralExprPtr expression);
-    std::any visit_group_expression(ShrGroupExprPtr expression);
-    std::any visit_variable_expression(ShrVariableExprPtr expression);
-    std::any visit_assign_expression(ShrAssignExprPtr expression);
-    std::any visit_range_expression(ShrRangeExprPtr expression);
-    std::any visit_access_expression(ShrAccessExprPtr expression);
-    std::any visit_call_expression(ShrCallExprPtr expression);
-    std::any visit_logical_expression(ShrLogicalExprPtr expression);
-    std::any visit_bitwise_expression(ShrBitwiseExprPtr expression);
-    void visit_expression_statement(ShrExpressionStmtPtr statement);
-    void visit_print_statement(ShrPrintStmtPtr statement);
-    void visit_type_statement(ShrTypeStmtPtr statement);
-    void visit_block_statement(ShrBlockStmtPtr statement);
-    void visit_declare_statement(ShrDeclareStmtPtr statement);
-    void visit_if_statement(ShrIfStmtPtr statement);
-    void visit_while_statement(ShrWhileStmtPtr statement);
-    void visit_for_statement(ShrForStmtPtr statement);
-    void visit_forin_statement(ShrForInStmtPtr statement);
-    void visit_switch_statement(ShrSwitchStmtPtr statement);
-    void visit_return_statement(ShrReturnStmtPtr statement);
-    void visit_struct_statement(ShrStructStmtPtr statement);
+class Resolver;
+class Optimizer;
+class Typechecker;
+struct IRProgram;
+
+struct Interpreter : ExpressionVisitor<Value>, StatementVisitor {
+    // Deep enough for any sane recursion, shallow enough not to overflow the native stack
+    static constexpr int max_call_depth = 2048;
+
+    Environment environment;
+    // Resolves a function's body on its first call
+    Resolver* resolver = nullptr;
+    // And typechecks and optimizes it, when there's a Typechecker and an Optimizer
+    Typechecker* typechecker = nullptr;
+    Optimizer* optimizer = nullptr;
+    int call_depth = 0;
+    // Quickened operator nodes, for --stats
+    size_t specialized_sites = 0;
+    size_t deoptimized_sites = 0;
+    size_t static_sites = 0;
+    // Set by a return statement, and checked by everything that runs a list of statements
+    bool is_returning = false;
+    Value return_value;
+
+    Value evaluate(ExprPtr expression);
+    void execute(StmtPtr statement);
+    void execute_block(std::span<const StmtPtr> statements);
+    void prepare_body(const FunctionStatement& function);
+    static bool check_number_operand(TokenType type, const Value& operand);
+    static bool check_number_operands(TokenType type, const Value& l_operand, const Value& r_operand);
+    Value apply_quickened(Quickening<UnaryHandler>& quickening, bool is_static, TokenType type, const Value& operand);
+    Value apply_quickened(Quickening<BinaryHandler>& quickening, bool is_static, BinaryHandler apply,
+        BinaryHandler (*specialize)(TokenType, LiteralType, LiteralType), TokenType type, const Value& l_operand, const Value& r_operand);
+    Value visit_unary_expression(const UnaryExpression& expression);
+    Value visit_binary_expression(const BinaryExpression& expression);
+    Value visit_ternary_expression(const TernaryExpression& expression);
+    Value visit_literal_expression(const LiteralExpression& expression);
+    Value visit_group_expression(const GroupExpression& expression);
+    Value visit_variable_expression(const VariableExpression& expression);
+    Value visit_assign_expression(const AssignExpression& expression);
+    Value visit_range_expression(const RangeExpression& expression);
+    Value visit_access_expression(const AccessExpression& expression);
+    Value visit_call_expression(const CallExpression& expression);
+    Value visit_logical_expression(const LogicalExpression& expression);
+    Value visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
 public:
     Interpreter() = default;
-    void interpret(std::vector<ShrStmtPtr> statements);
+    void interpret(std::span<const StmtPtr> statements);
+    // Runs a program lowered (and optimized) by -O
+    void interpret(const IRProgram& program);
+    void set_resolver(Resolver* resolver);
+    void set_typechecker(Typechecker* typechecker);
+    void set_optimizer(Optimizer* optimizer);
+    size_t scope_allocations() { return environment.allocations; }
+    size_t specialized() { return specialized_sites; }
+    size_t deoptimized() { return deoptimized_sites; }
+    size_t statically_specialized() { return static_sites; }
+    // Value semantics, shared with the VM
+    static std::string get_type(const Value& value);
+    static bool get_truthiness(const Value& operand);
+    static bool get_equality(const Value& l_operand, const Value& r_operand);
+    static void throw_error(std::string message);
+    // For a value of a type only known at runtime, stored into a typed variable
+    static void check_type(LiteralType type, const Value& value);
+    static std::string to_string(const Value& value);
+    static Value apply_unary(TokenType type, const Value& operand);
+    static Value apply_binary(TokenType type, const Value& l_operand, const Value& r_operand);
+    static Value apply_fixed_width(TokenType type, const Value& l_operand, const Value& r_operand);
+    static Value apply_logical(TokenType type, const Value& l_operand, const Value& r_operand);
+    static Value apply_bitwise(TokenType type, const Value& l_operand, const Value& r_operand);
 };
\ No newline at end of file
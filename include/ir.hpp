@@ -0,0 +1,165 @@
+#pragma once
+
+#include <unordered_map>
+#include <stdint.h>
+#include <optional>
+#include <string>
+#include <vector>
+#include <array>
+#include <span>
+#include <any>
+#include <map>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+struct IRProgram;
+
+/* Mid-level IR for -O: basic blocks of instructions in SSA form, where
+every instruction defines at most one value, named by its index. Only
+programs without functions are lowered to it, so every variable (global
+or not) becomes plain SSA values, and nothing but the program itself
+can ever see them */
+enum class IROp : uint8_t {
+    CONSTANT,
+    PHI,
+    UNARY, BINARY, LOGICAL, BITWISE,
+    PRINT, TYPEOF
+};
+
+struct IRInstruction {
+    IROp op;
+    // The operator of a UNARY, BINARY, LOGICAL or BITWISE
+    TokenType type = END_TOKEN;
+    // Possible types of the value, one bit per LiteralType, see IROptimizer::infer_types
+    uint16_t types = 0;
+    // Until types are inferred, anything but a constant or a phi may raise an error
+    bool may_throw = true;
+    bool is_dead = false;
+    // Constants don't belong to a block, they're loaded wherever they're used
+    uint32_t block = UINT32_MAX;
+    /* The operands of an operator, or the incoming values of a phi,
+    in the same order as its block's predecessors */
+    std::array<uint32_t, 2> operands = {UINT32_MAX, UINT32_MAX};
+    // Index into IRProgram::constants
+    uint32_t constant = UINT32_MAX;
+
+    int operand_count() const;
+    bool has_value() const { return op != IROp::PRINT && op != IROp::TYPEOF; }
+    bool has_effect() const { return !has_value() || may_throw; }
+};
+
+struct IRBlock {
+    enum Terminator : uint8_t { JUMP, BRANCH, RETURN };
+
+    Terminator terminator = RETURN;
+    uint32_t condition = UINT32_MAX;
+    // A JUMP's target, or a BRANCH's true and false targets
+    std::array<uint32_t, 2> targets = {UINT32_MAX, UINT32_MAX};
+    std::vector<uint32_t> predecessors;
+    std::vector<uint32_t> phis;
+    std::vector<uint32_t> instructions;
+    // Index in IRProgram::layout
+    uint32_t position = 0;
+};
+
+/* A lowered while loop. The preheader runs once before the loop, the
+header starts every iteration (and the condition), and the latch jumps
+back to the header. Every block of the loop sits between the header
+and the latch in the layout */
+struct IRLoop {
+    uint32_t preheader;
+    uint32_t header;
+    uint32_t latch;
+
+    bool contains(const IRProgram& program, uint32_t block) const;
+};
+
+/* Lowering only ever makes two kinds of edges into a block with phis:
+from a preheader or a latch into a loop header, and from the ends
+of both branches of an if into where they meet. Neither kind starts
+at a BRANCH, so phi copies always go at the end of a JUMP block */
+struct IRProgram {
+    static constexpr uint32_t none = UINT32_MAX;
+
+    std::vector<IRInstruction> instructions;
+    std::vector<IRBlock> blocks;
+    // Blocks in the order they run (and are emitted) in, where every edge but a loop's goes forward
+    std::vector<uint32_t> layout;
+    // Inner loops come before the loops they're in
+    std::vector<IRLoop> loops;
+    std::vector<Value> constants;
+    // The constant instruction of each value in the pool, keyed by type and bytes
+    std::map<std::string, uint32_t> constant_values;
+
+    uint32_t add(IRInstruction instruction);
+    uint32_t add_constant(const Value& value);
+    bool is_constant(uint32_t value) const { return instructions[value].op == IROp::CONSTANT; }
+    const Value& constant(uint32_t value) const { return constants[instructions[value].constant]; }
+    // Number of (live) instructions in blocks, so not counting constants
+    size_t size() const;
+    std::string print() const;
+};
+
+// Lowers resolved (and optimized) statements into an IRProgram
+class IRBuilder : ExpressionVisitor<std::any>, StatementVisitor {
+    // Thrown at anything the IR can't represent, i.e. functions
+    struct Unsupported {};
+
+    IRProgram program;
+    uint32_t current = 0;
+    // Every declaration is a variable, found by name like in the Resolver
+    std::vector<std::map<std::string_view, uint32_t>> scopes;
+    uint32_t variable_count = 0;
+    // The value of each variable at the end of each block, keyed by (block << 32) | variable
+    std::unordered_map<uint64_t, uint32_t> definitions;
+    std::vector<bool> sealed;
+    // Phis made in a block before all of its predecessors were known
+    std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>> incomplete_phis;
+
+    uint32_t new_block();
+    void place(uint32_t block);
+    void jump(uint32_t target);
+    void branch(uint32_t condition, uint32_t if_true, uint32_t if_false);
+    void seal(uint32_t block);
+    uint32_t emit(IROp op, TokenType type, uint32_t l_operand = IRProgram::none, uint32_t r_operand = IRProgram::none);
+    uint32_t new_phi(uint32_t block);
+    void write_variable(uint32_t variable, uint32_t block, uint32_t value);
+    uint32_t read_variable(uint32_t variable, uint32_t block);
+    void add_phi_operands(uint32_t variable, uint32_t phi);
+    uint32_t find_variable(std::string_view identifier);
+    uint32_t lower(ExprPtr expression);
+    void lower(StmtPtr statement);
+    void lower_branch(StmtPtr statement);
+    std::any visit_unary_expression(const UnaryExpression& expression);
+    std::any visit_binary_expression(const BinaryExpression& expression);
+    std::any visit_ternary_expression(const TernaryExpression& expression);
+    std::any visit_literal_expression(const LiteralExpression& expression);
+    std::any visit_group_expression(const GroupExpression& expression);
+    std::any visit_variable_expression(const VariableExpression& expression);
+    std::any visit_assign_expression(const AssignExpression& expression);
+    std::any visit_range_expression(const RangeExpression& expression);
+    std::any visit_access_expression(const AccessExpression& expression);
+    std::any visit_call_expression(const CallExpression& expression);
+    std::any visit_logical_expression(const LogicalExpression& expression);
+    std::any visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
+public:
+    IRBuilder() = default;
+    // Nothing when the program uses something the IR doesn't support
+    std::optional<IRProgram> build(std::span<const StmtPtr> statements);
+};
\ No newline at end of file
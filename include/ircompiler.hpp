@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "bytecode.hpp"
+#include "ir.hpp"
+
+/* Compiles an IRProgram into a Chunk for the VM. Values live in stack
+slots, except a value that's only used by the next instruction: that's
+left on the stack for it, the way the Compiler would have. A phi shares
+its slot with its operands whenever their lifetimes allow it, so most
+loop variables are updated in place, without copies on the back edge */
+class IRCompiler {
+    const IRProgram* program = nullptr;
+    Chunk chunk;
+    std::vector<uint32_t> uses;
+    std::vector<bool> is_stackified;
+    std::vector<uint32_t> slots;
+    uint32_t slot_count = 0;
+    // Where each of the IRProgram's constants is in the Chunk's pool
+    std::vector<uint32_t> constant_indices;
+    // The position of each instruction, counting a block's start and end as one each
+    std::vector<uint32_t> positions;
+    std::vector<uint32_t> block_starts;
+    // The blocks a value is live at the start and end of, sorted
+    std::vector<std::vector<uint32_t>> live_in;
+    std::vector<std::vector<uint32_t>> live_out;
+    std::vector<size_t> block_offsets;
+    // The operand of each forward jump, and the block it jumps to
+    std::vector<std::pair<size_t, uint32_t>> jumps;
+
+    const IRInstruction& at(uint32_t value) const { return program->instructions[value]; }
+    void count_uses();
+    void stackify(const IRBlock& block);
+    size_t stackify_operand(const std::vector<uint32_t>& instructions, uint32_t value, size_t end);
+    size_t stackify_operands(const std::vector<uint32_t>& instructions, uint32_t value, size_t end);
+    bool needs_slot(uint32_t value) const;
+    void find_liveness();
+    bool is_clobbered(uint32_t value, uint32_t writer) const;
+    void assign_slots();
+    void emit(uint8_t byte);
+    void emit(OpCode op, uint16_t operand);
+    void emit_value(uint32_t value);
+    void emit_instruction(uint32_t value);
+    void emit_phi_copies(uint32_t block, uint32_t target);
+    void emit_jump(OpCode op, uint32_t block, uint32_t target);
+    void throw_error(std::string message);
+public:
+    IRCompiler() = default;
+    Chunk compile(const IRProgram& program);
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "ir.hpp"
+
+/* Optimizes an IRProgram in place, in passes that each leave it in
+SSA form: phi simplification, constant folding, type inference, common
+subexpression elimination over the dominator tree, loop invariant code
+motion, strength reduction of induction variable multiplies, and dead
+code elimination (which, in SSA form, is also dead store elimination:
+an assignment nothing reads is just a value nothing uses) */
+class IROptimizer {
+public:
+    // For --stats
+    struct Stats {
+        size_t before = 0;
+        size_t after = 0;
+        size_t simplified = 0;
+        size_t folded = 0;
+        size_t cse = 0;
+        size_t hoisted = 0;
+        size_t reduced = 0;
+        size_t removed = 0;
+    };
+
+private:
+    IRProgram* program = nullptr;
+    // Where each value was replaced to, itself if it wasn't
+    std::vector<uint32_t> forward;
+    std::vector<uint32_t> dominators;
+    Stats stats;
+
+    IRInstruction& at(uint32_t value) { return program->instructions[value]; }
+    uint32_t find(uint32_t value);
+    void replace(uint32_t value, uint32_t replacement);
+    void canonicalize();
+    bool is_invariant(const IRLoop& loop, uint32_t value);
+    uint32_t insert(uint32_t block, IROp op, TokenType type, uint32_t l_operand, uint32_t r_operand);
+    void simplify_phis();
+    void fold_constants();
+    void infer_types();
+    void fold_identities();
+    void find_dominators();
+    void eliminate_common_subexpressions();
+    void hoist_invariants();
+    void reduce_strength();
+    void eliminate_dead_code();
+public:
+    IROptimizer() = default;
+    void optimize(IRProgram& program);
+    const Stats& get_stats() const { return stats; }
+};
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+#include <string>
+#include <span>
+#include <any>
+#include <map>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "arena.hpp"
+#include "value.hpp"
+#include "token.hpp"
+
+/* Runs after the Resolver and rewrites the AST in place. Operators
+whose operands are all literals are folded into a literal, and uses
+of a const whose initializer folded are replaced by its value. Then
+an if (or elif) with a literal condition is replaced by the branch
+it would take, and a while (false) is dropped. Anything that would
+raise an error is left for the runtime to raise */
+class Optimizer : ExpressionVisitor<std::any>, StatementVisitor {
+    // Folded nodes live here, so they outlive a --stream statement's arena
+    Arena arena;
+    /* Like the Resolver's scopes, but only a const with a folded initializer
+    has a value. The global scope persists across optimize() calls */
+    std::vector<std::map<std::string, std::optional<Value>, std::less<>>> scopes = {{}};
+    // Set while optimizing an if or while body that isn't a block
+    bool is_conditional = false;
+    // What the statement being visited is replaced with, nullptr to remove it
+    StmtPtr replacement = nullptr;
+
+    ExprPtr optimize(ExprPtr expression);
+    StmtPtr optimize(StmtPtr statement);
+    // Statements that are removed are dropped from the list
+    std::vector<StmtPtr> optimize_all(std::span<const StmtPtr> statements);
+    StmtPtr optimize_branch(StmtPtr statement);
+    ExprPtr make_literal(const Value& value);
+    std::optional<Value> constant(ExprPtr expression);
+    template<typename F>
+    ExprPtr fold(ExprPtr expression, F apply);
+    std::any visit_unary_expression(const UnaryExpression& expression);
+    std::any visit_binary_expression(const BinaryExpression& expression);
+    std::any visit_ternary_expression(const TernaryExpression& expression);
+    std::any visit_literal_expression(const LiteralExpression& expression);
+    std::any visit_group_expression(const GroupExpression& expression);
+    std::any visit_variable_expression(const VariableExpression& expression);
+    std::any visit_assign_expression(const AssignExpression& expression);
+    std::any visit_range_expression(const RangeExpression& expression);
+    std::any visit_access_expression(const AccessExpression& expression);
+    std::any visit_call_expression(const CallExpression& expression);
+    std::any visit_logical_expression(const LogicalExpression& expression);
+    std::any visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
+public:
+    Optimizer() = default;
+    std::vector<StmtPtr> optimize(std::span<const StmtPtr> statements);
+    // Called by the Interpreter once a function's body has been resolved
+    void optimize_body(const FunctionStatement& function);
+};
\ No newline at end of file
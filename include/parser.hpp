@@ -1,57 +1,111 @@
 #pragma once
 
 #include <concepts>
+#include <iostream>
+#include <array>
+#include <string_view>
 #include <vector>
 #include <string>
 
 #include "expression.hpp"
 #include "statement.hpp"
+#include "scanner.hpp"
+#include "arena.hpp"
 #include "token.hpp"
 
+// Binding power of an infix operator, from loosest to tightest
+enum class Precedence {
+    NONE,
+    ASSIGNMENT, // = += -= *= /= %= |= &= ^=
+    LOGICAL_OR, // ||
+    LOGICAL_AND, // &&
+    LOGICAL_XOR, // ^^
+    TERNARY, // ?:
+    EQUALITY, // == !=
+    COMPARISON, // < > <= >=
+    BITWISE, // | & ^ @ << >>
+    TERM, // + -
+    FACTOR, // * / ** %
+    UNARY, // ! - ~ ++ --
+    POSTFIX, // ++ --
+    CALL // ()
+};
+
 class Parser {
-    std::vector<Token> tokens;
-    int current = 0;
+    typedef ExprPtr (Parser::*PrefixHandler)();
+    typedef ExprPtr (Parser::*InfixHandler)(ExprPtr);
+
+    // How a token parses at the start of an expression, and after one
+    struct ParseRule {
+        PrefixHandler prefix = nullptr;
+        InfixHandler infix = nullptr;
+        Precedence precedence = Precedence::NONE;
+    };
+
+    // Indexed by TokenType, filled in at compile time by make_rules()
+    static const std::array<ParseRule, END_TOKEN + 1> rules;
+    static constexpr std::array<ParseRule, END_TOKEN + 1> make_rules();
+
+    TokenBuffer& tokens;
+    // Only set in streaming mode, where tokens are pulled from it as the Parser needs them
+    Scanner* scanner = nullptr;
+    size_t current = 0;
+    // Owns every node handed out by parse()
+    Arena& arena;
+    // Only when the tokens outlive parse(), see FunctionStatement
+    bool is_lazy = false;
+    // Where warnings go, which aren't worth stopping the parse for
+    std::ostream& out;
 
     void test();
+    void fill(size_t index);
     Token previous();
-    Token next();
+    TokenType previous_type();
+    std::string_view previous_lexeme();
+    void advance();
     Token peek();
-    Token peek_next();
+    TokenType peek_type(size_t distance = 0);
     bool check(TokenType type);
     bool is_at_end();
     template<std::same_as<TokenType>... T>
     bool match(T... types);
-    template<std::same_as<TokenType>... T>
-    bool match_next(T... types);
-    Token consume(TokenType type, std::string message);
-    void throw_error(Token token, std::string message);
+    size_t consume(TokenType type, const char* message);
+    void throw_error(Token token, std::string_view message);
     void synchronize();
-    // Expression handlers (it was here that i realized why i needed smart pointers...)
-    ShrStmtPtr handle_declaration();
-    ShrStmtPtr handle_variable();
-    ShrStmtPtr handle_statement();
-    ShrStmtPtr handle_if();
-    ShrStmtPtr handle_print();
-    ShrStmtPtr handle_while();
-    ShrStmtPtr handle_for();
-    ShrStmtPtr handle_type();
-    std::vector<ShrStmtPtr> handle_block();
-    ShrStmtPtr handle_expression_statement();
-    ShrExprPtr handle_expression();
-    ShrExprPtr handle_assignment();
-    ShrExprPtr handle_logical_or();
-    ShrExprPtr handle_logical_and();
-    ShrExprPtr handle_logical_xor();
-    ShrExprPtr handle_ternary();
-    ShrExprPtr handle_equality();
-    ShrExprPtr handle_bitwise();
-    ShrExprPtr handle_comparison();
-    ShrExprPtr handle_term();
-    ShrExprPtr handle_factor();
-    ShrExprPtr handle_unary();
-    ShrExprPtr handle_unary_postfix();
-    ShrExprPtr handle_primary();
+    // Expression handlers
+    StmtPtr handle_declaration();
+    StmtPtr handle_variable();
+    StmtPtr handle_function(LiteralType return_type);
+    void skip_function_body();
+    StmtPtr handle_statement();
+    StmtPtr handle_if();
+    StmtPtr handle_print();
+    StmtPtr handle_while();
+    StmtPtr handle_for();
+    StmtPtr handle_type();
+    StmtPtr handle_return();
+    std::vector<StmtPtr> handle_block();
+    StmtPtr handle_expression_statement();
+    ExprPtr handle_expression();
+    // Pratt parser, see Parser::rules
+    ExprPtr parse_precedence(Precedence precedence);
+    ExprPtr handle_grouping();
+    ExprPtr handle_literal();
+    ExprPtr handle_identifier();
+    ExprPtr handle_unary();
+    ExprPtr handle_binary(ExprPtr l_operand);
+    ExprPtr handle_bitwise(ExprPtr l_operand);
+    ExprPtr handle_logical(ExprPtr l_operand);
+    ExprPtr handle_ternary(ExprPtr condition);
+    ExprPtr handle_postfix(ExprPtr operand);
+    ExprPtr handle_call(ExprPtr callee);
+    ExprPtr handle_assignment(ExprPtr target);
 public:
-    Parser(std::vector<Token> tokens);
-    std::vector<ShrStmtPtr> parse();
+    Parser(TokenBuffer& tokens, Arena& arena, bool is_lazy = false, std::ostream& out = std::cout);
+    Parser(Scanner& scanner, Arena& arena);
+    // Per Parser, so several can run at once
+    bool had_error = false;
+    std::vector<StmtPtr> parse();
+    StmtPtr parse_next();
+    void parse_body(const FunctionStatement& function);
 };
\ No newline at end of file
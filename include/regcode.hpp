@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <map>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "value.hpp"
+
+/* Instruction set of the register VM, for --engine=regvm. Every
+instruction is three-address: a is where the result goes, b and c are
+the operands. Operands are frame registers, or with the top bit set
+(see RegFunction::constant), constants, so "i + 1" is a single ADD.
+The list is a macro so the enum, the disassembler's names and the VM's
+dispatch table can't get out of order */
+#define REG_OPCODES(X) \
+    /* a = b */ \
+    X(REG_MOVE) X(REG_VOID) \
+    /* Globals, by the Resolver's slot. a = global b, global a = b (checked against LiteralType c unless it's void), global a = b */ \
+    X(REG_GET_GLOBAL) X(REG_SET_GLOBAL) X(REG_DEFINE_GLOBAL) \
+    /* Global a's initializer is about to run, it's defined as void if that fails */ \
+    X(REG_DECLARE_GLOBAL) \
+    /* Checks a against LiteralType b */ \
+    X(REG_CHECK_TYPE) \
+    /* a = b op c */ \
+    X(REG_ADD) X(REG_SUB) X(REG_MUL) X(REG_DIV) X(REG_POW) X(REG_MOD) \
+    X(REG_LESS) X(REG_GREATER) X(REG_LESS_EQ) X(REG_GREATER_EQ) X(REG_NOT_EQ) X(REG_EQ) \
+    X(REG_L_OR) X(REG_L_AND) X(REG_L_XOR) \
+    X(REG_B_OR) X(REG_B_AND) X(REG_B_XOR) X(REG_LSHFT) X(REG_RSHFT) X(REG_CHK) \
+    /* a = op b */ \
+    X(REG_NEG) X(REG_INC) X(REG_DEC) X(REG_L_NOT) X(REG_B_NOT) \
+    /* a = b op c, for operands the Typechecker proved are both i64 */ \
+    X(REG_ADD_INT) X(REG_SUB_INT) X(REG_MUL_INT) \
+    X(REG_LESS_INT) X(REG_GREATER_INT) X(REG_LESS_EQ_INT) X(REG_GREATER_EQ_INT) X(REG_NOT_EQ_INT) X(REG_EQ_INT) \
+    /* Superinstructions. a = b + c as a signed immediate, for an i64 b (i.e. "i = i + 1") */ \
+    X(REG_ADD_INT_IMM) \
+    /* Jumps to instruction a unless b op c, for the condition of a loop or if on two i64s (i.e. "i < n") */ \
+    X(REG_JUMP_UNLESS_LESS_INT) X(REG_JUMP_UNLESS_GREATER_INT) \
+    X(REG_JUMP_UNLESS_LESS_EQ_INT) X(REG_JUMP_UNLESS_GREATER_EQ_INT) \
+    X(REG_JUMP_UNLESS_NOT_EQ_INT) X(REG_JUMP_UNLESS_EQ_INT) \
+    /* Control flow. Jumps to instruction a, unless b is truthy */ \
+    X(REG_JUMP) X(REG_JUMP_UNLESS) \
+    /* Calls function b with its arguments in registers c onwards, which become the first registers of its frame, into a */ \
+    X(REG_CALL) \
+    /* Returns a, or void */ \
+    X(REG_RETURN) X(REG_RETURN_VOID) \
+    /* Built-in functions, of a */ \
+    X(REG_PRINT) X(REG_TYPEOF) \
+    X(REG_HALT)
+
+#define REG_ENUM(op) op,
+enum RegOp : uint16_t {
+    REG_OPCODES(REG_ENUM)
+};
+#undef REG_ENUM
+
+struct RegInstruction {
+    RegOp op;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+};
+
+/* A function's code (or a top-level program's, with no statement), with
+its own constants and the number of registers its frame needs. Jump
+targets are indices into code */
+struct RegFunction {
+    static constexpr uint16_t constant_bit = 0x8000;
+
+    const FunctionStatement* statement = nullptr;
+    std::vector<RegInstruction> code;
+    std::vector<Value> constants;
+    // The index of each value in constants, keyed by Value::key()
+    std::map<std::string, uint32_t> constant_indices;
+    uint16_t register_count = 0;
+    bool is_compiled = false;
+
+    // The operand for constant i
+    static uint16_t constant(uint16_t i) { return i | constant_bit; }
+    static bool is_constant(uint16_t operand) { return operand & constant_bit; }
+    // Equal values share one index, which the caller checks is below constant_bit
+    uint32_t add_constant(const Value& value);
+    // Names of the global slots and of the functions REG_CALL refers to
+    std::string disassemble(const std::vector<std::string>& global_names, const std::vector<std::string>& function_names) const;
+};
\ No newline at end of file
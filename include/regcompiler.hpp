@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <span>
+#include <string>
+#include <any>
+#include <map>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "regcode.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+class Resolver;
+class Typechecker;
+class Optimizer;
+
+/* Lowers resolved statements into RegFunctions for the register VM.
+Every local lives in a fixed register, the scope's first register plus
+the slot the Resolver gave it, so a variable is read by naming its
+register and nothing is pushed or popped. Temporaries are allocated
+above the locals, and freed after every statement. A function's body is
+compiled on its first call, after the same passes the Interpreter runs */
+class RegCompiler : ExpressionVisitor<std::any>, StatementVisitor {
+    // Registers base onwards hold the scope's slots
+    struct Scope {
+        uint16_t base;
+        uint16_t size;
+    };
+
+    // The function being compiled, and its open scopes, innermost last (none for the globals)
+    RegFunction* function = nullptr;
+    std::vector<Scope> scopes;
+    uint16_t next_register = 0;
+    // The register the expression being compiled has to leave its value in, -1 for any operand
+    int target = -1;
+    // Persist across compilations (i.e. REPL lines), indexed by REG_CALL's b
+    std::vector<std::unique_ptr<RegFunction>> functions;
+    std::map<const FunctionStatement*, uint16_t> function_indices;
+    std::vector<std::string> function_names;
+    // Indexed by the Resolver's global slots
+    std::vector<std::string> global_names;
+    Resolver* resolver = nullptr;
+    Typechecker* typechecker = nullptr;
+    Optimizer* optimizer = nullptr;
+    bool is_disassembling = false;
+
+    uint16_t compile(ExprPtr expression, int target = -1);
+    void compile(StmtPtr statement);
+    size_t emit(RegOp op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0);
+    uint16_t allocate();
+    uint16_t constant(const Value& value);
+    uint16_t destination(int target);
+    uint16_t place(uint16_t operand);
+    uint16_t keep(uint16_t operand, uint16_t mark, ExprPtr later);
+    static bool assigns(ExprPtr expression);
+    uint16_t local_register(int depth, int slot);
+    void name_global(int slot, std::string_view name);
+    uint16_t function_index(const FunctionStatement& statement);
+    size_t compile_jump_unless(ExprPtr condition);
+    void patch_jump(size_t jump);
+    void begin_scope();
+    void end_scope();
+    void throw_error(std::string message);
+    std::any visit_unary_expression(const UnaryExpression& expression);
+    std::any visit_binary_expression(const BinaryExpression& expression);
+    std::any visit_ternary_expression(const TernaryExpression& expression);
+    std::any visit_literal_expression(const LiteralExpression& expression);
+    std::any visit_group_expression(const GroupExpression& expression);
+    std::any visit_variable_expression(const VariableExpression& expression);
+    std::any visit_assign_expression(const AssignExpression& expression);
+    std::any visit_range_expression(const RangeExpression& expression);
+    std::any visit_access_expression(const AccessExpression& expression);
+    std::any visit_call_expression(const CallExpression& expression);
+    std::any visit_logical_expression(const LogicalExpression& expression);
+    std::any visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
+public:
+    RegCompiler() = default;
+    RegFunction compile(std::span<const StmtPtr> statements);
+    // Function index's code, compiled the first time it's asked for (i.e. its first call)
+    RegFunction& get_function(uint16_t index);
+    const std::vector<std::string>& get_global_names() { return global_names; }
+    void set_resolver(Resolver* resolver);
+    void set_typechecker(Typechecker* typechecker);
+    void set_optimizer(Optimizer* optimizer);
+    // Print every function's code once it's compiled, for --disassemble
+    void set_disassemble(bool is_disassembling);
+};
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "regcode.hpp"
+#include "regcompiler.hpp"
+#include "value.hpp"
+
+/* Register-based virtual machine that executes RegFunctions produced by
+the RegCompiler. Calls don't recurse on the C++ stack, each one pushes a
+Frame and moves the frame pointer up the register file */
+class RegVM {
+    struct Global {
+        Value value;
+        bool is_defined = false;
+    };
+    struct Frame {
+        const RegFunction* function;
+        // Where to continue in the caller, and the caller's first register
+        const RegInstruction* ip;
+        size_t base;
+        // The caller's register the call's result goes in
+        uint16_t result;
+    };
+
+    RegCompiler& compiler;
+    std::vector<Value> registers;
+    std::vector<Frame> frames;
+    // Persist across runs (i.e. REPL lines), indexed by the Resolver's global slots
+    std::vector<Global> globals;
+    // The global whose initializer is running, -1 if none
+    int declaring = -1;
+
+    void throw_error(std::string message);
+public:
+    RegVM(RegCompiler& compiler) : compiler(compiler) {}
+    void run(const RegFunction& script);
+};
\ No newline at end of file
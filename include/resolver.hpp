@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <string>
+#include <any>
+#include <map>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "token.hpp"
+
+/* Static pass between the Parser and the Interpreter that
+binds every variable use to a (depth, slot) pair: how many
+scopes up the variable lives, and its index in that scope.
+Globals get a depth of -1, since a function can be called
+from any number of scopes deep */
+class Resolver : ExpressionVisitor<std::any>, StatementVisitor {
+    struct Variable {
+        int slot;
+        bool is_const;
+    };
+
+    // The global scope is scopes[0], and persists across resolve() calls (i.e. REPL lines)
+    std::vector<std::map<std::string, Variable, std::less<>>> scopes = {{}};
+    // Functions live in their own namespace, which also persists
+    std::map<std::string, const FunctionStatement*, std::less<>> functions;
+    bool in_function = false;
+
+    void resolve(ExprPtr expression);
+    void resolve(StmtPtr statement);
+    void begin_scope();
+    void end_scope();
+    // Returns whether the variable is const
+    bool resolve_identifier(Token identifier, int& depth, int& slot);
+    void throw_error(std::string message);
+    std::any visit_unary_expression(const UnaryExpression& expression);
+    std::any visit_binary_expression(const BinaryExpression& expression);
+    std::any visit_ternary_expression(const TernaryExpression& expression);
+    std::any visit_literal_expression(const LiteralExpression& expression);
+    std::any visit_group_expression(const GroupExpression& expression);
+    std::any visit_variable_expression(const VariableExpression& expression);
+    std::any visit_assign_expression(const AssignExpression& expression);
+    std::any visit_range_expression(const RangeExpression& expression);
+    std::any visit_access_expression(const AccessExpression& expression);
+    std::any visit_call_expression(const CallExpression& expression);
+    std::any visit_logical_expression(const LogicalExpression& expression);
+    std::any visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
+public:
+    Resolver() = default;
+    void resolve(std::span<const StmtPtr> statements);
+    void resolve_body(const FunctionStatement& function);
+};
\ No newline at end of file
@@ -2,21 +2,27 @@
 
 #include <stdbool.h>
 #include <iostream>
+#include <string_view>
 #include <vector>
 #include <string>
-#include <map>
-#include <any>
 
 #include "common.hpp"
 #include "token.hpp"
+#include "hash.hpp"
+#include "value.hpp"
 
+// Tokens' lexemes are views into src, which has to outlive them
 class Scanner {
-    std::string src;
-    int start = 0;
-    int current = 0;
+    std::string_view src;
+    size_t start = 0;
+    size_t current = 0;
     int line = 1;
+    // Tracked here since a lazy Scanner's buffer can be emptied under it
+    TokenType last_type = NEWLINE;
+    bool is_finished = false;
 
-    std::map<std::string, TokenType> keywords = {
+    // Every word that isn't an identifier, shared by all Scanners
+    static constexpr PerfectHash<TokenType, 30> keywords{{{
         {"if", IF},
         {"elif", ELIF},
         {"else", ELSE},
@@ -32,29 +38,38 @@ class Scanner {
         {"struct", STRUCT},
         {"fn", FN},
         // TODO: add classes
-    };
-
-    std::string types[14] = {
-        "u8", "i8", "u16", "i16",
-        "u32", "i32", "int", "u64",
-        "i64", "f32", "f64", "str",
-        "void", "bool"
-    };
+        // Types
+        {"u8", TYPE}, {"i8", TYPE}, {"u16", TYPE}, {"i16", TYPE},
+        {"u32", TYPE}, {"i32", TYPE}, {"int", TYPE}, {"u64", TYPE},
+        {"i64", TYPE}, {"f32", TYPE}, {"f64", TYPE}, {"str", TYPE},
+        {"void", TYPE}, {"bool", TYPE},
+        // Built-in functions (TODO: remove)
+        {"print", PRINT},
+        {"type", TYPEOF}
+    }}};
 
 public:
-    Scanner(std::string src);
-    std::vector<Token> tokens;
+    /* A lazy Scanner doesn't scan anything until scan_next() is called.
+    first_line is where src starts in its file, when it's only part of one */
+    Scanner(std::string_view src, bool is_lazy = false, int first_line = 1);
+    TokenBuffer tokens;
+    // Per Scanner, so several can run at once
+    bool had_error = false;
+    bool scan_next();
 private:
     char next();
     char peek();
     char peek_next();
     bool is_at_end();
     void handle_string();
+    void handle_digits();
     void handle_number();
+    Value decode_radix(std::string_view digits, int bits_per_digit);
+    Value decode_decimal(std::string_view digits, bool is_float);
     void handle_identifier_or_type();
     void handle_two_char_operator(TokenType type, char next_char);
     void add_token(TokenType type);
-    void add_token(TokenType type, std::any literal);
+    void add_token(TokenType type, Value literal);
     void scan_token();
     void scan_tokens();
     void throw_error(std::string message);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string_view>
+#include <stdint.h>
+
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+/* Byte-run scanning for the Scanner, 16 (SSE2) or 32 (AVX2)
+bytes at a time. The best level the CPU supports is picked at
+startup, and every function has a scalar fallback for other
+architectures. Each returns the index of the first byte at or
+after index that ends the run, or src.length() */
+struct Simd {
+    static SimdLevel detect();
+    static SimdLevel level();
+    // Clamped to what the CPU actually supports
+    static void use(SimdLevel level);
+    static const char* name(SimdLevel level);
+
+    // Spaces, tabs, carriage returns and line-continuing backslashes
+    static size_t skip_whitespace(std::string_view src, size_t index);
+    // [A-Za-z0-9_]
+    static size_t skip_identifier(std::string_view src, size_t index);
+    static size_t skip_digits(std::string_view src, size_t index);
+    static size_t find(std::string_view src, size_t index, char c);
+};
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string_view>
+#include <string>
+
+/* Read-only text of a program. Files are memory-mapped, so
+loading a script doesn't copy it at all; anything that can't
+be mapped (i.e. pipes like /dev/stdin) is read into a buffer
+instead. Tokens point straight into text(), so a Source has
+to outlive the tokens and the AST built from them */
+class Source {
+    const char* data = nullptr;
+    size_t size = 0;
+    // Backing storage when the file couldn't be mapped
+    std::string buffer;
+    bool is_mapped = false;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+
+    bool map(const std::string& path);
+    bool read(const std::string& path);
+    void unmap();
+public:
+    Source() = default;
+    Source(const Source&) = delete;
+    Source& operator=(const Source&) = delete;
+    ~Source();
+    bool load(const std::string& path);
+    std::string_view text() const;
+    bool mapped() const;
+};
\ No newline at end of file
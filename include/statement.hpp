@@ -2,7 +2,6 @@
 
 #include <iostream>
 #include <optional>
-#include <memory>
 #include <vector>
 #include <any>
 
@@ -23,128 +22,149 @@ struct ForInStatement;
 struct SwitchStatement;
 struct ReturnStatement;
 struct StructStatement;
+struct FunctionStatement;
+class Parser;
 
-typedef std::shared_ptr<Statement> ShrStmtPtr;
-typedef std::shared_ptr<ExpressionStatement> ShrExpressionStmtPtr;
-typedef std::shared_ptr<PrintStatement> ShrPrintStmtPtr;
-typedef std::shared_ptr<TypeStatement> ShrTypeStmtPtr;
-typedef std::shared_ptr<BlockStatement> ShrBlockStmtPtr;
-typedef std::shared_ptr<DeclareStatement> ShrDeclareStmtPtr;
-typedef std::shared_ptr<IfStatement> ShrIfStmtPtr;
-typedef std::shared_ptr<WhileStatement> ShrWhileStmtPtr;
-typedef std::shared_ptr<ForStatement> ShrForStmtPtr;
-typedef std::shared_ptr<ForInStatement> ShrForInStmtPtr;
-typedef std::shared_ptr<SwitchStatement> ShrSwitchStmtPtr;
-typedef std::shared_ptr<ReturnStatement> ShrReturnStmtPtr;
-typedef std::shared_ptr<StructStatement> ShrStructStmtPtr;
+typedef Statement* StmtPtr;
 
 struct StatementVisitor {
-    virtual void visit_expression_statement(ShrExpressionStmtPtr statement) = 0;
-    virtual void visit_print_statement(ShrPrintStmtPtr statement) = 0;
-    virtual void visit_type_statement(ShrTypeStmtPtr statement) = 0;
-    virtual void visit_block_statement(ShrBlockStmtPtr statement) = 0;
-    virtual void visit_declare_statement(ShrDeclareStmtPtr statement) = 0;
-    virtual void visit_if_statement(ShrIfStmtPtr statement) = 0;
-    virtual void visit_while_statement(ShrWhileStmtPtr statement) = 0;
-    virtual void visit_for_statement(ShrForStmtPtr statement) = 0;
-    virtual void visit_forin_statement(ShrForInStmtPtr statement) = 0;
-    virtual void visit_switch_statement(ShrSwitchStmtPtr statement) = 0;
-    virtual void visit_return_statement(ShrReturnStmtPtr statement) = 0;
-    virtual void visit_struct_statement(ShrStructStmtPtr statement) = 0;
+    virtual void visit_expression_statement(const ExpressionStatement& statement) = 0;
+    virtual void visit_print_statement(const PrintStatement& statement) = 0;
+    virtual void visit_type_statement(const TypeStatement& statement) = 0;
+    virtual void visit_block_statement(const BlockStatement& statement) = 0;
+    virtual void visit_declare_statement(const DeclareStatement& statement) = 0;
+    virtual void visit_if_statement(const IfStatement& statement) = 0;
+    virtual void visit_while_statement(const WhileStatement& statement) = 0;
+    virtual void visit_for_statement(const ForStatement& statement) = 0;
+    virtual void visit_forin_statement(const ForInStatement& statement) = 0;
+    virtual void visit_switch_statement(const SwitchStatement& statement) = 0;
+    virtual void visit_return_statement(const ReturnStatement& statement) = 0;
+    virtual void visit_struct_statement(const StructStatement& statement) = 0;
+    virtual void visit_function_statement(const FunctionStatement& statement) = 0;
     virtual ~StatementVisitor() = default;
 };
 
 struct Statement {
-    virtual void accept(StatementVisitor& statement_visitor) = 0;
+    virtual void accept(StatementVisitor& statement_visitor) const = 0;
     virtual ~Statement() = default;
 };
 
-struct ExpressionStatement : Statement, public std::enable_shared_from_this<ExpressionStatement> {
-    ShrExprPtr expression;
+struct ExpressionStatement : Statement {
+    ExprPtr expression;
 
-    ExpressionStatement(ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+    ExpressionStatement(ExprPtr expression);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct PrintStatement : Statement, public std::enable_shared_from_this<PrintStatement> {
-    ShrExprPtr expression;
+struct PrintStatement : Statement {
+    ExprPtr expression;
 
-    PrintStatement(ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+    PrintStatement(ExprPtr expression);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct TypeStatement : Statement, public std::enable_shared_from_this<TypeStatement> {
-    ShrExprPtr expression;
+struct TypeStatement : Statement {
+    ExprPtr expression;
 
-    TypeStatement(ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+    TypeStatement(ExprPtr expression);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct BlockStatement : Statement, public std::enable_shared_from_this<BlockStatement> {
-    std::vector<ShrStmtPtr> statements;
+struct BlockStatement : Statement {
+    std::vector<StmtPtr> statements;
 
-    BlockStatement(std::vector<ShrStmtPtr> statements);
-    void accept(StatementVisitor& statement_visitor) override;
+    BlockStatement(std::vector<StmtPtr> statements);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct DeclareStatement : Statement, public std::enable_shared_from_this<DeclareStatement> {
+struct DeclareStatement : Statement {
     Token identifier;
     LiteralType literal_type;
-    ShrExprPtr expression;
-
-    DeclareStatement(Token identifier, LiteralType literal_type, ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+    ExprPtr expression;
+    bool is_const;
+    // Set by the Resolver
+    mutable int slot = -1;
+    mutable bool is_redeclaration = false;
+    // Set by the Typechecker, same as AssignExpression::checked_type
+    mutable LiteralType checked_type = LiteralType::VOID;
+
+    DeclareStatement(Token identifier, LiteralType literal_type, ExprPtr expression, bool is_const);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct IfStatement : Statement, public std::enable_shared_from_this<IfStatement> {
-    ShrExprPtr expression;
-    ShrStmtPtr then_branch;
-    ShrStmtPtr else_branch;
+struct IfStatement : Statement {
+    ExprPtr expression;
+    StmtPtr then_branch;
+    StmtPtr else_branch;
 
-    IfStatement(ShrExprPtr expression, ShrStmtPtr then_branch, ShrStmtPtr else_branch);
-    void accept(StatementVisitor& statement_visitor) override;
+    IfStatement(ExprPtr expression, StmtPtr then_branch, StmtPtr else_branch);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct WhileStatement : Statement, public std::enable_shared_from_this<WhileStatement> {
-    ShrExprPtr expression;
-    ShrStmtPtr statements;
+struct WhileStatement : Statement {
+    ExprPtr expression;
+    StmtPtr statements;
 
-    WhileStatement(ShrExprPtr expression, ShrStmtPtr statements);
-    void accept(StatementVisitor& statement_visitor) override;
+    WhileStatement(ExprPtr expression, StmtPtr statements);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct ForStatement : Statement, public std::enable_shared_from_this<ForStatement> {
-    ShrExprPtr expression;
+struct ForStatement : Statement {
+    ExprPtr expression;
 
-    ForStatement(ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+    ForStatement(ExprPtr expression);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct ForInStatement : Statement, public std::enable_shared_from_this<ForInStatement> {
-    ShrExprPtr expression;
+struct ForInStatement : Statement {
+    ExprPtr expression;
 
-    ForInStatement(ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+    ForInStatement(ExprPtr expression);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct SwitchStatement : Statement, public std::enable_shared_from_this<SwitchStatement> {
-    ShrExprPtr expression;
+struct SwitchStatement : Statement {
+    ExprPtr expression;
 
-    SwitchStatement(ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+    SwitchStatement(ExprPtr expression);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
-struct ReturnStatement : Statement, public std::enable_shared_from_this<ReturnStatement> {
-    ShrExprPtr expression;
+struct ReturnStatement : Statement {
+    ExprPtr expression;
 
-    ReturnStatement(ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+    ReturnStatement(ExprPtr expression);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
 
 // TODO: ask me later
-struct StructStatement : Statement, public std::enable_shared_from_this<StructStatement> {
-    ShrExprPtr expression;
+struct StructStatement : Statement {
+    ExprPtr expression;
+
+    StructStatement(ExprPtr expression);
+    void accept(StatementVisitor& statement_visitor) const override;
+};
 
-    StructStatement(ShrExprPtr expression);
-    void accept(StatementVisitor& statement_visitor) override;
+struct Parameter {
+    Token identifier;
+    LiteralType type;
+};
+
+/* In a file, the Parser only skips over a function's body by matching
+braces, and the body is parsed the first time the function is called.
+It's always resolved on the first call, so it can use globals declared
+after the function. body_start is the index of the token after the
+opening brace, in the tokens of the Parser that skipped the body */
+struct FunctionStatement : Statement {
+    Token identifier;
+    std::vector<Parameter> parameters;
+    LiteralType return_type;
+    size_t body_start;
+    mutable std::vector<StmtPtr> body;
+    mutable bool is_parsed = false;
+    mutable bool is_resolved = false;
+    Parser* parser = nullptr;
+
+    FunctionStatement(Token identifier, std::vector<Parameter> parameters, LiteralType return_type, size_t body_start);
+    void accept(StatementVisitor& statement_visitor) const override;
 };
\ No newline at end of file
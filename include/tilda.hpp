@@ -4,6 +4,10 @@
 
 #include "expression.hpp"
 
+/* Error state of the passes after parsing (Resolver, Typechecker, the
+compilers and engines), which only ever run on the main thread. The
+Scanner and Parser, which the FrontEnd runs on many threads, keep their
+own had_error instead */
 struct Tilda {
     static bool had_error;
     static bool had_runtime_error;
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <string_view>
+#include <stdint.h>
+#include <vector>
 #include <string>
-#include <map>
-#include <any>
+#include <array>
 
+#include "value.hpp"
 #include "types.hpp"
 
 enum TokenType {
@@ -21,7 +24,7 @@ enum TokenType {
     // Math Operators
     ADD, SUB, MUL, DIV, POW, NEG,
     MOD, INC, DEC, ADD_EQ, SUB_EQ,
-    MUL_EQ, DIV_EQ, POW_EQ,
+    MUL_EQ, DIV_EQ, POW_EQ, MOD_EQ,
     // Logical Operators
     LESS, GREATER, LESS_EQ, GREATER_EQ,
     NOT_EQ, EQ, L_OR, L_AND, L_XOR, L_NOT,
@@ -29,24 +32,147 @@ enum TokenType {
     T_IF, T_ELSE, TERN, // not actually a tokenized operator
     // Bitwise Operators
     B_OR, B_AND, B_XOR, B_NOT,
-    LSHFT, RSHFT, CHK,
+    LSHFT, RSHFT, CHK, B_OR_EQ,
+    B_AND_EQ, B_XOR_EQ,
     // Built-in Functions
     PRINT, TYPEOF,
     // End-of-file
     END_TOKEN
 };
 
+// Token::token_type_names, filled in at compile time. Types without a name map to ""
+constexpr std::array<std::string_view, END_TOKEN + 1> make_token_type_names() {
+    std::array<std::string_view, END_TOKEN + 1> names{};
+    // Syntax
+    names[L_PAREN] = "(";
+    names[R_PAREN] = ")";
+    names[L_BRACE] = "{";
+    names[R_BRACE] = "}";
+    names[L_BRACKET] = "[";
+    names[R_BRACKET] = "]";
+    names[COMMA] = ",";
+    names[ASSIGN] = "=";
+    names[RANGE] = "..";
+    names[ACCESS] = ".";
+    names[COMMENT] = "//";
+    names[SEMICOLON] = ";";
+    // Keywords
+    names[IF] = "if";
+    names[ELIF] = "elif";
+    names[ELSE] = "else";
+    names[WHILE] = "while";
+    names[FOR] = "for";
+    names[IN] = "in";
+    names[SWITCH] = "switch";
+    names[RETURN] = "return";
+    names[TRUE] = "true";
+    names[FALSE] = "false";
+    names[LET] = "let";
+    names[CONST] = "const";
+    names[STRUCT] = "struct";
+    names[FN] = "fn";
+    // Values
+    names[IDENTIFIER] = "identifier";
+    names[TYPE] = "type";
+    names[STR] = "string";
+    names[NUM] = "number";
+    // Math Operators
+    names[ADD] = "+";
+    names[SUB] = "-";
+    names[MUL] = "*";
+    names[DIV] = "/";
+    names[POW] = "**";
+    names[NEG] = "-";
+    names[MOD] = "%";
+    names[ADD_EQ] = "+=";
+    names[SUB_EQ] = "-=";
+    names[MUL_EQ] = "*=";
+    names[DIV_EQ] = "/=";
+    names[POW_EQ] = "**=";
+    names[MOD_EQ] = "%=";
+    names[INC] = "++";
+    names[DEC] = "--";
+    // Logical Operators
+    names[LESS] = "<";
+    names[GREATER] = ">";
+    names[LESS_EQ] = "<=";
+    names[GREATER_EQ] = ">=";
+    names[NOT_EQ] = "!=";
+    names[EQ] = "==";
+    names[L_OR] = "||";
+    names[L_AND] = "&&";
+    names[L_XOR] = "^^";
+    names[L_NOT] = "!";
+    // Ternary Logical Operators
+    names[TERN] = "?:";
+    names[T_IF] = "?";
+    names[T_ELSE] = ":";
+    // Bitwise Operators
+    names[B_OR] = "|";
+    names[B_AND] = "&";
+    names[B_XOR] = "^";
+    names[B_NOT] = "~";
+    names[LSHFT] = "<<";
+    names[RSHFT] = ">>";
+    names[CHK] = "@";
+    names[B_OR_EQ] = "|=";
+    names[B_AND_EQ] = "&=";
+    names[B_XOR_EQ] = "^=";
+    // Built-in Functions
+    names[PRINT] = "print";
+    names[TYPEOF] = "type";
+    // End-of-file
+    names[END_TOKEN] = "eof";
+    return names;
+}
+
 struct Token {
     TokenType type;
-    LiteralType literal_type;
+    LiteralType literal_type = LiteralType::VOID;
     // bool is_pointer;
     // bool is_reference;
-    std::any literal;
-    std::string lexeme;
+    Value literal;
+    // View into the Scanner's source
+    std::string_view lexeme;
     int line;
 
     Token() = default;
-    Token(TokenType type, std::string lexeme, std::any literal, int line);
+    Token(TokenType type, std::string_view lexeme, Value literal, int line);
+
+    static constexpr std::array<std::string_view, END_TOKEN + 1> token_type_names = make_token_type_names();
+};
+
+/* The Scanner's output, stored as a struct of arrays. A token is
+just an index: its type, source offset and length live in parallel
+arrays (9 bytes a token), the few tokens that carry a literal
+(NUM, STR, TRUE and FALSE) keep it in a side table, and lines are
+run-length encoded since most lines hold several tokens */
+class TokenBuffer {
+    struct LineRun {
+        uint32_t first_token;
+        int line;
+    };
 
-    static std::map<TokenType, std::string> token_type_names;
+    std::string_view src;
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    // Sorted indices of the tokens that have a literal, and those literals
+    std::vector<uint32_t> literal_indices;
+    std::vector<Value> literals;
+    std::vector<LineRun> lines;
+public:
+    TokenBuffer(std::string_view src);
+    void push(TokenType type, uint32_t offset, uint32_t length, int line);
+    void push(TokenType type, uint32_t offset, uint32_t length, int line, Value literal);
+    size_t size() const;
+    TokenType type(size_t index) const;
+    std::string_view lexeme(size_t index) const;
+    Value literal(size_t index) const;
+    int line(size_t index) const;
+    // Materializes a whole Token, for the nodes that keep one
+    Token get(size_t index) const;
+    // Drops the tokens before index, which shifts the rest down to start at 0
+    void discard_before(size_t index);
+    size_t bytes() const;
 };
\ No newline at end of file
@@ -1,12 +1,79 @@
 #pragma once
 
 #include <vector>
+#include <span>
+#include <string>
+#include <any>
+#include <map>
 
+#include "expression.hpp"
 #include "statement.hpp"
 #include "token.hpp"
 
-class Typechecker {
+/* Static pass between the Resolver and the Optimizer that gives every
+expression the type it will have at runtime, where that can be known,
+and reports operations on mismatched types before the code they're in
+runs. A function's body is checked on its first call, when it's resolved.
+A variable keeps the type it was declared with (or, for "let", the type
+of its initializer) for its whole life, at its declared width. Storing a
+value whose type is only known at runtime into one is checked when it
+happens, so the types
+on the AST always hold, and the engines can skip their own checks */
+class Typechecker : ExpressionVisitor<std::any>, StatementVisitor {
+    struct Variable {
+        // Every value stored in the variable has this type, VOID if any type goes
+        LiteralType type;
+        // Only then is the variable's value known to have its type, and not be void
+        bool is_initialized;
+    };
 
+    // Mirrors the Resolver's scopes, the globals persist across check() calls (i.e. REPL lines)
+    std::vector<std::map<std::string, Variable, std::less<>>> scopes = {{}};
+    const FunctionStatement* function = nullptr;
+
+    LiteralType check(ExprPtr expression);
+    void check(StmtPtr statement);
+    void begin_scope();
+    void end_scope();
+    Variable* find_variable(std::string_view name);
+    static bool is_adaptable(ExprPtr expression, LiteralType type);
+    static void adapt(ExprPtr expression, LiteralType type);
+    static void adapt_operands(ExprPtr l_operand, ExprPtr r_operand);
+    void check_store(LiteralType type, ExprPtr expression, Token identifier, LiteralType& checked_type);
+    static LiteralType binary_type(TokenType type, LiteralType operand_type);
+    void throw_error(std::string message);
+    std::any visit_unary_expression(const UnaryExpression& expression);
+    std::any visit_binary_expression(const BinaryExpression& expression);
+    std::any visit_ternary_expression(const TernaryExpression& expression);
+    std::any visit_literal_expression(const LiteralExpression& expression);
+    std::any visit_group_expression(const GroupExpression& expression);
+    std::any visit_variable_expression(const VariableExpression& expression);
+    std::any visit_assign_expression(const AssignExpression& expression);
+    std::any visit_range_expression(const RangeExpression& expression);
+    std::any visit_access_expression(const AccessExpression& expression);
+    std::any visit_call_expression(const CallExpression& expression);
+    std::any visit_logical_expression(const LogicalExpression& expression);
+    std::any visit_bitwise_expression(const BitwiseExpression& expression);
+    void visit_expression_statement(const ExpressionStatement& statement);
+    void visit_print_statement(const PrintStatement& statement);
+    void visit_type_statement(const TypeStatement& statement);
+    void visit_block_statement(const BlockStatement& statement);
+    void visit_declare_statement(const DeclareStatement& statement);
+    void visit_if_statement(const IfStatement& statement);
+    void visit_while_statement(const WhileStatement& statement);
+    void visit_for_statement(const ForStatement& statement);
+    void visit_forin_statement(const ForInStatement& statement);
+    void visit_switch_statement(const SwitchStatement& statement);
+    void visit_return_statement(const ReturnStatement& statement);
+    void visit_struct_statement(const StructStatement& statement);
+    void visit_function_statement(const FunctionStatement& statement);
 public:
-    Typechecker(std::vector<ShrStmtPtr> statements);
+    Typechecker() = default;
+    void check(std::span<const StmtPtr> statements);
+    void check_body(const FunctionStatement& function);
+    // After a runtime error, a global whose initializer threw was left void
+    void forget_initializers();
+    // What a declared type is stored as, only "int" is another name for i64, the width of integer literals
+    static LiteralType runtime_type(LiteralType type);
+    static std::string type_name(LiteralType type);
 };
\ No newline at end of file
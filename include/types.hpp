@@ -1,9 +1,11 @@
 #pragma once
 
-#include <string>
-#include <map>
+#include <stdint.h>
+#include <string_view>
 
-enum class LiteralType {
+#include "hash.hpp"
+
+enum class LiteralType : uint8_t {
     U8, I8,
     U16, I16,
     U32, I32, INT,
@@ -14,6 +16,32 @@ enum class LiteralType {
     VOID
 };
 
+constexpr bool is_integer_type(LiteralType type) { return type <= LiteralType::I64; }
+constexpr bool is_float_type(LiteralType type) { return type == LiteralType::F32 || type == LiteralType::F64; }
+constexpr bool is_unsigned_type(LiteralType type) {
+    return type == LiteralType::U8 || type == LiteralType::U16 || type == LiteralType::U32 || type == LiteralType::U64;
+}
+
+// Indexed by LiteralType, spelled the way they're declared
+inline constexpr std::string_view literal_type_names[] = {
+    "u8", "i8", "u16", "i16", "u32", "i32", "int", "u64", "i64", "f32", "f64", "str", "bool", "void"
+};
+
 struct StringToLiteralType {
-    static std::map<std::string, LiteralType> map;
+    static constexpr PerfectHash<LiteralType, 14> map{{{
+        {"u8", LiteralType::U8},
+        {"i8", LiteralType::I8},
+        {"u16", LiteralType::U16},
+        {"i16", LiteralType::I16},
+        {"u32", LiteralType::U32},
+        {"i32", LiteralType::I32},
+        {"int", LiteralType::INT},
+        {"u64", LiteralType::U64},
+        {"i64", LiteralType::I64},
+        {"f32", LiteralType::F32},
+        {"f64", LiteralType::F64},
+        {"str", LiteralType::STR},
+        {"bool", LiteralType::BOOL},
+        {"void", LiteralType::VOID}
+    }}};
 };
\ No newline at end of file
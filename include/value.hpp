@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+#include <string>
+
+#include "types.hpp"
+
+// Heap-allocated, reference counted payload of a str Value
+struct StringObject {
+    uint32_t references;
+    std::string str;
+};
+
+/* A 16-byte tagged value. The tag is the value's LiteralType,
+and everything but strings is stored inline, so copying a
+number or a bool never allocates or touches the heap.
+Every integer type is held in integer, sign or zero extended
+from its width, and an f32 is a double rounded to a float */
+struct Value {
+    LiteralType type;
+    union {
+        bool boolean;
+        int64_t integer;
+        double floating;
+        StringObject* string;
+    };
+
+    Value() : type(LiteralType::VOID), integer(0) {}
+    Value(bool boolean) : type(LiteralType::BOOL), integer(0) { this->boolean = boolean; }
+    Value(int64_t integer) : type(LiteralType::I64), integer(integer) {}
+    Value(double floating) : type(LiteralType::F64), floating(floating) {}
+    Value(std::string str) : type(LiteralType::STR), string(new StringObject{1, std::move(str)}) {}
+    Value(std::string_view str) : Value(std::string(str)) {}
+    Value(const char* str) : Value(std::string(str)) {}
+
+    Value(const Value& other) : type(other.type), integer(other.integer) {
+        retain();
+    }
+
+    Value(Value&& other) noexcept : type(other.type), integer(other.integer) {
+        other.type = LiteralType::VOID;
+    }
+
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            other.retain();
+            release();
+            type = other.type;
+            integer = other.integer;
+        }
+        return *this;
+    }
+
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            type = other.type;
+            integer = other.integer;
+            other.type = LiteralType::VOID;
+        }
+        return *this;
+    }
+
+    ~Value() {
+        release();
+    }
+
+    bool is_void() const { return type == LiteralType::VOID; }
+    bool is_bool() const { return type == LiteralType::BOOL; }
+    bool is_int() const { return is_integer_type(type); }
+    bool is_float() const { return is_float_type(type); }
+    bool is_number() const { return is_int() || is_float(); }
+    bool is_str() const { return type == LiteralType::STR; }
+
+    const std::string& as_str() const { return string->str; }
+
+    // Equal values have equal keys (the type, then the payload's bytes), for pooling constants
+    std::string key() const {
+        std::string key(1, static_cast<char>(type));
+        if (is_str())
+            key += as_str();
+        else if (is_bool())
+            key += boolean ? '1' : '0';
+        else if (!is_void())
+            key.append(reinterpret_cast<const char*>(&integer), sizeof(integer));
+        return key;
+    }
+
+    // Truncates integer to type's width, wrapping around like C's fixed-width integers
+    static constexpr int64_t wrap(LiteralType type, int64_t integer) {
+        switch (type) {
+            case LiteralType::U8: return static_cast<uint8_t>(integer);
+            case LiteralType::I8: return static_cast<int8_t>(integer);
+            case LiteralType::U16: return static_cast<uint16_t>(integer);
+            case LiteralType::I16: return static_cast<int16_t>(integer);
+            case LiteralType::U32: return static_cast<uint32_t>(integer);
+            case LiteralType::I32: return static_cast<int32_t>(integer);
+            default: return integer;
+        }
+    }
+
+    /* i64 arithmetic wraps around in two's complement. It's done unsigned,
+    since overflowing a signed integer is undefined, i.e. INT64_MAX + 1 */
+    static constexpr int64_t wrapping_add(int64_t l, int64_t r) {
+        return static_cast<int64_t>(static_cast<uint64_t>(l) + static_cast<uint64_t>(r));
+    }
+
+    static constexpr int64_t wrapping_sub(int64_t l, int64_t r) {
+        return static_cast<int64_t>(static_cast<uint64_t>(l) - static_cast<uint64_t>(r));
+    }
+
+    static constexpr int64_t wrapping_mul(int64_t l, int64_t r) {
+        return static_cast<int64_t>(static_cast<uint64_t>(l) * static_cast<uint64_t>(r));
+    }
+
+    // -INT64_MIN is INT64_MIN
+    static constexpr int64_t wrapping_neg(int64_t integer) {
+        return static_cast<int64_t>(0 - static_cast<uint64_t>(integer));
+    }
+
+    // Shift counts are taken mod 64 (like x86 does), so "1 << 64" is 1 instead of undefined
+    static constexpr int64_t shift_left(int64_t l, int64_t r) {
+        return static_cast<int64_t>(static_cast<uint64_t>(l) << (r & 63));
+    }
+
+    // Brings in copies of the sign bit
+    static constexpr int64_t shift_right(int64_t l, int64_t r) {
+        return l >> (r & 63);
+    }
+
+    static Value of_integer(LiteralType type, int64_t integer) {
+        Value value(wrap(type, integer));
+        value.type = type;
+        return value;
+    }
+
+    static Value of_float(LiteralType type, double floating) {
+        Value value(type == LiteralType::F32 ? static_cast<float>(floating) : floating);
+        value.type = type;
+        return value;
+    }
+
+    // Combines two tags into one switchable key, i.e. "case type_pair(I64, I64):"
+    static constexpr int type_pair(LiteralType l_type, LiteralType r_type) {
+        return (static_cast<int>(l_type) << 4) | static_cast<int>(r_type);
+    }
+
+private:
+    void retain() const {
+        if (type == LiteralType::STR)
+            string->references++;
+    }
+
+    void release() {
+        if (type == LiteralType::STR && --string->references == 0)
+            delete string;
+    }
+};
+
+static_assert(sizeof(Value) == 16, "Value should stay two words wide");
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "bytecode.hpp"
+#include "value.hpp"
+
+// Stack-based virtual machine that executes Chunks produced by the Compiler
+class VM {
+    struct Global {
+        Value value;
+        bool is_defined = false;
+    };
+
+    std::vector<Value> stack;
+    // Persist across runs (i.e. REPL lines), indexed by the Compiler's global slots
+    std::vector<Global> globals;
+
+    void push(Value value);
+    Value pop();
+    Value& peek();
+    void throw_error(std::string message);
+public:
+    VM() = default;
+    void run(const Chunk& chunk);
+};
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include <algorithm>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "arena.hpp"
+
+Arena::Arena(size_t block_size) :
+    block_size(block_size) {}
+
+Arena::~Arena() {
+    reset();
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    if (!blocks.empty()) {
+        Block& block = blocks.back();
+        size_t start = (block.used + alignment - 1) & ~(alignment - 1);
+        if (start + size <= block.size) {
+            block.used = start + size;
+            return block.data.get() + start;
+        }
+    }
+    // Oversized nodes (there shouldn't be any) get a block of their own
+    size_t size_needed = std::max(block_size, size + alignment);
+    blocks.push_back({std::unique_ptr<char[]>(new char[size_needed]), size_needed, 0});
+    return allocate(size, alignment);
+}
+
+// Destroys every node, newest first, and keeps the first block around for reuse
+void Arena::reset() {
+    for (auto destructor = destructors.rbegin(); destructor != destructors.rend(); destructor++)
+        destructor->destroy(destructor->object);
+    destructors.clear();
+    if (blocks.size() > 1)
+        blocks.resize(1);
+    if (!blocks.empty())
+        blocks[0].used = 0;
+}
+
+size_t Arena::bytes_used() {
+    size_t bytes = 0;
+    for (Block& block : blocks)
+        bytes += block.used;
+    return bytes;
+}
\ No newline at end of file
@@ -1,21 +1,38 @@
 #include <iostream>
 #include <sstream>
+#include <format>
 #include <ostream>
 #include <string>
 #include <vector>
 #include <any>
 
 #include "expression.hpp"
+#include "statement.hpp"
 #include "token.hpp"
 #include "common.hpp"
 #include "ast.hpp"
 
-std::string AST::print(ShrExprPtr expression) {
+std::string AST::print(ExprPtr expression) {
     return std::any_cast<std::string>(expression->accept(*this));
 }
 
+// Returns the statement's lines, each ending in a newline
+std::string AST::print(StmtPtr statement) {
+    std::string enclosing = std::move(printed);
+    printed.clear();
+    statement->accept(*this);
+    std::swap(printed, enclosing);
+    return enclosing;
+}
+
+void AST::print_line(std::string_view text) {
+    printed.append(depth * 2, ' ');
+    printed += text;
+    printed += '\n';
+}
+
 template<class... E>
-std::string AST::parenthesize(std::string label, E... expressions) {
+std::string AST::parenthesize(std::string_view label, E... expressions) {
     std::ostringstream buf;
 
     buf << "(" << label;
@@ -27,7 +44,7 @@ std::string AST::parenthesize(std::string label, E... expressions) {
 
 // void AST::test() {
 //     // literal strings must *always* be std::string, and not const char*!
-//     ShrTernaryExprPtr ternary_expression = std::make_shared<TernaryExpression>
+//     TernaryExprPtr ternary_expression = std::make_shared<TernaryExpression>
 //     (TERN,
 //         std::make_shared<LogicalExpression>(
 //             EQ,
@@ -54,75 +71,158 @@ std::string AST::parenthesize(std::string label, E... expressions) {
 //     std::cout << ast.print(ternary_expression) << std::endl;
 // }
 
-std::any AST::visit_unary_expression(ShrUnaryExprPtr expression) {
-    ShrLiteralExprPtr pre_or_postfix = std::make_shared<LiteralExpression>(
-        STR, std::string(expression->postfix ? "POST" : "PRE"));
-    return parenthesize(Token::token_type_names[expression->type], pre_or_postfix, expression->operand);
+std::any AST::visit_unary_expression(const UnaryExpression& expression) {
+    LiteralExpression pre_or_postfix(STR, std::string(expression.postfix ? "POST" : "PRE"));
+    return parenthesize(Token::token_type_names[expression.type], &pre_or_postfix, expression.operand);
 }
 
-std::any AST::visit_binary_expression(ShrBinaryExprPtr expression) {
-    return parenthesize(Token::token_type_names[expression->type], expression->l_operand, expression->r_operand);
+std::any AST::visit_binary_expression(const BinaryExpression& expression) {
+    return parenthesize(Token::token_type_names[expression.type], expression.l_operand, expression.r_operand);
 }
 
-std::any AST::visit_ternary_expression(ShrTernaryExprPtr expression) {
-    return parenthesize(Token::token_type_names[expression->type], expression->condition, expression->l_operand, expression->r_operand);
+std::any AST::visit_ternary_expression(const TernaryExpression& expression) {
+    return parenthesize(Token::token_type_names[expression.type], expression.condition, expression.l_operand, expression.r_operand);
 }
 
-std::any AST::visit_literal_expression(ShrLiteralExprPtr expression) {
-    auto value = expression->value;
-    auto type = expression->type;
-    switch (expression->type) {
+std::any AST::visit_literal_expression(const LiteralExpression& expression) {
+    switch (expression.type) {
         case STR:
         case TYPE:
         case IDENTIFIER:
-            return std::any_cast<std::string>(expression->value);
+            return expression.value.as_str();
         /* TODO: for different internal number representations,
         more cases will have to be added to this switch block */
         case NUM:
-            // never actually the case atm, bc all nums are lexed as doubles
-            try {
-                return std::to_string(std::any_cast<int>(expression->value));
-            }
-            catch (std::bad_any_cast) {
-                return std::to_string(std::any_cast<double>(expression->value));
-            }
+            if (expression.value.is_int())
+                return std::to_string(expression.value.integer);
+            return std::to_string(expression.value.floating);
         case TRUE:
         case FALSE:
-            return std::string(std::any_cast<bool>(expression->value) ? "TRUE" : "FALSE");
+            return std::string(expression.value.boolean ? "TRUE" : "FALSE");
         default:
             return std::string("unknown literal type");
     }
 }
 
-std::any AST::visit_group_expression(ShrGroupExprPtr expression) {
-    return parenthesize("GROUP", expression->expression);
+std::any AST::visit_group_expression(const GroupExpression& expression) {
+    return parenthesize("GROUP", expression.expression);
+}
+
+std::any AST::visit_variable_expression(const VariableExpression& expression) {
+    return std::string(expression.identifier.lexeme);
+}
+
+std::any AST::visit_assign_expression(const AssignExpression& expression) {
+    LiteralExpression identifier(IDENTIFIER, expression.identifier.lexeme);
+    return parenthesize("ASSIGN", &identifier, expression.expression);
+}
+
+std::any AST::visit_range_expression(const RangeExpression& expression) {
+    return parenthesize("RANGE", expression.l_operand, expression.r_operand);
+}
+
+std::any AST::visit_access_expression(const AccessExpression& expression) {
+    return parenthesize("ACCESS", expression.l_operand, expression.r_operand);
+}
+
+std::any AST::visit_call_expression(const CallExpression& expression) {
+    std::string call = "(CALL " + std::string(expression.function_name.lexeme);
+    for (ExprPtr argument : expression.arguments)
+        call += " " + print(argument);
+    return call + ")";
+}
+
+std::any AST::visit_logical_expression(const LogicalExpression& expression) {
+    return parenthesize(Token::token_type_names[expression.type], expression.l_operand, expression.r_operand);
+}
+
+std::any AST::visit_bitwise_expression(const BitwiseExpression& expression) {
+    return parenthesize(Token::token_type_names[expression.type], expression.l_operand, expression.r_operand);
+}
+
+void AST::visit_expression_statement(const ExpressionStatement& statement) {
+    print_line(print(statement.expression));
+}
+
+void AST::visit_print_statement(const PrintStatement& statement) {
+    print_line(std::format("(PRINT {})", print(statement.expression)));
+}
+
+void AST::visit_type_statement(const TypeStatement& statement) {
+    print_line(std::format("(TYPEOF {})", print(statement.expression)));
+}
+
+void AST::visit_block_statement(const BlockStatement& statement) {
+    print_line("(BLOCK");
+    depth++;
+    for (StmtPtr block_statement : statement.statements)
+        block_statement->accept(*this);
+    depth--;
+    print_line(")");
+}
+
+void AST::visit_declare_statement(const DeclareStatement& statement) {
+    std::string declaration = std::format("({} {}", statement.is_const ? "CONST" : "DECLARE", statement.identifier.lexeme);
+    if (statement.expression)
+        declaration += " " + print(statement.expression);
+    print_line(declaration + ")");
+}
+
+void AST::visit_if_statement(const IfStatement& statement) {
+    print_line(std::format("(IF {}", print(statement.expression)));
+    depth++;
+    statement.then_branch->accept(*this);
+    depth--;
+    if (statement.else_branch) {
+        print_line("ELSE");
+        depth++;
+        statement.else_branch->accept(*this);
+        depth--;
+    }
+    print_line(")");
+}
+
+void AST::visit_while_statement(const WhileStatement& statement) {
+    print_line(std::format("(WHILE {}", print(statement.expression)));
+    depth++;
+    statement.statements->accept(*this);
+    depth--;
+    print_line(")");
 }
 
-std::any AST::visit_assign_expression(ShrAssignExprPtr expression) {
-    ShrLiteralExprPtr identifier = std::make_shared<LiteralExpression>(
-        IDENTIFIER, expression->identifier.lexeme);
-    return parenthesize("ASSIGN", identifier, expression->expression);
+void AST::visit_for_statement(const ForStatement& statement) {
+    print_line("(FOR)");
 }
 
-std::any AST::visit_range_expression(ShrRangeExprPtr expression) {
-    return parenthesize("RANGE", expression->l_operand, expression->r_operand);
+void AST::visit_forin_statement(const ForInStatement& statement) {
+    print_line("(FOR IN)");
 }
 
-std::any AST::visit_access_expression(ShrAccessExprPtr expression) {
-    return parenthesize("ACCESS", expression->l_operand, expression->r_operand);
+void AST::visit_switch_statement(const SwitchStatement& statement) {
+    print_line("(SWITCH)");
 }
 
-std::any AST::visit_call_expression(ShrCallExprPtr expression) {
-    // TODO: support unpacking vector into this function call so all arguments can be printed
-    ShrLiteralExprPtr function_name = std::make_shared<LiteralExpression>(
-        IDENTIFIER, expression->function_name.lexeme);
-    return parenthesize("CALL", function_name, expression->arguments[0]);
+void AST::visit_return_statement(const ReturnStatement& statement) {
+    print_line(statement.expression ? std::format("(RETURN {})", print(statement.expression)) : "(RETURN)");
 }
 
-std::any AST::visit_logical_expression(ShrLogicalExprPtr expression) {
-    return parenthesize(Token::token_type_names[expression->type], expression->l_operand, expression->r_operand);
+void AST::visit_struct_statement(const StructStatement& statement) {
+    print_line("(STRUCT)");
 }
 
-std::any AST::visit_bitwise_expression(ShrBitwiseExprPtr expression) {
-    return parenthesize(Token::token_type_names[expression->type], expression->l_operand, expression->r_operand);
+// A body that hasn't been called yet hasn't been parsed either
+void AST::visit_function_statement(const FunctionStatement& statement) {
+    std::string function = "(FN " + std::string(statement.identifier.lexeme);
+    for (const Parameter& parameter : statement.parameters)
+        function += " " + std::string(parameter.identifier.lexeme);
+    if (!statement.is_parsed) {
+        print_line(function + " ...)");
+        return;
+    }
+    print_line(function);
+    depth++;
+    for (StmtPtr body_statement : statement.body)
+        body_statement->accept(*this);
+    depth--;
+    print_line(")");
 }
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include <stdint.h>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "value.hpp"
+
+void Chunk::write(uint8_t byte) {
+    code.push_back(byte);
+}
+
+// Operands are stored big-endian
+void Chunk::write_short(uint16_t operand) {
+    code.push_back((operand >> 8) & 0xFF);
+    code.push_back(operand & 0xFF);
+}
+
+uint16_t Chunk::read_short(size_t offset) const {
+    return (code[offset] << 8) | code[offset + 1];
+}
+
+uint32_t Chunk::add_constant(const Value& value) {
+    auto [found, inserted] = constant_indices.insert({value.key(), constants.size()});
+    if (inserted)
+        constants.push_back(value);
+    return found->second;
+}
+
+OpCode int_opcode(OpCode op) {
+    switch (op) {
+        case OP_ADD: return OP_ADD_INT;
+        case OP_SUB: return OP_SUB_INT;
+        case OP_MUL: return OP_MUL_INT;
+        case OP_LESS: return OP_LESS_INT;
+        case OP_GREATER: return OP_GREATER_INT;
+        case OP_LESS_EQ: return OP_LESS_EQ_INT;
+        case OP_GREATER_EQ: return OP_GREATER_EQ_INT;
+        case OP_NOT_EQ: return OP_NOT_EQ_INT;
+        case OP_EQ: return OP_EQ_INT;
+        default: return op;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <stdint.h>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "source.hpp"
+#include "cache.hpp"
+#include "value.hpp"
+
+namespace {
+
+constexpr uint32_t magic = 0x43414454; // "TDAC"
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;
+    uint32_t code_size;
+    uint32_t constant_count;
+    uint32_t global_count;
+    uint32_t padding;
+};
+
+template<typename T>
+void write(std::ofstream& file, T value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void write_string(std::ofstream& file, const std::string& str) {
+    write<uint32_t>(file, str.size());
+    file.write(str.data(), str.size());
+}
+
+// Bounds-checked reads over the mapped file
+struct Reader {
+    std::string_view data;
+    size_t offset = 0;
+
+    size_t remaining() const {
+        return data.size() - offset;
+    }
+
+    template<typename T>
+    bool read(T& value) {
+        if (data.size() - offset < sizeof(T))
+            return false;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    bool read_bytes(size_t size, std::string_view& bytes) {
+        if (data.size() - offset < size)
+            return false;
+        bytes = data.substr(offset, size);
+        offset += size;
+        return true;
+    }
+
+    bool read_string(std::string_view& str) {
+        uint32_t size;
+        return read(size) && read_bytes(size, str);
+    }
+};
+
+}
+
+uint64_t Cache::hash(std::string_view src) {
+    uint64_t hash = 0xCBF29CE484222325;
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 0x100000001B3;
+    };
+    for (size_t i = 0; i < sizeof(version); i++)
+        mix(static_cast<unsigned char>(version >> (i * 8)));
+    for (char c : src)
+        mix(static_cast<unsigned char>(c));
+    return hash;
+}
+
+std::string Cache::path_for(const std::string& source_path) {
+    if (source_path.ends_with(".tda"))
+        return source_path + "c";
+    return source_path + ".tdac";
+}
+
+bool Cache::save(const std::string& path, uint64_t hash, const Chunk& chunk) {
+    // Written next to the cache and renamed over it, so a reader never sees half a file
+    std::string temp_path = path + ".tmp";
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    write(file, Header{magic, version, hash, static_cast<uint32_t>(chunk.code.size()),
+        static_cast<uint32_t>(chunk.constants.size()), static_cast<uint32_t>(chunk.global_names.size()), 0});
+    file.write(reinterpret_cast<const char*>(chunk.code.data()), chunk.code.size());
+    for (const Value& constant : chunk.constants) {
+        write(file, constant.type);
+        switch (constant.type) {
+            case LiteralType::STR: write_string(file, constant.as_str()); break;
+            case LiteralType::VOID: break;
+            // Every other tag is stored inline in the union
+            default: write(file, constant.integer); break;
+        }
+    }
+    for (const std::string& name : chunk.global_names)
+        write_string(file, name);
+
+    file.close();
+    if (!file || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Cache::load(const std::string& path, uint64_t hash, Chunk& chunk) {
+    Source source;
+    if (!source.load(path))
+        return false;
+
+    Reader reader{source.text()};
+    Header header;
+    if (!reader.read(header) || header.magic != magic || header.version != version || header.hash != hash)
+        return false;
+
+    Chunk loaded;
+    std::string_view code;
+    if (!reader.read_bytes(header.code_size, code))
+        return false;
+    loaded.code.assign(code.begin(), code.end());
+
+    // Every entry takes at least a byte, so counts past what's left are corrupt, and mustn't be reserved
+    if (header.constant_count > reader.remaining())
+        return false;
+    loaded.constants.reserve(header.constant_count);
+    for (uint32_t i = 0; i < header.constant_count; i++) {
+        LiteralType type;
+        if (!reader.read(type))
+            return false;
+        if (type == LiteralType::STR) {
+            std::string_view str;
+            if (!reader.read_string(str))
+                return false;
+            loaded.constants.push_back(Value(str));
+        }
+        else if (type == LiteralType::VOID)
+            loaded.constants.push_back(Value());
+        else {
+            Value constant;
+            if (type > LiteralType::VOID || !reader.read(constant.integer))
+                return false;
+            constant.type = type;
+            loaded.constants.push_back(constant);
+        }
+    }
+
+    if (header.global_count > reader.remaining())
+        return false;
+    loaded.global_names.reserve(header.global_count);
+    for (uint32_t i = 0; i < header.global_count; i++) {
+        std::string_view name;
+        if (!reader.read_string(name))
+            return false;
+        loaded.global_names.push_back(std::string(name));
+    }
+
+    if (reader.offset != reader.data.size())
+        return false;
+    chunk = std::move(loaded);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,405 @@
+#include <iostream>
+#include <format>
+#include <memory>
+#include <span>
+#include <vector>
+#include <any>
+
+#include "closure.hpp"
+#include "interpreter.hpp"
+#include "typechecker.hpp"
+#include "environment.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "value.hpp"
+#include "token.hpp"
+#include "tilda.hpp"
+
+ClosureCompiler::ClosureCompiler(Interpreter& interpreter) : interpreter(interpreter) {}
+
+void ClosureCompiler::run(std::span<const StmtPtr> statements) {
+    // Same as Interpreter::interpret
+    interpreter.environment.reset();
+    interpreter.call_depth = 0;
+    interpreter.is_returning = false;
+    std::vector<Exec> program = compile(statements);
+    for (const Exec& statement : program) {
+        if (!Tilda::had_error && !Tilda::had_runtime_error)
+            statement();
+    }
+}
+
+ClosureCompiler::Eval ClosureCompiler::compile(ExprPtr expression) {
+    return std::any_cast<Eval>(expression->accept(*this));
+}
+
+ClosureCompiler::Exec ClosureCompiler::compile(StmtPtr statement) {
+    statement->accept(*this);
+    return std::move(compiled);
+}
+
+std::vector<ClosureCompiler::Exec> ClosureCompiler::compile(std::span<const StmtPtr> statements) {
+    std::vector<Exec> execs;
+    execs.reserve(statements.size());
+    for (StmtPtr statement : statements)
+        execs.push_back(compile(statement));
+    return execs;
+}
+
+// A bool condition is tested as is, anything else goes through get_truthiness
+ClosureCompiler::Test ClosureCompiler::compile_condition(ExprPtr expression) {
+    Eval closure = compile(expression);
+    if (expression->static_type == LiteralType::BOOL)
+        return [closure = std::move(closure)] { return closure().boolean; };
+    return [closure = std::move(closure)] { return Interpreter::get_truthiness(closure()); };
+}
+
+/* Same operations as the Interpreter's specialized handlers, but chosen
+once at compile time, from the types the Typechecker proved, and bound to
+their operands' closures. Operands are evaluated left to right first */
+#define UNARY_CLOSURE(result) \
+    return Eval([closure = std::move(closure), type]() -> Value { Value operand = closure(); return result; })
+#define BINARY_CLOSURE(result) \
+    return Eval([l_closure = std::move(l_closure), r_closure = std::move(r_closure), type]() -> Value { \
+        Value l_operand = l_closure(); \
+        Value r_operand = r_closure(); \
+        return result; \
+    })
+
+std::any ClosureCompiler::visit_unary_expression(const UnaryExpression& expression) {
+    Eval closure = compile(expression.operand);
+    TokenType type = expression.type;
+    switch (expression.operand->static_type) {
+        case LiteralType::I64:
+            switch (type) {
+                case NEG: UNARY_CLOSURE(Value::wrapping_neg(operand.integer));
+                case L_NOT: UNARY_CLOSURE(operand.integer == 0);
+                case B_NOT: UNARY_CLOSURE(~operand.integer);
+                case INC: UNARY_CLOSURE(Value::wrapping_add(operand.integer, 1));
+                case DEC: UNARY_CLOSURE(Value::wrapping_sub(operand.integer, 1));
+                default: break;
+            }
+            break;
+        case LiteralType::F64:
+            switch (type) {
+                case NEG: UNARY_CLOSURE(-operand.floating);
+                case L_NOT: UNARY_CLOSURE(operand.floating == 0);
+                case INC: UNARY_CLOSURE(operand.floating + 1);
+                case DEC: UNARY_CLOSURE(operand.floating - 1);
+                default: break;
+            }
+            break;
+        case LiteralType::BOOL:
+            if (type == L_NOT)
+                UNARY_CLOSURE(!operand.boolean);
+            break;
+        default: break;
+    }
+    UNARY_CLOSURE(Interpreter::apply_unary(type, operand));
+}
+
+std::any ClosureCompiler::visit_binary_expression(const BinaryExpression& expression) {
+    Eval l_closure = compile(expression.l_operand);
+    Eval r_closure = compile(expression.r_operand);
+    TokenType type = expression.type;
+    switch (Value::type_pair(expression.l_operand->static_type, expression.r_operand->static_type)) {
+        case Value::type_pair(LiteralType::I64, LiteralType::I64):
+            switch (type) {
+                case GREATER: BINARY_CLOSURE(l_operand.integer > r_operand.integer);
+                case GREATER_EQ: BINARY_CLOSURE(l_operand.integer >= r_operand.integer);
+                case LESS: BINARY_CLOSURE(l_operand.integer < r_operand.integer);
+                case LESS_EQ: BINARY_CLOSURE(l_operand.integer <= r_operand.integer);
+                case EQ: BINARY_CLOSURE(l_operand.integer == r_operand.integer);
+                case NOT_EQ: BINARY_CLOSURE(l_operand.integer != r_operand.integer);
+                case ADD: BINARY_CLOSURE(Value::wrapping_add(l_operand.integer, r_operand.integer));
+                case SUB: BINARY_CLOSURE(Value::wrapping_sub(l_operand.integer, r_operand.integer));
+                case MUL: BINARY_CLOSURE(Value::wrapping_mul(l_operand.integer, r_operand.integer));
+                default: break;
+            }
+            break;
+        case Value::type_pair(LiteralType::F64, LiteralType::F64):
+            switch (type) {
+                case GREATER: BINARY_CLOSURE(l_operand.floating > r_operand.floating);
+                case GREATER_EQ: BINARY_CLOSURE(l_operand.floating >= r_operand.floating);
+                case LESS: BINARY_CLOSURE(l_operand.floating < r_operand.floating);
+                case LESS_EQ: BINARY_CLOSURE(l_operand.floating <= r_operand.floating);
+                case EQ: BINARY_CLOSURE(l_operand.floating == r_operand.floating);
+                case NOT_EQ: BINARY_CLOSURE(l_operand.floating != r_operand.floating);
+                case ADD: BINARY_CLOSURE(l_operand.floating + r_operand.floating);
+                case SUB: BINARY_CLOSURE(l_operand.floating - r_operand.floating);
+                case MUL: BINARY_CLOSURE(l_operand.floating * r_operand.floating);
+                case DIV: BINARY_CLOSURE(l_operand.floating / r_operand.floating);
+                default: break;
+            }
+            break;
+        case Value::type_pair(LiteralType::STR, LiteralType::STR):
+            switch (type) {
+                case EQ: BINARY_CLOSURE(l_operand.as_str() == r_operand.as_str());
+                case NOT_EQ: BINARY_CLOSURE(l_operand.as_str() != r_operand.as_str());
+                case ADD: BINARY_CLOSURE(l_operand.as_str() + r_operand.as_str());
+                default: break;
+            }
+            break;
+        case Value::type_pair(LiteralType::BOOL, LiteralType::BOOL):
+            switch (type) {
+                case EQ: BINARY_CLOSURE(l_operand.boolean == r_operand.boolean);
+                case NOT_EQ: BINARY_CLOSURE(l_operand.boolean != r_operand.boolean);
+                default: break;
+            }
+            break;
+    }
+    BINARY_CLOSURE(Interpreter::apply_binary(type, l_operand, r_operand));
+}
+
+std::any ClosureCompiler::visit_ternary_expression(const TernaryExpression& expression) {
+    Test condition = compile_condition(expression.condition);
+    Eval l_closure = compile(expression.l_operand);
+    Eval r_closure = compile(expression.r_operand);
+    return Eval([condition = std::move(condition), l_closure = std::move(l_closure), r_closure = std::move(r_closure)] {
+        return condition() ? l_closure() : r_closure();
+    });
+}
+
+std::any ClosureCompiler::visit_literal_expression(const LiteralExpression& expression) {
+    return Eval([value = expression.value] { return value; });
+}
+
+// A group has nothing to do at runtime, so it's just its expression's closure
+std::any ClosureCompiler::visit_group_expression(const GroupExpression& expression) {
+    return compile(expression.expression);
+}
+
+// Only globals can be used before they're defined (i.e. by a function), locals skip the check
+std::any ClosureCompiler::visit_variable_expression(const VariableExpression& expression) {
+    Environment& environment = interpreter.environment;
+    int depth = expression.depth, slot = expression.slot;
+    if (depth >= 0)
+        return Eval([&environment, depth, slot] { return environment.get(depth, slot); });
+    return Eval([&environment, &expression, depth, slot] {
+        if (!environment.is_defined(depth, slot))
+            Interpreter::throw_error(std::format("Undefined variable: \"{}\".", expression.identifier.lexeme));
+        return environment.get(depth, slot);
+    });
+}
+
+std::any ClosureCompiler::visit_assign_expression(const AssignExpression& expression) {
+    Environment& environment = interpreter.environment;
+    Eval closure = compile(expression.expression);
+    int depth = expression.depth, slot = expression.slot;
+    if (depth >= 0 && expression.checked_type == LiteralType::VOID) {
+        return Eval([&environment, closure = std::move(closure), depth, slot] {
+            Value value = closure();
+            environment.assign(depth, slot, value);
+            return value;
+        });
+    }
+    return Eval([&environment, &expression, closure = std::move(closure), depth, slot] {
+        Value value = closure();
+        if (!environment.is_defined(depth, slot))
+            Interpreter::throw_error(std::format("Undefined variable: \"{}\".", expression.identifier.lexeme));
+        if (expression.checked_type != LiteralType::VOID)
+            Interpreter::check_type(expression.checked_type, value);
+        environment.assign(depth, slot, value);
+        return value;
+    });
+}
+
+std::any ClosureCompiler::visit_range_expression(const RangeExpression& expression) {
+    return Eval([] { return Value(); });
+}
+
+std::any ClosureCompiler::visit_access_expression(const AccessExpression& expression) {
+    return Eval([] { return Value(); });
+}
+
+/* The body is compiled on the first call from any call site, after the
+Interpreter has parsed, resolved, typechecked and optimized it, the same
+as the Interpreter would on its first call */
+std::any ClosureCompiler::visit_call_expression(const CallExpression& expression) {
+    const FunctionStatement& function = *expression.function;
+    std::unique_ptr<Body>& body = bodies[&function];
+    if (!body)
+        body = std::make_unique<Body>();
+
+    std::vector<Eval> arguments;
+    std::vector<LiteralType> types;
+    for (size_t i = 0; i < expression.arguments.size(); i++) {
+        arguments.push_back(compile(expression.arguments[i]));
+        types.push_back(Typechecker::runtime_type(function.parameters[i].type));
+    }
+
+    return Eval([this, &function, body = body.get(), arguments = std::move(arguments), types = std::move(types)] {
+        if (!body->is_compiled) {
+            interpreter.prepare_body(function);
+            body->statements = compile(function.body);
+            body->is_compiled = true;
+        }
+        if (interpreter.call_depth == Interpreter::max_call_depth)
+            Interpreter::throw_error(std::format("Stack overflow in \"{}\".", function.identifier.lexeme));
+
+        Environment& environment = interpreter.environment;
+        for (size_t i = 0; i < arguments.size(); i++) {
+            Value argument = arguments[i]();
+            if (types[i] != LiteralType::VOID)
+                Interpreter::check_type(types[i], argument);
+            environment.push(std::move(argument));
+        }
+        environment.push_scope(arguments.size());
+        interpreter.call_depth++;
+        for (const Exec& statement : body->statements) {
+            statement();
+            if (interpreter.is_returning)
+                break;
+        }
+        interpreter.call_depth--;
+        environment.pop_scope();
+
+        Value result = std::move(interpreter.return_value);
+        interpreter.return_value = Value();
+        interpreter.is_returning = false;
+        return result;
+    });
+}
+
+std::any ClosureCompiler::visit_logical_expression(const LogicalExpression& expression) {
+    Eval l_closure = compile(expression.l_operand);
+    Eval r_closure = compile(expression.r_operand);
+    TokenType type = expression.type;
+    if (expression.l_operand->static_type == LiteralType::BOOL && expression.r_operand->static_type == LiteralType::BOOL) {
+        switch (type) {
+            case L_OR: BINARY_CLOSURE(l_operand.boolean || r_operand.boolean);
+            case L_AND: BINARY_CLOSURE(l_operand.boolean && r_operand.boolean);
+            case L_XOR: BINARY_CLOSURE(l_operand.boolean != r_operand.boolean);
+            default: break;
+        }
+    }
+    BINARY_CLOSURE(Interpreter::apply_logical(type, l_operand, r_operand));
+}
+
+std::any ClosureCompiler::visit_bitwise_expression(const BitwiseExpression& expression) {
+    Eval l_closure = compile(expression.l_operand);
+    Eval r_closure = compile(expression.r_operand);
+    TokenType type = expression.type;
+    if (expression.l_operand->static_type == LiteralType::I64 && expression.r_operand->static_type == LiteralType::I64) {
+        switch (type) {
+            case B_OR: BINARY_CLOSURE(l_operand.integer | r_operand.integer);
+            case B_AND: BINARY_CLOSURE(l_operand.integer & r_operand.integer);
+            case B_XOR: BINARY_CLOSURE(l_operand.integer ^ r_operand.integer);
+            case LSHFT: BINARY_CLOSURE(Value::shift_left(l_operand.integer, r_operand.integer));
+            case RSHFT: BINARY_CLOSURE(Value::shift_right(l_operand.integer, r_operand.integer));
+            case CHK: BINARY_CLOSURE(Value::shift_right(l_operand.integer, r_operand.integer) & 1);
+            default: break;
+        }
+    }
+    BINARY_CLOSURE(Interpreter::apply_bitwise(type, l_operand, r_operand));
+}
+
+#undef UNARY_CLOSURE
+#undef BINARY_CLOSURE
+
+void ClosureCompiler::visit_expression_statement(const ExpressionStatement& statement) {
+    compiled = [closure = compile(statement.expression)] { closure(); };
+}
+
+void ClosureCompiler::visit_print_statement(const PrintStatement& statement) {
+    compiled = [closure = compile(statement.expression)] {
+        std::cout << Interpreter::to_string(closure()) << std::endl;
+    };
+}
+
+void ClosureCompiler::visit_type_statement(const TypeStatement& statement) {
+    compiled = [closure = compile(statement.expression)] {
+        std::cout << std::format("Type: {}", Interpreter::get_type(closure())) << std::endl;
+    };
+}
+
+void ClosureCompiler::visit_block_statement(const BlockStatement& statement) {
+    compiled = [&interpreter = interpreter, statements = compile(statement.statements)] {
+        interpreter.environment.push_scope();
+        for (const Exec& block_statement : statements) {
+            if (interpreter.is_returning)
+                break;
+            if (!Tilda::had_error && !Tilda::had_runtime_error)
+                block_statement();
+        }
+        interpreter.environment.pop_scope();
+    };
+}
+
+void ClosureCompiler::visit_declare_statement(const DeclareStatement& statement) {
+    Eval closure;
+    if (statement.expression)
+        closure = compile(statement.expression);
+    compiled = [&environment = interpreter.environment, &statement, closure = std::move(closure)] {
+        Value value;
+        try {
+            if (closure)
+                value = closure();
+            if (statement.checked_type != LiteralType::VOID)
+                Interpreter::check_type(statement.checked_type, value);
+        }
+        catch (std::string message) {
+            // Same as Interpreter::visit_declare_statement
+            if (!statement.is_redeclaration)
+                environment.define(statement.slot, Value());
+            throw;
+        }
+        if (!statement.is_redeclaration)
+            environment.define(statement.slot, value);
+    };
+}
+
+void ClosureCompiler::visit_if_statement(const IfStatement& statement) {
+    Test condition = compile_condition(statement.expression);
+    Exec then_branch = compile(statement.then_branch);
+    Exec else_branch;
+    if (statement.else_branch)
+        else_branch = compile(statement.else_branch);
+    compiled = [condition = std::move(condition), then_branch = std::move(then_branch), else_branch = std::move(else_branch)] {
+        if (condition())
+            then_branch();
+        else if (else_branch)
+            else_branch();
+    };
+}
+
+void ClosureCompiler::visit_while_statement(const WhileStatement& statement) {
+    Test condition = compile_condition(statement.expression);
+    Exec body = compile(statement.statements);
+    compiled = [&interpreter = interpreter, condition = std::move(condition), body = std::move(body)] {
+        while (!interpreter.is_returning && condition())
+            body();
+    };
+}
+
+void ClosureCompiler::visit_for_statement(const ForStatement& statement) {
+    compiled = [] {};
+}
+
+void ClosureCompiler::visit_forin_statement(const ForInStatement& statement) {
+    compiled = [] {};
+}
+
+void ClosureCompiler::visit_switch_statement(const SwitchStatement& statement) {
+    compiled = [] {};
+}
+
+void ClosureCompiler::visit_return_statement(const ReturnStatement& statement) {
+    Eval closure;
+    if (statement.expression)
+        closure = compile(statement.expression);
+    compiled = [&interpreter = interpreter, closure = std::move(closure)] {
+        if (closure)
+            interpreter.return_value = closure();
+        interpreter.is_returning = true;
+    };
+}
+
+void ClosureCompiler::visit_struct_statement(const StructStatement& statement) {
+    compiled = [] {};
+}
+
+// Like the Interpreter, declaring a function does nothing, its body is compiled on the first call
+void ClosureCompiler::visit_function_statement(const FunctionStatement& statement) {
+    compiled = [] {};
+}
\ No newline at end of file
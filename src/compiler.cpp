@@ -0,0 +1,330 @@
+#include <stdint.h>
+#include <format>
+#include <string>
+#include <vector>
+#include <any>
+
+#include "interpreter.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "compiler.hpp"
+#include "bytecode.hpp"
+#include "tilda.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+Chunk Compiler::compile(std::span<const StmtPtr> statements) {
+    chunk = Chunk();
+    locals.clear();
+    scope_depth = 0;
+
+    for (StmtPtr statement : statements)
+        compile(statement);
+    emit(OP_RETURN);
+
+    chunk.global_names = global_names;
+    return chunk;
+}
+
+void Compiler::compile(ExprPtr expression) {
+    expression->accept(*this);
+}
+
+void Compiler::compile(StmtPtr statement) {
+    statement->accept(*this);
+}
+
+void Compiler::emit(uint8_t byte) {
+    chunk.write(byte);
+}
+
+void Compiler::emit(OpCode op, uint16_t operand) {
+    chunk.write(op);
+    chunk.write_short(operand);
+}
+
+void Compiler::emit_constant(Value value) {
+    uint32_t index = chunk.add_constant(value);
+    if (index > UINT16_MAX)
+        throw_error("Too many constants in one program.");
+    emit(OP_CONSTANT, index);
+}
+
+// Emits a jump with a placeholder offset, to be filled in by patch_jump()
+size_t Compiler::emit_jump(OpCode op) {
+    emit(op, 0xFFFF);
+    return chunk.code.size() - 2;
+}
+
+void Compiler::patch_jump(size_t offset) {
+    // -2 to account for the jump's own operand
+    size_t jump = chunk.code.size() - offset - 2;
+    if (jump > UINT16_MAX)
+        throw_error("Too much code to jump over.");
+    chunk.code[offset] = (jump >> 8) & 0xFF;
+    chunk.code[offset + 1] = jump & 0xFF;
+}
+
+void Compiler::emit_loop(size_t loop_start) {
+    // +3 to account for the OP_LOOP instruction itself
+    size_t offset = chunk.code.size() - loop_start + 3;
+    if (offset > UINT16_MAX)
+        throw_error("Loop body too large.");
+    emit(OP_LOOP, offset);
+}
+
+void Compiler::begin_scope() {
+    scope_depth++;
+}
+
+void Compiler::end_scope() {
+    scope_depth--;
+    // Locals live on the VM stack, so leaving a scope pops them off
+    while (!locals.empty() && locals.back().depth > scope_depth) {
+        emit(OP_POP);
+        locals.pop_back();
+    }
+}
+
+int Compiler::resolve_local(std::string_view identifier) {
+    for (int i = locals.size() - 1; i >= 0; i--) {
+        if (locals[i].identifier == identifier)
+            return i;
+    }
+    return -1;
+}
+
+uint16_t Compiler::resolve_global(std::string_view identifier) {
+    auto found_global = global_slots.find(identifier);
+    if (found_global != global_slots.end())
+        return found_global->second;
+
+    if (global_names.size() > UINT16_MAX)
+        throw_error("Too many global variables.");
+    global_names.push_back(std::string(identifier));
+    global_slots.insert({global_names.back(), global_names.size() - 1});
+    return global_names.size() - 1;
+}
+
+void Compiler::throw_error(std::string message) {
+    Tilda::had_error = true;
+    throw std::format("Compile Error: {}", message);
+}
+
+std::any Compiler::visit_unary_expression(const UnaryExpression& expression) {
+    compile(expression.operand);
+    switch (expression.type) {
+        case NEG: emit(OP_NEG); break;
+        case L_NOT: emit(OP_L_NOT); break;
+        case B_NOT: emit(OP_B_NOT); break;
+        case INC: emit(OP_INC); break;
+        case DEC: emit(OP_DEC); break;
+        default: break;
+    }
+    return std::any();
+}
+
+std::any Compiler::visit_binary_expression(const BinaryExpression& expression) {
+    compile(expression.l_operand);
+    compile(expression.r_operand);
+    OpCode op;
+    switch (expression.type) {
+        case GREATER: op = OP_GREATER; break;
+        case GREATER_EQ: op = OP_GREATER_EQ; break;
+        case LESS: op = OP_LESS; break;
+        case LESS_EQ: op = OP_LESS_EQ; break;
+        case EQ: op = OP_EQ; break;
+        case NOT_EQ: op = OP_NOT_EQ; break;
+        case ADD: op = OP_ADD; break;
+        case SUB: op = OP_SUB; break;
+        case MUL: op = OP_MUL; break;
+        case DIV: op = OP_DIV; break;
+        case POW: op = OP_POW; break;
+        case MOD: op = OP_MOD; break;
+        default: return std::any();
+    }
+    if (expression.l_operand->static_type == LiteralType::I64 && expression.r_operand->static_type == LiteralType::I64)
+        op = int_opcode(op);
+    emit(op);
+    return std::any();
+}
+
+std::any Compiler::visit_ternary_expression(const TernaryExpression& expression) {
+    compile(expression.condition);
+    size_t else_jump = emit_jump(OP_JUMP_IF_FALSE);
+    compile(expression.l_operand);
+    size_t end_jump = emit_jump(OP_JUMP);
+    patch_jump(else_jump);
+    compile(expression.r_operand);
+    patch_jump(end_jump);
+    return std::any();
+}
+
+std::any Compiler::visit_literal_expression(const LiteralExpression& expression) {
+    emit_constant(expression.value);
+    return std::any();
+}
+
+std::any Compiler::visit_group_expression(const GroupExpression& expression) {
+    compile(expression.expression);
+    return std::any();
+}
+
+std::any Compiler::visit_variable_expression(const VariableExpression& expression) {
+    int slot = resolve_local(expression.identifier.lexeme);
+    if (slot != -1)
+        emit(OP_GET_LOCAL, slot);
+    else
+        emit(OP_GET_GLOBAL, resolve_global(expression.identifier.lexeme));
+    return std::any();
+}
+
+std::any Compiler::visit_assign_expression(const AssignExpression& expression) {
+    compile(expression.expression);
+    if (expression.checked_type != LiteralType::VOID)
+        emit(OP_CHECK_TYPE, static_cast<uint16_t>(expression.checked_type));
+    int slot = resolve_local(expression.identifier.lexeme);
+    if (slot != -1)
+        emit(OP_SET_LOCAL, slot);
+    else
+        emit(OP_SET_GLOBAL, resolve_global(expression.identifier.lexeme));
+    return std::any();
+}
+
+std::any Compiler::visit_range_expression(const RangeExpression& expression) {
+    throw_error("Ranges are not supported yet.");
+    return std::any();
+}
+
+std::any Compiler::visit_access_expression(const AccessExpression& expression) {
+    throw_error("Member access is not supported yet.");
+    return std::any();
+}
+
+std::any Compiler::visit_call_expression(const CallExpression& expression) {
+    throw_error("Function calls are not supported yet.");
+    return std::any();
+}
+
+std::any Compiler::visit_logical_expression(const LogicalExpression& expression) {
+    // Both operands are always evaluated, same as the Interpreter
+    compile(expression.l_operand);
+    compile(expression.r_operand);
+    switch (expression.type) {
+        case L_OR: emit(OP_L_OR); break;
+        case L_AND: emit(OP_L_AND); break;
+        case L_XOR: emit(OP_L_XOR); break;
+        default: break;
+    }
+    return std::any();
+}
+
+std::any Compiler::visit_bitwise_expression(const BitwiseExpression& expression) {
+    compile(expression.l_operand);
+    compile(expression.r_operand);
+    switch (expression.type) {
+        case B_OR: emit(OP_B_OR); break;
+        case B_AND: emit(OP_B_AND); break;
+        case B_XOR: emit(OP_B_XOR); break;
+        case LSHFT: emit(OP_LSHFT); break;
+        case RSHFT: emit(OP_RSHFT); break;
+        case CHK: emit(OP_CHK); break;
+        default: break;
+    }
+    return std::any();
+}
+
+void Compiler::visit_expression_statement(const ExpressionStatement& statement) {
+    compile(statement.expression);
+    emit(OP_POP);
+}
+
+void Compiler::visit_print_statement(const PrintStatement& statement) {
+    compile(statement.expression);
+    emit(OP_PRINT);
+}
+
+void Compiler::visit_type_statement(const TypeStatement& statement) {
+    compile(statement.expression);
+    emit(OP_TYPEOF);
+}
+
+void Compiler::visit_block_statement(const BlockStatement& statement) {
+    begin_scope();
+    for (StmtPtr block_statement : statement.statements)
+        compile(block_statement);
+    end_scope();
+}
+
+void Compiler::visit_declare_statement(const DeclareStatement& statement) {
+    if (statement.expression)
+        compile(statement.expression);
+    else
+        emit(OP_VOID);
+    if (statement.checked_type != LiteralType::VOID)
+        emit(OP_CHECK_TYPE, static_cast<uint16_t>(statement.checked_type));
+
+    if (scope_depth == 0) {
+        emit(OP_DEFINE_GLOBAL, resolve_global(statement.identifier.lexeme));
+        return;
+    }
+
+    /* Redeclaring a variable in the same scope keeps the
+    original value (Environment::define doesn't overwrite),
+    so the initializer is evaluated and then discarded */
+    int slot = resolve_local(statement.identifier.lexeme);
+    if (slot != -1 && locals[slot].depth == scope_depth) {
+        emit(OP_POP);
+        return;
+    }
+    if (locals.size() > UINT16_MAX)
+        throw_error("Too many local variables.");
+    locals.push_back({statement.identifier.lexeme, scope_depth});
+}
+
+void Compiler::visit_if_statement(const IfStatement& statement) {
+    compile(statement.expression);
+    size_t else_jump = emit_jump(OP_JUMP_IF_FALSE);
+    compile(statement.then_branch);
+    if (statement.else_branch) {
+        size_t end_jump = emit_jump(OP_JUMP);
+        patch_jump(else_jump);
+        compile(statement.else_branch);
+        patch_jump(end_jump);
+    }
+    else
+        patch_jump(else_jump);
+}
+
+void Compiler::visit_while_statement(const WhileStatement& statement) {
+    size_t loop_start = chunk.code.size();
+    compile(statement.expression);
+    size_t exit_jump = emit_jump(OP_JUMP_IF_FALSE);
+    compile(statement.statements);
+    emit_loop(loop_start);
+    patch_jump(exit_jump);
+}
+
+void Compiler::visit_for_statement(const ForStatement& statement) {
+    throw_error("\"for\" statements are desugared by the parser.");
+}
+
+void Compiler::visit_forin_statement(const ForInStatement& statement) {
+    throw_error("\"for in\" statements are not supported yet.");
+}
+
+void Compiler::visit_switch_statement(const SwitchStatement& statement) {
+    throw_error("\"switch\" statements are not supported yet.");
+}
+
+void Compiler::visit_return_statement(const ReturnStatement& statement) {
+    throw_error("\"return\" statements are not supported yet.");
+}
+
+void Compiler::visit_struct_statement(const StructStatement& statement) {
+    throw_error("Structs are not supported yet.");
+}
+
+void Compiler::visit_function_statement(const FunctionStatement& statement) {
+    throw_error("Functions are not supported yet.");
+}
\ No newline at end of file
@@ -1,52 +1,61 @@
-#include <iostream>
-#include <memory>
-#include <format>
-#include <string>
-#include <any>
-#include <map>
+#include <stdint.h>
+#include <vector>
 
 #include "environment.hpp"
-#include "tilda.hpp"
+#include "value.hpp"
 
-Environment::Environment() {
-    enclosing = nullptr;
+size_t Environment::index(int depth, int slot) {
+    if (depth < 0)
+        return slot;
+    return scopes[scopes.size() - 1 - depth] + slot;
 }
 
-Environment::Environment(std::shared_ptr<Environment> enclosing) :
-    enclosing(enclosing) {}
+void Environment::push_scope(size_t arguments) {
+    if (scopes.size() == scopes.capacity())
+        allocations++;
+    scopes.push_back(values.size() - arguments);
+}
 
-void Environment::throw_error(std::string message) {
-    Tilda::had_runtime_error = true;
-    throw message;
+void Environment::push(Value value) {
+    if (values.size() == values.capacity())
+        allocations++;
+    values.push_back(std::move(value));
 }
 
-void Environment::define(std::string identifier, std::any value) {
-    values.insert({identifier, value});
+void Environment::pop_scope() {
+    values.resize(scopes.back());
+    scopes.pop_back();
 }
 
-void Environment::assign(std::string identifier, std::any value) {
-    if (!values.count(identifier)) {
-        if (enclosing != nullptr)
-            enclosing->assign(identifier, value);
-        else
-            throw_error(std::format("Undefined variable: \"{}\".", identifier));
+// Drops every scope but the global one (i.e. after an error in the REPL)
+void Environment::reset() {
+    while (scopes.size() > 1)
+        pop_scope();
+    // And any arguments of a call that never happened
+    values.resize(globals);
+}
 
-        return;
+// Only ever called on the innermost scope, which is at the top of the stack
+void Environment::define(int slot, Value value) {
+    size_t i = index(0, slot);
+    if (i >= values.size()) {
+        if (i >= values.capacity())
+            allocations++;
+        values.resize(i + 1);
     }
+    values[i] = value;
+    if (scopes.size() == 1 && i >= globals)
+        globals = i + 1;
+}
 
-    values[identifier] = value;
+void Environment::assign(int depth, int slot, Value value) {
+    values[index(depth, slot)] = value;
 }
 
-std::any Environment::get(std::string identifier) {
-    // Check to make sure variable is defined
-    if (!values.count(identifier)) {
-        if (enclosing != nullptr)
-            return enclosing->get(identifier);
-        else {
-            throw_error(std::format("Undefined variable: \"{}\".", identifier));
-            return std::any(); // NULL std::any
-        }
-    }
+Value Environment::get(int depth, int slot) {
+    return values[index(depth, slot)];
+}
 
-    return values[identifier];
+bool Environment::is_defined(int depth, int slot) {
+    return depth >= 0 || static_cast<size_t>(slot) < globals;
 }
\ No newline at end of file
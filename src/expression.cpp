@@ -1,86 +1,134 @@
 #include "expression.hpp"
 #include <any>
 
-UnaryExpression::UnaryExpression(TokenType type, ShrExprPtr operand, bool postfix) :
+UnaryExpression::UnaryExpression(TokenType type, ExprPtr operand, bool postfix) :
     type(type), operand(operand), postfix(postfix) {}
 
-std::any UnaryExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_unary_expression(shared_from_this());
+std::any UnaryExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_unary_expression(*this);
 }
 
-BinaryExpression::BinaryExpression(TokenType type, ShrExprPtr l_operand, ShrExprPtr r_operand) :
+Value UnaryExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_unary_expression(*this);
+}
+
+BinaryExpression::BinaryExpression(TokenType type, ExprPtr l_operand, ExprPtr r_operand) :
     type(type), l_operand(l_operand), r_operand(r_operand) {}
 
-std::any BinaryExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_binary_expression(shared_from_this());
+std::any BinaryExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_binary_expression(*this);
+}
+
+Value BinaryExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_binary_expression(*this);
 }
 
-TernaryExpression::TernaryExpression(TokenType type, ShrExprPtr condition, ShrExprPtr l_operand, ShrExprPtr r_operand) :
+TernaryExpression::TernaryExpression(TokenType type, ExprPtr condition, ExprPtr l_operand, ExprPtr r_operand) :
     type(type), condition(condition), l_operand(l_operand), r_operand(r_operand) {}
 
-std::any TernaryExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_ternary_expression(shared_from_this());
+std::any TernaryExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_ternary_expression(*this);
+}
+
+Value TernaryExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_ternary_expression(*this);
 }
 
-LiteralExpression::LiteralExpression(TokenType type, std::any value) :
+LiteralExpression::LiteralExpression(TokenType type, Value value) :
     type(type), value(value) {}
 
-std::any LiteralExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_literal_expression(shared_from_this());
+std::any LiteralExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_literal_expression(*this);
 }
 
-GroupExpression::GroupExpression(ShrExprPtr expression) :
+Value LiteralExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_literal_expression(*this);
+}
+
+GroupExpression::GroupExpression(ExprPtr expression) :
     expression(expression) {}
 
-std::any GroupExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_group_expression(shared_from_this());
+std::any GroupExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_group_expression(*this);
+}
+
+Value GroupExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_group_expression(*this);
 }
 
 VariableExpression::VariableExpression(Token identifier) :
     identifier(identifier) {}
 
-std::any VariableExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_variable_expression(shared_from_this());
+std::any VariableExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_variable_expression(*this);
+}
+
+Value VariableExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_variable_expression(*this);
 }
 
-AssignExpression::AssignExpression(Token identifier, ShrExprPtr expression) :
+AssignExpression::AssignExpression(Token identifier, ExprPtr expression) :
     identifier(identifier), expression(expression) {}
 
-std::any AssignExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_assign_expression(shared_from_this());
+std::any AssignExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_assign_expression(*this);
 }
 
-RangeExpression::RangeExpression(ShrExprPtr l_operand, ShrExprPtr r_operand) :
+Value AssignExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_assign_expression(*this);
+}
+
+RangeExpression::RangeExpression(ExprPtr l_operand, ExprPtr r_operand) :
     l_operand(l_operand), r_operand(r_operand) {}
 
-std::any RangeExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_range_expression(shared_from_this());
+std::any RangeExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_range_expression(*this);
+}
+
+Value RangeExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_range_expression(*this);
 }
 
-AccessExpression::AccessExpression(ShrExprPtr l_operand, ShrExprPtr r_operand) :
+AccessExpression::AccessExpression(ExprPtr l_operand, ExprPtr r_operand) :
     l_operand(l_operand), r_operand(r_operand) {}
 
-std::any AccessExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_access_expression(shared_from_this());
+std::any AccessExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_access_expression(*this);
+}
+
+Value AccessExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_access_expression(*this);
 }
 
-CallExpression::CallExpression(Token function_name, std::vector<ShrExprPtr> arguments) :
+CallExpression::CallExpression(Token function_name, std::vector<ExprPtr> arguments) :
     function_name(function_name), arguments(arguments) {}
 
-std::any CallExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_call_expression(shared_from_this());
+std::any CallExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_call_expression(*this);
 }
 
-LogicalExpression::LogicalExpression(TokenType type, ShrExprPtr l_operand, ShrExprPtr r_operand) :
+Value CallExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_call_expression(*this);
+}
+
+LogicalExpression::LogicalExpression(TokenType type, ExprPtr l_operand, ExprPtr r_operand) :
     type(type), l_operand(l_operand), r_operand(r_operand) {}
 
-std::any LogicalExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_logical_expression(shared_from_this());
+std::any LogicalExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_logical_expression(*this);
+}
+
+Value LogicalExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_logical_expression(*this);
 }
 
-BitwiseExpression::BitwiseExpression(TokenType type, ShrExprPtr l_operand, ShrExprPtr r_operand) :
+BitwiseExpression::BitwiseExpression(TokenType type, ExprPtr l_operand, ExprPtr r_operand) :
     type(type), l_operand(l_operand), r_operand(r_operand) {}
 
-std::any BitwiseExpression::accept(ExpressionVisitor<std::any>& visitor) {
-    return visitor.visit_bitwise_expression(shared_from_this());
+std::any BitwiseExpression::accept(ExpressionVisitor<std::any>& visitor) const {
+    return visitor.visit_bitwise_expression(*this);
+}
+
+Value BitwiseExpression::accept(ExpressionVisitor<Value>& visitor) const {
+    return visitor.visit_bitwise_expression(*this);
 }
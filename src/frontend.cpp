@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "frontend.hpp"
+#include "scanner.hpp"
+#include "parser.hpp"
+
+// Smaller sections aren't worth a thread
+constexpr size_t min_section_size = 64 * 1024;
+
+/* A quick pass over the raw text that only tracks strings, comments
+and bracket depth. A newline at depth 0 ends a top-level statement,
+unless the next line carries on an if statement */
+std::vector<std::string_view> FrontEnd::split(std::string_view src, size_t count) {
+    std::vector<std::string_view> parts;
+    size_t target = src.length() / count;
+    size_t start = 0;
+    int depth = 0;
+
+    for (size_t i = 0; i < src.length() && parts.size() + 1 < count; i++) {
+        switch (src[i]) {
+            case '"': {
+                size_t closing_quote = src.find('"', i + 1);
+                i = closing_quote == std::string_view::npos ? src.length() : closing_quote;
+                break;
+            }
+            case '/':
+                if (i + 1 < src.length() && src[i + 1] == '/') {
+                    size_t newline = src.find('\n', i);
+                    i = (newline == std::string_view::npos ? src.length() : newline) - 1;
+                }
+                break;
+            case '(': case '[': case '{': depth++; break;
+            // An unmatched closing bracket is a syntax error anyway
+            case ')': case ']': case '}': depth = std::max(depth - 1, 0); break;
+            case '\n': {
+                if (depth > 0 || i + 1 - start < target)
+                    break;
+                size_t next = src.find_first_not_of(" \t\r", i + 1);
+                std::string_view next_line = next == std::string_view::npos ? "" : src.substr(next, 5);
+                if ((next_line.starts_with("else") || next_line.starts_with("elif")) &&
+                    (next_line.length() == 4 || !(isalnum(next_line[4]) || next_line[4] == '_')))
+                    break;
+                parts.push_back(src.substr(start, i + 1 - start));
+                start = i + 1;
+                break;
+            }
+        }
+    }
+    if (start < src.length() || parts.empty())
+        parts.push_back(src.substr(start));
+    return parts;
+}
+
+void FrontEnd::parse_section(Section& section) {
+    try {
+        section.scanner = std::make_unique<Scanner>(section.src, false, section.first_line);
+    }
+    catch (std::string message) {
+        section.scan_error = message;
+        return;
+    }
+    // Tokens and parsers stay around for the function bodies they skipped
+    section.parser = std::make_unique<Parser>(section.scanner->tokens, section.arena, true, section.out);
+    try {
+        section.statements = section.parser->parse();
+    }
+    catch (std::string message) {
+        section.parse_error = message;
+    }
+}
+
+std::vector<StmtPtr> FrontEnd::parse(std::string_view src, int jobs) {
+    size_t count = jobs <= 1 ? 1 : std::min<size_t>(jobs * 4, std::max<size_t>(src.length() / min_section_size, 1));
+    int line = 1;
+    for (std::string_view part : split(src, count)) {
+        sections.push_back(std::make_unique<Section>());
+        sections.back()->src = part;
+        sections.back()->first_line = line;
+        line += std::count(part.begin(), part.end(), '\n');
+    }
+
+    if (sections.size() == 1)
+        parse_section(*sections[0]);
+    else {
+        std::atomic<size_t> next = 0;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < std::min<int>(jobs, sections.size()); i++) {
+            threads.emplace_back([&] {
+                for (size_t j = next++; j < sections.size(); j = next++)
+                    parse_section(*sections[j]);
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    /* A sequential parse would have scanned the whole file before parsing
+    any of it, so any scan error beats every parse error and warning */
+    for (std::unique_ptr<Section>& section : sections)
+        if (section->scanner == nullptr)
+            throw section->scan_error;
+
+    std::vector<StmtPtr> statements;
+    for (std::unique_ptr<Section>& section : sections) {
+        std::cout << section->out.str();
+        if (section->parser->had_error)
+            throw section->parse_error;
+        statements.insert(statements.end(), section->statements.begin(), section->statements.end());
+    }
+    return statements;
+}
+
+size_t FrontEnd::tokens() {
+    size_t tokens = 0;
+    for (std::unique_ptr<Section>& section : sections)
+        tokens += section->scanner ? section->scanner->tokens.size() : 0;
+    return tokens;
+}
+
+size_t FrontEnd::token_bytes() {
+    size_t bytes = 0;
+    for (std::unique_ptr<Section>& section : sections)
+        bytes += section->scanner ? section->scanner->tokens.bytes() : 0;
+    return bytes;
+}
+
+size_t FrontEnd::arena_bytes() {
+    size_t bytes = 0;
+    for (std::unique_ptr<Section>& section : sections)
+        bytes += section->arena.bytes_used();
+    return bytes;
+}
\ No newline at end of file
@@ -1,140 +1,174 @@
 #include <iostream>
 #include <stdint.h>
 #include <iomanip>
-#include <variant>
 #include <format>
 #include <string>
 #include <cmath>
-#include <any>
 
 #include "interpreter.hpp"
+#include "resolver.hpp"
+#include "typechecker.hpp"
+#include "optimizer.hpp"
+#include "ir.hpp"
+#include "parser.hpp"
 #include "environment.hpp"
+#include "value.hpp"
 #include "error.hpp"
 #include "token.hpp"
 #include "tilda.hpp"
 
-void Interpreter::interpret(std::vector<ShrStmtPtr> statements) {
-    for (ShrStmtPtr statement : statements) {
+void Interpreter::interpret(std::span<const StmtPtr> statements) {
+    // A runtime error can leave block scopes (and calls) open
+    environment.reset();
+    call_depth = 0;
+    is_returning = false;
+    for (StmtPtr statement : statements) {
         if (!Tilda::had_error && !Tilda::had_runtime_error)
             execute(statement);
     }
 }
 
-std::string Interpreter::to_string(std::any value) {
-    if (!value.has_value()) return "void"; // TODO: uh... this
-    try {
-        std::string text = std::format("{:.4f}", std::any_cast<double>(value));
-        if (text.find_last_of('.'))
-            text = text.substr(0, text.size() - 2);
-        return text;
-    }
-    catch (std::bad_any_cast) {
-        try {
-            return std::to_string(std::any_cast<int64_t>(value));
+/* Every value gets a register, and a block's phis all take the operand
+that comes from the block before it, as if they were copied at once */
+void Interpreter::interpret(const IRProgram& program) {
+    std::vector<Value> registers(program.instructions.size());
+    std::vector<Value> incoming;
+    auto get = [&](uint32_t value) -> const Value& {
+        return program.is_constant(value) ? program.constant(value) : registers[value];
+    };
+
+    uint32_t previous = IRProgram::none;
+    uint32_t id = program.layout[0];
+    while (true) {
+        const IRBlock& block = program.blocks[id];
+        if (!block.phis.empty()) {
+            int predecessor = block.predecessors[0] == previous ? 0 : 1;
+            incoming.clear();
+            for (uint32_t phi : block.phis)
+                incoming.push_back(get(program.instructions[phi].operands[predecessor]));
+            for (size_t i = 0; i < block.phis.size(); i++)
+                registers[block.phis[i]] = std::move(incoming[i]);
         }
-        catch (std::bad_any_cast) {
-            try {
-                return std::any_cast<bool>(value) ? "true" : "false";
-            }
-            catch (std::bad_any_cast) {
-                return std::any_cast<std::string>(value);
+
+        for (uint32_t value : block.instructions) {
+            const IRInstruction& instruction = program.instructions[value];
+            const Value& l_operand = get(instruction.operands[0]);
+            switch (instruction.op) {
+                case IROp::UNARY:
+                    registers[value] = apply_unary(instruction.type, l_operand);
+                    break;
+                case IROp::BINARY:
+                    registers[value] = apply_binary(instruction.type, l_operand, get(instruction.operands[1]));
+                    break;
+                case IROp::LOGICAL:
+                    registers[value] = apply_logical(instruction.type, l_operand, get(instruction.operands[1]));
+                    break;
+                case IROp::BITWISE:
+                    registers[value] = apply_bitwise(instruction.type, l_operand, get(instruction.operands[1]));
+                    break;
+                case IROp::PRINT:
+                    std::cout << to_string(l_operand) << std::endl;
+                    break;
+                case IROp::TYPEOF:
+                    std::cout << std::format("Type: {}", get_type(l_operand)) << std::endl;
+                    break;
             }
         }
+
+        previous = id;
+        switch (block.terminator) {
+            case IRBlock::JUMP: id = block.targets[0]; break;
+            case IRBlock::BRANCH: id = block.targets[get_truthiness(get(block.condition)) ? 0 : 1]; break;
+            case IRBlock::RETURN: return;
+        }
+    }
+}
+
+std::string Interpreter::to_string(const Value& value) {
+    switch (value.type) {
+        case LiteralType::F32:
+        case LiteralType::F64: {
+            std::string text = std::format("{:.4f}", value.floating);
+            if (text.find_last_of('.'))
+                text = text.substr(0, text.size() - 2);
+            return text;
+        }
+        case LiteralType::BOOL:
+            return value.boolean ? "true" : "false";
+        case LiteralType::STR:
+            return value.as_str();
+        case LiteralType::U64:
+            return std::to_string(static_cast<uint64_t>(value.integer));
+        default:
+            if (value.is_int())
+                return std::to_string(value.integer);
+            return "void"; // TODO: uh... this
     }
 }
 
-std::any Interpreter::evaluate(ShrExprPtr expression) {
+Value Interpreter::evaluate(ExprPtr expression) {
     return expression->accept(*this);
 }
 
-void Interpreter::execute(ShrStmtPtr statement) {
+void Interpreter::execute(StmtPtr statement) {
     statement->accept(*this);
 }
 
-void Interpreter::execute_block(std::vector<ShrStmtPtr> statements, std::shared_ptr<Environment> environment) {
-    // Make a new environment enclosed by the current environment
-    std::shared_ptr<Environment> previous = this->environment;
-    this->environment = environment;
-    for (ShrStmtPtr statement : statements) {
+void Interpreter::execute_block(std::span<const StmtPtr> statements) {
+    // Open a new scope on top of the current one
+    environment.push_scope();
+    for (StmtPtr statement : statements) {
+        if (is_returning)
+            break;
         if (!Tilda::had_error && !Tilda::had_runtime_error)
             execute(statement);
     }
-    this->environment = previous;
+    environment.pop_scope();
 }
 
-std::string Interpreter::get_type(ShrExprPtr expression) {
-    std::any value = evaluate(expression);
-
-    const std::type_info& type = value.type();
-    if (type == typeid(int64_t))
-        return "i64";
-    else if (type == typeid(double))
-        return "f64";
-    else if (type == typeid(std::string))
-        return "str";
-    else if (type == typeid(bool))
-        return "bool";
-    else
-        return "unknown";
+void Interpreter::set_resolver(Resolver* resolver) {
+    this->resolver = resolver;
 }
 
-bool Interpreter::get_truthiness(std::any operand) {
-    if (!operand.has_value())
-        return false;
-    try {
-        return std::any_cast<bool>(operand);
-    }
-    catch (std::bad_any_cast) {
-        try {
-            return std::any_cast<int64_t>(operand) != 0 ? true : false;
-        }
-        catch (std::bad_any_cast) {
-            try {
-                return std::any_cast<double>(operand) != 0 ? true : false;
-            }
-            catch (std::bad_any_cast) {
-                try {
-                    std::string str = std::any_cast<std::string>(operand);
-                    return str != "";
-                }
-                catch (std::bad_any_cast) {
-                    ;
-                }
-            }
-        }
-    }
-    return true;
+void Interpreter::set_typechecker(Typechecker* typechecker) {
+    this->typechecker = typechecker;
 }
 
-// stolen bc lazy: https://github.com/veera-sivarajan/lang0/blob/master/src/Interpreter.cpp#L34
-bool Interpreter::get_equality(std::any l_operand, std::any r_operand) {
-    if (l_operand.type() == typeid(nullptr) && r_operand.type() == typeid(nullptr)) {
-        return true;
-    }
-
-    if (l_operand.type() == typeid(nullptr)) {
-        return false;
-    }
+void Interpreter::set_optimizer(Optimizer* optimizer) {
+    this->optimizer = optimizer;
+}
 
-    if (l_operand.type() == typeid(int64_t) && r_operand.type() == typeid(int64_t)) {
-        return std::any_cast<int64_t>(l_operand) == std::any_cast<int64_t>(r_operand);
-    }
+std::string Interpreter::get_type(const Value& value) {
+    if (value.is_void())
+        return "unknown";
+    return std::string(literal_type_names[static_cast<int>(value.type)]);
+}
 
-    if (l_operand.type() == typeid(double) && r_operand.type() == typeid(double)) {
-        return std::any_cast<double>(l_operand) == std::any_cast<double>(r_operand);
+bool Interpreter::get_truthiness(const Value& operand) {
+    switch (operand.type) {
+        case LiteralType::VOID: return false;
+        case LiteralType::BOOL: return operand.boolean;
+        case LiteralType::I64: return operand.integer != 0;
+        case LiteralType::F64: return operand.floating != 0;
+        case LiteralType::STR: return operand.as_str() != "";
+        default: return operand.is_int() ? operand.integer != 0 : operand.is_float() ? operand.floating != 0 : true;
     }
+}
 
-    if (l_operand.type() == typeid(std::string) &&
-        r_operand.type() == typeid(std::string)) {
-        return std::any_cast<std::string>(l_operand) ==
-            std::any_cast<std::string>(r_operand);
-    }
+bool Interpreter::get_equality(const Value& l_operand, const Value& r_operand) {
+    if (l_operand.type != r_operand.type)
+        return false;
 
-    if (l_operand.type() == typeid(bool) && r_operand.type() == typeid(bool)) {
-        return std::any_cast<bool>(l_operand) == std::any_cast<bool>(r_operand);
+    switch (l_operand.type) {
+        case LiteralType::I64: return l_operand.integer == r_operand.integer;
+        case LiteralType::F64: return l_operand.floating == r_operand.floating;
+        case LiteralType::STR: return l_operand.as_str() == r_operand.as_str();
+        case LiteralType::BOOL: return l_operand.boolean == r_operand.boolean;
+        default:
+            if (l_operand.is_int())
+                return l_operand.integer == r_operand.integer;
+            return l_operand.is_float() && l_operand.floating == r_operand.floating;
     }
-
-    return false;
 }
 
 void Interpreter::throw_error(std::string message) {
@@ -142,236 +176,440 @@ void Interpreter::throw_error(std::string message) {
     throw std::format("Runtime Error: {}", message);
 }
 
-bool Interpreter::check_number_operand(TokenType type, std::any operand) {
-    if (operand.type() == typeid(int64_t) || operand.type() == typeid(double))
+void Interpreter::check_type(LiteralType type, const Value& value) {
+    if (value.type != type)
+        throw_error(std::format("Cannot store {} value in a variable of type {}.", get_type(value), Typechecker::type_name(type)));
+}
+
+bool Interpreter::check_number_operand(TokenType type, const Value& operand) {
+    if (operand.is_number())
         return false;
     throw_error(std::format("Operand of \"{}\" must be a number.", Token::token_type_names[type]));
     return true;
 }
 
-bool Interpreter::check_number_operands(TokenType type, std::any l_operand, std::any r_operand) {
-    if (l_operand.type() == typeid(int64_t) && r_operand.type() == typeid(int64_t)
-        || l_operand.type() == typeid(double) && r_operand.type() == typeid(double))
+bool Interpreter::check_number_operands(TokenType type, const Value& l_operand, const Value& r_operand) {
+    if ((l_operand.is_int() && r_operand.is_int())
+        || (l_operand.is_float() && r_operand.is_float()))
         return false;
     throw_error(std::format("Operands of \"{}\" must be numbers.", Token::token_type_names[type]));
     return true;
 }
 
-std::any Interpreter::visit_unary_expression(ShrUnaryExprPtr expression) {
-    std::any operand = evaluate(expression->operand);
-
-    switch (expression->type) {
-        case NEG:
-            if (check_number_operand(expression->type, operand))
-                break;
-            if (operand.type() == typeid(int64_t))
-                return -(std::any_cast<int64_t>(operand));
-            else if (operand.type() == typeid(double))
-                return -(std::any_cast<double>(operand));
-        case L_NOT:
-            return !get_truthiness(operand);
-        case B_NOT:
-            if (operand.type() != typeid(int64_t)) {
-                throw_error("Operand of \"~\" must be an integer");
-                break;
+Value Interpreter::visit_unary_expression(const UnaryExpression& expression) {
+    return apply_quickened(expression.quickening, expression.operand->static_type != LiteralType::VOID,
+        expression.type, evaluate(expression.operand));
+}
+
+/* Handlers for the operand types an operator node sees most, one per
+operator. Each one assumes its guard passed, so it skips straight to
+the operation apply_* would have ended up doing */
+#define SPECIALIZE_UNARY(result) \
+    return [](TokenType, const Value& operand) -> Value { return result; }
+#define SPECIALIZE_BINARY(result) \
+    return [](TokenType, const Value& l_operand, const Value& r_operand) -> Value { return result; }
+
+// nullptr for types the operator would raise an error on
+static UnaryHandler specialize_unary(TokenType type, LiteralType operand_type) {
+    switch (operand_type) {
+        case LiteralType::I64:
+            switch (type) {
+                case NEG: SPECIALIZE_UNARY(Value::wrapping_neg(operand.integer));
+                case L_NOT: SPECIALIZE_UNARY(operand.integer == 0);
+                case B_NOT: SPECIALIZE_UNARY(~operand.integer);
+                case INC: SPECIALIZE_UNARY(Value::wrapping_add(operand.integer, 1));
+                case DEC: SPECIALIZE_UNARY(Value::wrapping_sub(operand.integer, 1));
             }
-            else
-                return ~(std::any_cast<int64_t>(operand));
-        // TODO: how to handle prefix and postfix evaluation cases?
-        case INC:
-            if (check_number_operand(expression->type, operand))
-                break;
-            if (operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(operand) + 1;
-            else if (operand.type() == typeid(double))
-                return std::any_cast<double>(operand) + 1;
-        case DEC:
-            if (check_number_operand(expression->type, operand))
-                break;
-            if (operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(operand) - 1;
-            else if (operand.type() == typeid(double))
-                return std::any_cast<double>(operand) - 1;
+            break;
+        case LiteralType::F64:
+            switch (type) {
+                case NEG: SPECIALIZE_UNARY(-operand.floating);
+                case L_NOT: SPECIALIZE_UNARY(operand.floating == 0);
+                case INC: SPECIALIZE_UNARY(operand.floating + 1);
+                case DEC: SPECIALIZE_UNARY(operand.floating - 1);
+            }
+            break;
+        case LiteralType::BOOL:
+            if (type == L_NOT)
+                SPECIALIZE_UNARY(!operand.boolean);
+            break;
     }
-    // Unreachable
-    return std::any(); // NULL std::any
+    return nullptr;
+}
+
+static BinaryHandler specialize_binary(TokenType type, LiteralType l_type, LiteralType r_type) {
+    switch (Value::type_pair(l_type, r_type)) {
+        case Value::type_pair(LiteralType::I64, LiteralType::I64):
+            switch (type) {
+                case GREATER: SPECIALIZE_BINARY(l_operand.integer > r_operand.integer);
+                case GREATER_EQ: SPECIALIZE_BINARY(l_operand.integer >= r_operand.integer);
+                case LESS: SPECIALIZE_BINARY(l_operand.integer < r_operand.integer);
+                case LESS_EQ: SPECIALIZE_BINARY(l_operand.integer <= r_operand.integer);
+                case EQ: SPECIALIZE_BINARY(l_operand.integer == r_operand.integer);
+                case NOT_EQ: SPECIALIZE_BINARY(l_operand.integer != r_operand.integer);
+                case ADD: SPECIALIZE_BINARY(Value::wrapping_add(l_operand.integer, r_operand.integer));
+                case SUB: SPECIALIZE_BINARY(Value::wrapping_sub(l_operand.integer, r_operand.integer));
+                case MUL: SPECIALIZE_BINARY(Value::wrapping_mul(l_operand.integer, r_operand.integer));
+                // Division still has to trap, so it keeps the generic operator
+            }
+            break;
+        case Value::type_pair(LiteralType::F64, LiteralType::F64):
+            switch (type) {
+                case GREATER: SPECIALIZE_BINARY(l_operand.floating > r_operand.floating);
+                case GREATER_EQ: SPECIALIZE_BINARY(l_operand.floating >= r_operand.floating);
+                case LESS: SPECIALIZE_BINARY(l_operand.floating < r_operand.floating);
+                case LESS_EQ: SPECIALIZE_BINARY(l_operand.floating <= r_operand.floating);
+                case EQ: SPECIALIZE_BINARY(l_operand.floating == r_operand.floating);
+                case NOT_EQ: SPECIALIZE_BINARY(l_operand.floating != r_operand.floating);
+                case ADD: SPECIALIZE_BINARY(l_operand.floating + r_operand.floating);
+                case SUB: SPECIALIZE_BINARY(l_operand.floating - r_operand.floating);
+                case MUL: SPECIALIZE_BINARY(l_operand.floating * r_operand.floating);
+                case DIV: SPECIALIZE_BINARY(l_operand.floating / r_operand.floating);
+            }
+            break;
+        case Value::type_pair(LiteralType::STR, LiteralType::STR):
+            switch (type) {
+                case EQ: SPECIALIZE_BINARY(l_operand.as_str() == r_operand.as_str());
+                case NOT_EQ: SPECIALIZE_BINARY(l_operand.as_str() != r_operand.as_str());
+                case ADD: SPECIALIZE_BINARY(l_operand.as_str() + r_operand.as_str());
+            }
+            break;
+        case Value::type_pair(LiteralType::BOOL, LiteralType::BOOL):
+            switch (type) {
+                case EQ: SPECIALIZE_BINARY(l_operand.boolean == r_operand.boolean);
+                case NOT_EQ: SPECIALIZE_BINARY(l_operand.boolean != r_operand.boolean);
+            }
+            break;
+    }
+    return nullptr;
 }
 
-std::any Interpreter::visit_binary_expression(ShrBinaryExprPtr expression) {
-    std::any l_operand = evaluate(expression->l_operand);
-    std::any r_operand = evaluate(expression->r_operand);
+static BinaryHandler specialize_logical(TokenType type, LiteralType l_type, LiteralType r_type) {
+    if (l_type != LiteralType::BOOL || r_type != LiteralType::BOOL)
+        return nullptr;
+    switch (type) {
+        case L_OR: SPECIALIZE_BINARY(l_operand.boolean || r_operand.boolean);
+        case L_AND: SPECIALIZE_BINARY(l_operand.boolean && r_operand.boolean);
+        case L_XOR: SPECIALIZE_BINARY(l_operand.boolean != r_operand.boolean);
+    }
+    return nullptr;
+}
+
+static BinaryHandler specialize_bitwise(TokenType type, LiteralType l_type, LiteralType r_type) {
+    if (l_type != LiteralType::I64 || r_type != LiteralType::I64)
+        return nullptr;
+    switch (type) {
+        case B_OR: SPECIALIZE_BINARY(l_operand.integer | r_operand.integer);
+        case B_AND: SPECIALIZE_BINARY(l_operand.integer & r_operand.integer);
+        case B_XOR: SPECIALIZE_BINARY(l_operand.integer ^ r_operand.integer);
+        case LSHFT: SPECIALIZE_BINARY(Value::shift_left(l_operand.integer, r_operand.integer));
+        case RSHFT: SPECIALIZE_BINARY(Value::shift_right(l_operand.integer, r_operand.integer));
+        case CHK: SPECIALIZE_BINARY(Value::shift_right(l_operand.integer, r_operand.integer) & 1);
+    }
+    return nullptr;
+}
 
-    /* TODO: uh. figure out when and how to actually handle type
-    resolution */
+#undef SPECIALIZE_UNARY
+#undef SPECIALIZE_BINARY
 
-    std::variant<double, std::string, int64_t, bool> l_operand_literal;
-    std::variant<double, std::string, int64_t, bool> r_operand_literal;
-    // The funniest type deduction you'll ever see
-    try {
-        try {
-            l_operand_literal = std::any_cast<double>(l_operand);
-        }
-        catch (std::bad_any_cast) {
-            try {
-                l_operand_literal = std::any_cast<std::string>(l_operand);
+Value Interpreter::apply_quickened(Quickening<UnaryHandler>& quickening, bool is_static, TokenType type, const Value& operand) {
+    switch (quickening.state) {
+        case Quickened::STATIC:
+            return quickening.handler(type, operand);
+        case Quickened::SPECIALIZED:
+            if (operand.type == quickening.l_type)
+                return quickening.handler(type, operand);
+            quickening.state = Quickened::GENERIC;
+            deoptimized_sites++;
+            break;
+        case Quickened::UNSEEN:
+            // Specialized after running once, so an operand that raises an error leaves it unseen
+            {
+                Value result = apply_unary(type, operand);
+                quickening.handler = specialize_unary(type, operand.type);
+                quickening.l_type = operand.type;
+                quickening.state = !quickening.handler ? Quickened::GENERIC : is_static ? Quickened::STATIC : Quickened::SPECIALIZED;
+                specialized_sites += quickening.handler != nullptr;
+                static_sites += quickening.handler && is_static;
+                return result;
+            }
+    }
+    return apply_unary(type, operand);
+}
+
+Value Interpreter::apply_quickened(Quickening<BinaryHandler>& quickening, bool is_static, BinaryHandler apply,
+    BinaryHandler (*specialize)(TokenType, LiteralType, LiteralType), TokenType type, const Value& l_operand, const Value& r_operand) {
+    switch (quickening.state) {
+        case Quickened::STATIC:
+            return quickening.handler(type, l_operand, r_operand);
+        case Quickened::SPECIALIZED:
+            if (l_operand.type == quickening.l_type && r_operand.type == quickening.r_type)
+                return quickening.handler(type, l_operand, r_operand);
+            quickening.state = Quickened::GENERIC;
+            deoptimized_sites++;
+            break;
+        case Quickened::UNSEEN:
+            {
+                Value result = apply(type, l_operand, r_operand);
+                quickening.handler = specialize(type, l_operand.type, r_operand.type);
+                quickening.l_type = l_operand.type;
+                quickening.r_type = r_operand.type;
+                quickening.state = !quickening.handler ? Quickened::GENERIC : is_static ? Quickened::STATIC : Quickened::SPECIALIZED;
+                specialized_sites += quickening.handler != nullptr;
+                static_sites += quickening.handler && is_static;
+                return result;
+            }
+    }
+    return apply(type, l_operand, r_operand);
+}
+
+Value Interpreter::apply_unary(TokenType type, const Value& operand) {
+    switch (operand.type) {
+        case LiteralType::I64:
+            switch (type) {
+                case NEG: return Value::wrapping_neg(operand.integer);
+                case L_NOT: return operand.integer == 0;
+                case B_NOT: return ~operand.integer;
+                // TODO: how to handle prefix and postfix evaluation cases?
+                case INC: return Value::wrapping_add(operand.integer, 1);
+                case DEC: return Value::wrapping_sub(operand.integer, 1);
+            }
+            break;
+        case LiteralType::F64:
+            switch (type) {
+                case NEG: return -operand.floating;
+                case L_NOT: return operand.floating == 0;
+                case INC: return operand.floating + 1;
+                case DEC: return operand.floating - 1;
+            }
+            break;
+        default:
+            // The other widths work like an i64 or f64 whose result is brought back in range
+            if (operand.is_int()) {
+                Value result = apply_unary(type, Value(operand.integer));
+                return result.is_int() ? Value::of_integer(operand.type, result.integer) : result;
+            }
+            if (operand.is_float()) {
+                Value result = apply_unary(type, Value(operand.floating));
+                return result.is_float() ? Value::of_float(operand.type, result.floating) : result;
             }
-            catch (std::bad_any_cast) {
-                try {
-                    l_operand_literal = std::any_cast<int64_t>(l_operand);
-                }
-                catch (std::bad_any_cast) {
-                    l_operand_literal = std::any_cast<bool>(l_operand);
-                }
+            if (type == L_NOT)
+                return !get_truthiness(operand);
+    }
+
+    if (type == B_NOT)
+        throw_error("Operand of \"~\" must be an integer");
+    else
+        check_number_operand(type, operand);
+    return Value(); // void Value
+}
+
+Value Interpreter::visit_binary_expression(const BinaryExpression& expression) {
+    Value l_operand = evaluate(expression.l_operand);
+    Value r_operand = evaluate(expression.r_operand);
+    bool is_static = expression.l_operand->static_type != LiteralType::VOID && expression.r_operand->static_type != LiteralType::VOID;
+    return apply_quickened(expression.quickening, is_static, apply_binary, specialize_binary, expression.type, l_operand, r_operand);
+}
+
+/* Operand types are resolved with a single switch over both
+tags, and only then is the operator dispatched */
+Value Interpreter::apply_binary(TokenType type, const Value& l_operand, const Value& r_operand) {
+    switch (Value::type_pair(l_operand.type, r_operand.type)) {
+        case Value::type_pair(LiteralType::I64, LiteralType::I64): {
+            int64_t l = l_operand.integer, r = r_operand.integer;
+            switch (type) {
+                case GREATER: return l > r;
+                case GREATER_EQ: return l >= r;
+                case LESS: return l < r;
+                case LESS_EQ: return l <= r;
+                case EQ: return l == r;
+                case NOT_EQ: return l != r;
+                case ADD: return Value::wrapping_add(l, r);
+                case SUB: return Value::wrapping_sub(l, r);
+                case MUL: return Value::wrapping_mul(l, r);
+                // Both trap on a zero divisor, and on INT64_MIN / -1
+                case DIV:
+                    if (r == 0)
+                        throw_error("Division by zero.");
+                    return r == -1 ? Value::wrapping_neg(l) : l / r;
+                case POW: return static_cast<int64_t>(std::pow(l, r));
+                case MOD:
+                    if (r == 0)
+                        throw_error("Division by zero.");
+                    return r == -1 ? 0 : l % r;
             }
+            break;
         }
-        try {
-            r_operand_literal = std::any_cast<double>(r_operand);
+        case Value::type_pair(LiteralType::F64, LiteralType::F64): {
+            double l = l_operand.floating, r = r_operand.floating;
+            switch (type) {
+                case GREATER: return l > r;
+                case GREATER_EQ: return l >= r;
+                case LESS: return l < r;
+                case LESS_EQ: return l <= r;
+                case EQ: return l == r;
+                case NOT_EQ: return l != r;
+                case ADD: return l + r;
+                case SUB: return l - r;
+                case MUL: return l * r;
+                case DIV: return l / r;
+                case POW: return std::pow(l, r);
+                case MOD: return fmod(l, r);
+            }
+            break;
         }
-        catch (std::bad_any_cast) {
-            try {
-                r_operand_literal = std::any_cast<std::string>(r_operand);
+        case Value::type_pair(LiteralType::STR, LiteralType::STR):
+            switch (type) {
+                case EQ: return l_operand.as_str() == r_operand.as_str();
+                case NOT_EQ: return l_operand.as_str() != r_operand.as_str();
+                case ADD: return l_operand.as_str() + r_operand.as_str();
             }
-            catch (std::bad_any_cast) {
-                try {
-                    r_operand_literal = std::any_cast<int64_t>(r_operand);
-                }
-                catch (std::bad_any_cast) {
-                    r_operand_literal = std::any_cast<bool>(r_operand);
-                }
+            // Will throw an error
+            check_number_operands(type, l_operand, r_operand);
+            break;
+        case Value::type_pair(LiteralType::BOOL, LiteralType::BOOL):
+            switch (type) {
+                case EQ: return l_operand.boolean == r_operand.boolean;
+                case NOT_EQ: return l_operand.boolean != r_operand.boolean;
             }
-        }
+            // Will throw an error
+            check_number_operands(type, l_operand, r_operand);
+            break;
+        default:
+            if (l_operand.type == r_operand.type && (l_operand.is_int() || l_operand.is_float()))
+                return apply_fixed_width(type, l_operand, r_operand);
+            /* TODO: uh. figure out when and how to actually handle type
+            resolution */
+            if (l_operand.is_void() || r_operand.is_void())
+                throw_error("Type deduction error.");
+            else
+                throw_error("Cannot perform operations on mismatched types.");
     }
-    catch (std::bad_any_cast) {
-        throw_error("Type deduction error.");
-        return std::any();
+    return Value(); // void Value
+}
+
+/* Every integer narrower than 64 bits fits in an i64 exactly, so it's
+operated on as one and the result is wrapped back to its width. A u64
+only needs operators of its own where it differs from an i64 */
+Value Interpreter::apply_fixed_width(TokenType type, const Value& l_operand, const Value& r_operand) {
+    if (l_operand.is_float()) {
+        Value result = apply_binary(type, Value(l_operand.floating), Value(r_operand.floating));
+        return result.is_float() ? Value::of_float(l_operand.type, result.floating) : result;
     }
-    if (l_operand.type() != r_operand.type()) {
-        throw_error("Cannot perform operations on mismatched types.");
-        return std::any();
+    // Unsigned arithmetic wraps around where a signed one would overflow
+    uint64_t l = l_operand.integer, r = r_operand.integer;
+    switch (type) {
+        case ADD: return Value::of_integer(l_operand.type, l + r);
+        case SUB: return Value::of_integer(l_operand.type, l - r);
+        case MUL: return Value::of_integer(l_operand.type, l * r);
     }
-
-    switch (expression->type) {
-        case GREATER:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(l_operand) > std::any_cast<int64_t>(r_operand);
-            else
-                return std::any_cast<double>(l_operand) > std::any_cast<double>(r_operand);
-        case GREATER_EQ:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(l_operand) >= std::any_cast<int64_t>(r_operand);
-            else
-                return std::any_cast<double>(l_operand) >= std::any_cast<double>(r_operand);
-        case LESS:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(l_operand) < std::any_cast<int64_t>(r_operand);
-            else
-                return std::any_cast<double>(l_operand) < std::any_cast<double>(r_operand);
-        case LESS_EQ:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(l_operand) <= std::any_cast<int64_t>(r_operand);
-            else
-                return std::any_cast<double>(l_operand) <= std::any_cast<double>(r_operand);
-        case EQ:
-            return get_equality(l_operand, r_operand);
-        case NOT_EQ:
-            return !get_equality(l_operand, r_operand);
-        case ADD:
-            if (l_operand.type() == typeid(double))
-                return std::get<double>(l_operand_literal) + std::get<double>(r_operand_literal);
-            else if (l_operand.type() == typeid(int64_t))
-                return std::get<int64_t>(l_operand_literal) + std::get<int64_t>(r_operand_literal);
-            else if (l_operand.type() == typeid(std::string))
-                return std::get<std::string>(l_operand_literal) + std::get<std::string>(r_operand_literal);
-            // Will throw an error if we reach this
-            check_number_operands(expression->type, l_operand, r_operand);
-            break;
-        case SUB:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(l_operand) - std::any_cast<int64_t>(r_operand);
-            else
-                return std::any_cast<double>(l_operand) - std::any_cast<double>(r_operand);
-        case MUL:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(l_operand) * std::any_cast<int64_t>(r_operand);
-            else
-                return std::any_cast<double>(l_operand) * std::any_cast<double>(r_operand);
-        case DIV:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(l_operand) / std::any_cast<int64_t>(r_operand);
-            else
-                return std::any_cast<double>(l_operand) / std::any_cast<double>(r_operand);
-        case POW:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return static_cast<int64_t>(std::pow(std::any_cast<int64_t>(l_operand), std::any_cast<int64_t>(r_operand)));
-            else
-                return std::pow(std::any_cast<double>(l_operand), std::any_cast<double>(r_operand));
-        case MOD:
-            if (check_number_operands(expression->type, l_operand, r_operand))
-                break;
-            if (l_operand.type() == typeid(int64_t))
-                return std::any_cast<int64_t>(l_operand) % std::any_cast<int64_t>(r_operand);
-            else
-                return fmod(std::any_cast<double>(l_operand), std::any_cast<double>(r_operand));
+    if (l_operand.type == LiteralType::U64) {
+        switch (type) {
+            case GREATER: return l > r;
+            case GREATER_EQ: return l >= r;
+            case LESS: return l < r;
+            case LESS_EQ: return l <= r;
+            case DIV:
+            case MOD:
+                if (r == 0)
+                    throw_error("Division by zero.");
+                return Value::of_integer(LiteralType::U64, type == DIV ? l / r : l % r);
+            case POW: return Value::of_integer(LiteralType::U64, static_cast<uint64_t>(std::pow(l, r)));
+        }
     }
-    return std::any(); // NULL std::any
+    Value result = apply_binary(type, Value(l_operand.integer), Value(r_operand.integer));
+    return result.is_int() ? Value::of_integer(l_operand.type, result.integer) : result;
 }
 
-std::any Interpreter::visit_ternary_expression(ShrTernaryExprPtr expression) {
-    bool condition = get_truthiness(evaluate(expression->condition));
-    return condition ? evaluate(expression->l_operand) : evaluate(expression->r_operand);
+Value Interpreter::visit_ternary_expression(const TernaryExpression& expression) {
+    bool condition = get_truthiness(evaluate(expression.condition));
+    return condition ? evaluate(expression.l_operand) : evaluate(expression.r_operand);
 }
 
-std::any Interpreter::visit_literal_expression(ShrLiteralExprPtr expression) {
-    return expression->value;
+Value Interpreter::visit_literal_expression(const LiteralExpression& expression) {
+    return expression.value;
 }
 
-std::any Interpreter::visit_group_expression(ShrGroupExprPtr expression) {
-    return evaluate(expression->expression);
+Value Interpreter::visit_group_expression(const GroupExpression& expression) {
+    return evaluate(expression.expression);
 }
 
-std::any Interpreter::visit_variable_expression(ShrVariableExprPtr expression) {
-    return environment->get(expression->identifier.lexeme);
+Value Interpreter::visit_variable_expression(const VariableExpression& expression) {
+    if (!environment.is_defined(expression.depth, expression.slot))
+        throw_error(std::format("Undefined variable: \"{}\".", expression.identifier.lexeme));
+    return environment.get(expression.depth, expression.slot);
 }
 
-std::any Interpreter::visit_assign_expression(ShrAssignExprPtr expression) {
-    std::any value = evaluate(expression->expression);
-    environment->assign(expression->identifier.lexeme, value);
+Value Interpreter::visit_assign_expression(const AssignExpression& expression) {
+    Value value = evaluate(expression.expression);
+    if (!environment.is_defined(expression.depth, expression.slot))
+        throw_error(std::format("Undefined variable: \"{}\".", expression.identifier.lexeme));
+    if (expression.checked_type != LiteralType::VOID)
+        check_type(expression.checked_type, value);
+    environment.assign(expression.depth, expression.slot, value);
     return value;
 }
 
-std::any Interpreter::visit_range_expression(ShrRangeExprPtr expression) {
-    ;
+Value Interpreter::visit_range_expression(const RangeExpression& expression) {
+    return Value();
 }
 
-std::any Interpreter::visit_access_expression(ShrAccessExprPtr expression) {
-    ;
+Value Interpreter::visit_access_expression(const AccessExpression& expression) {
+    return Value();
 }
 
-std::any Interpreter::visit_call_expression(ShrCallExprPtr expression) {
-    ;
+// Everything a function's body goes through before its first call
+void Interpreter::prepare_body(const FunctionStatement& function) {
+    if (function.is_resolved)
+        return;
+    if (!function.is_parsed)
+        function.parser->parse_body(function);
+    resolver->resolve_body(function);
+    if (typechecker)
+        typechecker->check_body(function);
+    if (optimizer)
+        optimizer->optimize_body(function);
 }
 
-std::any Interpreter::visit_logical_expression(ShrLogicalExprPtr expression) {
-    std::any l_operand = evaluate(expression->l_operand);
-    std::any r_operand = evaluate(expression->r_operand);
+Value Interpreter::visit_call_expression(const CallExpression& expression) {
+    const FunctionStatement& function = *expression.function;
+    prepare_body(function);
+    if (call_depth == max_call_depth)
+        throw_error(std::format("Stack overflow in \"{}\".", function.identifier.lexeme));
+
+    // Arguments are evaluated onto the top of the stack, in the caller's scope
+    for (size_t i = 0; i < expression.arguments.size(); i++) {
+        Value argument = evaluate(expression.arguments[i]);
+        LiteralType type = Typechecker::runtime_type(function.parameters[i].type);
+        if (type != LiteralType::VOID)
+            check_type(type, argument);
+        environment.push(std::move(argument));
+    }
+    environment.push_scope(expression.arguments.size());
+    call_depth++;
+    for (StmtPtr statement : function.body) {
+        execute(statement);
+        if (is_returning)
+            break;
+    }
+    call_depth--;
+    environment.pop_scope();
 
-    switch (expression->type) {
+    Value result = std::move(return_value);
+    return_value = Value();
+    is_returning = false;
+    return result;
+}
+
+Value Interpreter::visit_logical_expression(const LogicalExpression& expression) {
+    Value l_operand = evaluate(expression.l_operand);
+    Value r_operand = evaluate(expression.r_operand);
+    bool is_static = expression.l_operand->static_type != LiteralType::VOID && expression.r_operand->static_type != LiteralType::VOID;
+    return apply_quickened(expression.quickening, is_static, apply_logical, specialize_logical, expression.type, l_operand, r_operand);
+}
+
+Value Interpreter::apply_logical(TokenType type, const Value& l_operand, const Value& r_operand) {
+    switch (type) {
         case L_OR:
             return get_truthiness(l_operand) || get_truthiness(r_operand);
         case L_AND:
@@ -379,94 +617,113 @@ std::any Interpreter::visit_logical_expression(ShrLogicalExprPtr expression) {
         case L_XOR:
             return get_truthiness(l_operand) != get_truthiness(r_operand);
     }
+    return Value(); // void Value
 }
 
-std::any Interpreter::visit_bitwise_expression(ShrBitwiseExprPtr expression) {
-    std::any l_operand = evaluate(expression->l_operand);
-    std::any r_operand = evaluate(expression->r_operand);
+Value Interpreter::visit_bitwise_expression(const BitwiseExpression& expression) {
+    Value l_operand = evaluate(expression.l_operand);
+    Value r_operand = evaluate(expression.r_operand);
+    bool is_static = expression.l_operand->static_type != LiteralType::VOID && expression.r_operand->static_type != LiteralType::VOID;
+    return apply_quickened(expression.quickening, is_static, apply_bitwise, specialize_bitwise, expression.type, l_operand, r_operand);
+}
 
-    try {
-        switch (expression->type) {
-            case B_OR:
-                return std::any_cast<int64_t>(l_operand) |
-                    std::any_cast<int64_t>(r_operand);
-            case B_AND:
-                return std::any_cast<int64_t>(l_operand) &
-                    std::any_cast<int64_t>(r_operand);
-            case B_XOR:
-                return std::any_cast<int64_t>(l_operand) ^
-                    std::any_cast<int64_t>(r_operand);
-            case LSHFT:
-                return std::any_cast<int64_t>(l_operand) <<
-                    std::any_cast<int64_t>(r_operand);
-            case RSHFT:
-                return std::any_cast<int64_t>(l_operand) >>
-                    std::any_cast<int64_t>(r_operand);
-            case CHK:
-                #define CHECK_BIT(var, offset) (var >> offset) & 1
-                return CHECK_BIT(std::any_cast<int64_t>(l_operand),
-                    std::any_cast<int64_t>(r_operand));
-                #undef CHECK_BIT
+Value Interpreter::apply_bitwise(TokenType type, const Value& l_operand, const Value& r_operand) {
+    if (Value::type_pair(l_operand.type, r_operand.type) != Value::type_pair(LiteralType::I64, LiteralType::I64)) {
+        if (l_operand.type != r_operand.type || !l_operand.is_int()) {
+            throw_error("Can on only perform bitwise operations on integer types!");
+            return Value();
         }
+        // Shifting right brings in zeros, and narrower unsigned values are already zero extended
+        uint64_t l = l_operand.integer, r = r_operand.integer;
+        if (l_operand.type == LiteralType::U64 && (type == RSHFT || type == CHK))
+            return Value::of_integer(LiteralType::U64, type == RSHFT ? l >> (r & 63) : (l >> (r & 63)) & 1);
+        return Value::of_integer(l_operand.type, apply_bitwise(type, Value(l_operand.integer), Value(r_operand.integer)).integer);
     }
-    catch (std::bad_any_cast) {
-        throw_error("Can on only perform bitwise operations on integer types!");
+
+    int64_t l = l_operand.integer, r = r_operand.integer;
+    switch (type) {
+        case B_OR: return l | r;
+        case B_AND: return l & r;
+        case B_XOR: return l ^ r;
+        case LSHFT: return Value::shift_left(l, r);
+        case RSHFT: return Value::shift_right(l, r);
+        case CHK: return Value::shift_right(l, r) & 1;
     }
-    return std::any(); // NULL std::any
+    return Value(); // void Value
 }
 
-void Interpreter::visit_expression_statement(ShrExpressionStmtPtr statement) {
-    evaluate(statement->expression);
+void Interpreter::visit_expression_statement(const ExpressionStatement& statement) {
+    evaluate(statement.expression);
 }
 
-void Interpreter::visit_print_statement(ShrPrintStmtPtr statement) {
-    std::cout << to_string(evaluate(statement->expression)) << std::endl;
+void Interpreter::visit_print_statement(const PrintStatement& statement) {
+    std::cout << to_string(evaluate(statement.expression)) << std::endl;
 }
 
-void Interpreter::visit_type_statement(ShrTypeStmtPtr statement) {
-    std::cout << std::format("Type: {}", get_type(statement->expression)) << std::endl;
+void Interpreter::visit_type_statement(const TypeStatement& statement) {
+    std::cout << std::format("Type: {}", get_type(evaluate(statement.expression))) << std::endl;
 }
 
-void Interpreter::visit_block_statement(ShrBlockStmtPtr statement) {
-    execute_block(statement->statements, std::make_shared<Environment>(environment));
+void Interpreter::visit_block_statement(const BlockStatement& statement) {
+    execute_block(statement.statements);
 }
 
-void Interpreter::visit_declare_statement(ShrDeclareStmtPtr statement) {
-    std::any value = std::any();
-    if (statement->expression)
-        value = evaluate(statement->expression);
-    environment->define(statement->identifier.lexeme, value);
+void Interpreter::visit_declare_statement(const DeclareStatement& statement) {
+    Value value;
+    try {
+        if (statement.expression)
+            value = evaluate(statement.expression);
+        if (statement.checked_type != LiteralType::VOID)
+            check_type(statement.checked_type, value);
+    }
+    catch (std::string message) {
+        /* Still define the slot, otherwise the next scope opened
+        (i.e. on the next REPL line) would start inside this one */
+        if (!statement.is_redeclaration)
+            environment.define(statement.slot, Value());
+        throw;
+    }
+    // A redeclaration in the same scope keeps the original value
+    if (!statement.is_redeclaration)
+        environment.define(statement.slot, value);
 }
 
-void Interpreter::visit_if_statement(ShrIfStmtPtr statement) {
-    bool condition = get_truthiness(evaluate(statement->expression));
+void Interpreter::visit_if_statement(const IfStatement& statement) {
+    bool condition = get_truthiness(evaluate(statement.expression));
     if (condition)
-        execute(statement->then_branch);
-    else
-        execute(statement->else_branch);
+        execute(statement.then_branch);
+    else if (statement.else_branch)
+        execute(statement.else_branch);
 }
 
-void Interpreter::visit_while_statement(ShrWhileStmtPtr statement) {
-    while (get_truthiness(evaluate(statement->expression)))
-        execute(statement->statements);
+void Interpreter::visit_while_statement(const WhileStatement& statement) {
+    while (!is_returning && get_truthiness(evaluate(statement.expression)))
+        execute(statement.statements);
 }
 
-void Interpreter::visit_for_statement(ShrForStmtPtr statement) {
+void Interpreter::visit_for_statement(const ForStatement& statement) {
     ;
 }
 
-void Interpreter::visit_forin_statement(ShrForInStmtPtr statement) {
+void Interpreter::visit_forin_statement(const ForInStatement& statement) {
     ;
 }
 
-void Interpreter::visit_switch_statement(ShrSwitchStmtPtr statement) {
+void Interpreter::visit_switch_statement(const SwitchStatement& statement) {
     ;
 }
 
-void Interpreter::visit_return_statement(ShrReturnStmtPtr statement) {
+void Interpreter::visit_return_statement(const ReturnStatement& statement) {
+    if (statement.expression)
+        return_value = evaluate(statement.expression);
+    is_returning = true;
+}
+
+void Interpreter::visit_struct_statement(const StructStatement& statement) {
     ;
 }
 
-void Interpreter::visit_struct_statement(ShrStructStmtPtr statement) {
+// Declaring a function has no runtime effect, the Resolver already knows about it
+void Interpreter::visit_function_statement(const FunctionStatement& statement) {
     ;
 }
\ No newline at end of file
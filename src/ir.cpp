@@ -0,0 +1,472 @@
+#include <stdint.h>
+#include <optional>
+#include <cstring>
+#include <format>
+#include <string>
+#include <vector>
+#include <span>
+#include <any>
+#include <map>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "token.hpp"
+#include "value.hpp"
+#include "ir.hpp"
+
+int IRInstruction::operand_count() const {
+    switch (op) {
+        case IROp::CONSTANT: return 0;
+        case IROp::UNARY: case IROp::PRINT: case IROp::TYPEOF: return 1;
+        default: return 2;
+    }
+}
+
+bool IRLoop::contains(const IRProgram& program, uint32_t block) const {
+    uint32_t position = program.blocks[block].position;
+    return position >= program.blocks[header].position && position <= program.blocks[latch].position;
+}
+
+uint32_t IRProgram::add(IRInstruction instruction) {
+    instructions.push_back(instruction);
+    return instructions.size() - 1;
+}
+
+// Equal values share one constant, so CSE can treat them like any other operand
+uint32_t IRProgram::add_constant(const Value& value) {
+    std::string key = value.key();
+    auto found = constant_values.find(key);
+    if (found != constant_values.end())
+        return found->second;
+
+    IRInstruction instruction{IROp::CONSTANT};
+    instruction.types = 1 << static_cast<int>(value.type);
+    instruction.may_throw = false;
+    instruction.constant = constants.size();
+    constants.push_back(value);
+    uint32_t id = add(instruction);
+    constant_values.insert({key, id});
+    return id;
+}
+
+size_t IRProgram::size() const {
+    size_t size = 0;
+    for (const IRBlock& block : blocks)
+        size += block.phis.size() + block.instructions.size();
+    return size;
+}
+
+static std::string type_names(uint16_t types) {
+    static constexpr std::pair<LiteralType, const char*> names[] = {
+        {LiteralType::I64, "i64"}, {LiteralType::F64, "f64"}, {LiteralType::STR, "str"},
+        {LiteralType::BOOL, "bool"}, {LiteralType::VOID, "void"}
+    };
+    std::string text;
+    for (auto [type, name] : names) {
+        if (types & (1 << static_cast<int>(type)))
+            text += (text.empty() ? "" : "|") + std::string(name);
+    }
+    return text;
+}
+
+std::string IRProgram::print() const {
+    auto operand = [&](uint32_t value) {
+        if (!is_constant(value))
+            return std::format("%{}", value);
+        const Value& constant = this->constant(value);
+        switch (constant.type) {
+            case LiteralType::I64: return std::to_string(constant.integer);
+            case LiteralType::F64: return std::format("{}", constant.floating);
+            case LiteralType::STR: return std::format("\"{}\"", constant.as_str());
+            case LiteralType::BOOL: return std::string(constant.boolean ? "true" : "false");
+            default: return std::string("void");
+        }
+    };
+    auto annotate = [&](const IRInstruction& instruction) {
+        std::string types = type_names(instruction.types);
+        if (types.empty() && !instruction.may_throw)
+            return std::string();
+        return std::format("    ; {}{}", types, instruction.may_throw ? " (may throw)" : "");
+    };
+
+    std::string text;
+    for (uint32_t id : layout) {
+        const IRBlock& block = blocks[id];
+        text += std::format("b{}:", id);
+        for (size_t i = 0; i < block.predecessors.size(); i++)
+            text += std::format("{} b{}", i == 0 ? "    ; from" : ",", block.predecessors[i]);
+        for (const IRLoop& loop : loops) {
+            if (loop.header == id)
+                text += std::format(" (loop header, latch b{})", loop.latch);
+            else if (loop.preheader == id)
+                text += " (preheader)";
+        }
+        text += '\n';
+
+        for (uint32_t phi : block.phis) {
+            const IRInstruction& instruction = instructions[phi];
+            text += std::format("  %{} = phi {}, {}{}\n", phi, operand(instruction.operands[0]), operand(instruction.operands[1]), annotate(instruction));
+        }
+        for (uint32_t value : block.instructions) {
+            const IRInstruction& instruction = instructions[value];
+            switch (instruction.op) {
+                case IROp::PRINT:
+                    text += std::format("  print {}\n", operand(instruction.operands[0]));
+                    break;
+                case IROp::TYPEOF:
+                    text += std::format("  typeof {}\n", operand(instruction.operands[0]));
+                    break;
+                case IROp::UNARY:
+                    text += std::format("  %{} = {} {}{}\n", value, Token::token_type_names[instruction.type], operand(instruction.operands[0]), annotate(instruction));
+                    break;
+                default:
+                    text += std::format("  %{} = {} {} {}{}\n", value, operand(instruction.operands[0]), Token::token_type_names[instruction.type], operand(instruction.operands[1]), annotate(instruction));
+                    break;
+            }
+        }
+
+        switch (block.terminator) {
+            case IRBlock::JUMP: text += std::format("  jump b{}\n", block.targets[0]); break;
+            case IRBlock::BRANCH: text += std::format("  branch {}, b{}, b{}\n", operand(block.condition), block.targets[0], block.targets[1]); break;
+            case IRBlock::RETURN: text += "  return\n"; break;
+        }
+    }
+    return text;
+}
+
+std::optional<IRProgram> IRBuilder::build(std::span<const StmtPtr> statements) {
+    program = IRProgram();
+    scopes = {{}};
+    variable_count = 0;
+    definitions.clear();
+    sealed.clear();
+    incomplete_phis.clear();
+
+    place(new_block());
+    seal(current);
+    try {
+        for (StmtPtr statement : statements)
+            lower(statement);
+    }
+    catch (Unsupported) {
+        return std::nullopt;
+    }
+    return std::move(program);
+}
+
+uint32_t IRBuilder::new_block() {
+    program.blocks.emplace_back();
+    sealed.push_back(false);
+    return program.blocks.size() - 1;
+}
+
+// Appends block to the layout, and makes it the one being filled in
+void IRBuilder::place(uint32_t block) {
+    program.blocks[block].position = program.layout.size();
+    program.layout.push_back(block);
+    current = block;
+}
+
+void IRBuilder::jump(uint32_t target) {
+    IRBlock& block = program.blocks[current];
+    block.terminator = IRBlock::JUMP;
+    block.targets[0] = target;
+    program.blocks[target].predecessors.push_back(current);
+}
+
+void IRBuilder::branch(uint32_t condition, uint32_t if_true, uint32_t if_false) {
+    IRBlock& block = program.blocks[current];
+    block.terminator = IRBlock::BRANCH;
+    block.condition = condition;
+    block.targets = {if_true, if_false};
+    program.blocks[if_true].predecessors.push_back(current);
+    program.blocks[if_false].predecessors.push_back(current);
+}
+
+// Called once every predecessor of block is known
+void IRBuilder::seal(uint32_t block) {
+    auto found = incomplete_phis.find(block);
+    if (found != incomplete_phis.end()) {
+        for (auto [variable, phi] : found->second)
+            add_phi_operands(variable, phi);
+        incomplete_phis.erase(found);
+    }
+    sealed[block] = true;
+}
+
+uint32_t IRBuilder::emit(IROp op, TokenType type, uint32_t l_operand, uint32_t r_operand) {
+    IRInstruction instruction{op};
+    instruction.type = type;
+    instruction.block = current;
+    instruction.operands = {l_operand, r_operand};
+    uint32_t value = program.add(instruction);
+    program.blocks[current].instructions.push_back(value);
+    return value;
+}
+
+uint32_t IRBuilder::new_phi(uint32_t block) {
+    IRInstruction instruction{IROp::PHI};
+    instruction.block = block;
+    instruction.may_throw = false;
+    uint32_t phi = program.add(instruction);
+    program.blocks[block].phis.push_back(phi);
+    return phi;
+}
+
+/* SSA construction as in Braun et al., "Simple and Efficient Construction
+of Static Single Assignment Form": a variable read in a block that doesn't
+define it is looked up in its predecessors, with a phi where they meet.
+The phis this leaves that merge a value with itself are removed later */
+void IRBuilder::write_variable(uint32_t variable, uint32_t block, uint32_t value) {
+    definitions[(static_cast<uint64_t>(block) << 32) | variable] = value;
+}
+
+uint32_t IRBuilder::read_variable(uint32_t variable, uint32_t block) {
+    auto found = definitions.find((static_cast<uint64_t>(block) << 32) | variable);
+    if (found != definitions.end())
+        return found->second;
+
+    uint32_t value;
+    const std::vector<uint32_t>& predecessors = program.blocks[block].predecessors;
+    if (!sealed[block]) {
+        value = new_phi(block);
+        incomplete_phis[block].push_back({variable, value});
+    }
+    else if (predecessors.size() == 1)
+        value = read_variable(variable, predecessors[0]);
+    else if (predecessors.empty())
+        throw Unsupported();
+    else {
+        // Written first, so a loop back to this block finds the phi
+        value = new_phi(block);
+        write_variable(variable, block, value);
+        add_phi_operands(variable, value);
+    }
+    write_variable(variable, block, value);
+    return value;
+}
+
+void IRBuilder::add_phi_operands(uint32_t variable, uint32_t phi) {
+    uint32_t block = program.instructions[phi].block;
+    if (program.blocks[block].predecessors.size() != 2)
+        throw Unsupported();
+    for (int i = 0; i < 2; i++) {
+        uint32_t value = read_variable(variable, program.blocks[block].predecessors[i]);
+        program.instructions[phi].operands[i] = value;
+    }
+}
+
+uint32_t IRBuilder::find_variable(std::string_view identifier) {
+    for (int i = scopes.size() - 1; i >= 0; i--) {
+        auto found = scopes[i].find(identifier);
+        if (found != scopes[i].end())
+            return found->second;
+    }
+    // The Resolver would have caught this
+    throw Unsupported();
+}
+
+/* A declaration that isn't in a block only defines its variable when it
+runs, and then keeps its first value on every later run, so an if or
+while body that's just a declaration is left to the AST engines */
+void IRBuilder::lower_branch(StmtPtr statement) {
+    if (dynamic_cast<const DeclareStatement*>(statement))
+        throw Unsupported();
+    lower(statement);
+}
+
+uint32_t IRBuilder::lower(ExprPtr expression) {
+    return std::any_cast<uint32_t>(expression->accept(*this));
+}
+
+void IRBuilder::lower(StmtPtr statement) {
+    statement->accept(*this);
+}
+
+std::any IRBuilder::visit_unary_expression(const UnaryExpression& expression) {
+    return emit(IROp::UNARY, expression.type, lower(expression.operand));
+}
+
+std::any IRBuilder::visit_binary_expression(const BinaryExpression& expression) {
+    uint32_t l_operand = lower(expression.l_operand);
+    uint32_t r_operand = lower(expression.r_operand);
+    return emit(IROp::BINARY, expression.type, l_operand, r_operand);
+}
+
+std::any IRBuilder::visit_ternary_expression(const TernaryExpression& expression) {
+    uint32_t condition = lower(expression.condition);
+    uint32_t then_block = new_block(), else_block = new_block(), end = new_block();
+    branch(condition, then_block, else_block);
+    seal(then_block);
+    seal(else_block);
+
+    place(then_block);
+    uint32_t then_value = lower(expression.l_operand);
+    jump(end);
+    place(else_block);
+    uint32_t else_value = lower(expression.r_operand);
+    jump(end);
+
+    seal(end);
+    place(end);
+    uint32_t phi = new_phi(end);
+    program.instructions[phi].operands = {then_value, else_value};
+    return phi;
+}
+
+std::any IRBuilder::visit_literal_expression(const LiteralExpression& expression) {
+    // Only the widths the IR's type masks know about
+    LiteralType type = expression.value.type;
+    if (type != LiteralType::I64 && type != LiteralType::F64 && type != LiteralType::STR && type != LiteralType::BOOL && type != LiteralType::VOID)
+        throw Unsupported();
+    return program.add_constant(expression.value);
+}
+
+std::any IRBuilder::visit_group_expression(const GroupExpression& expression) {
+    return lower(expression.expression);
+}
+
+std::any IRBuilder::visit_variable_expression(const VariableExpression& expression) {
+    return read_variable(find_variable(expression.identifier.lexeme), current);
+}
+
+std::any IRBuilder::visit_assign_expression(const AssignExpression& expression) {
+    // The runtime type check would need an operator of its own
+    if (expression.checked_type != LiteralType::VOID)
+        throw Unsupported();
+    uint32_t value = lower(expression.expression);
+    write_variable(find_variable(expression.identifier.lexeme), current, value);
+    return value;
+}
+
+std::any IRBuilder::visit_range_expression(const RangeExpression& expression) {
+    throw Unsupported();
+}
+
+std::any IRBuilder::visit_access_expression(const AccessExpression& expression) {
+    throw Unsupported();
+}
+
+std::any IRBuilder::visit_call_expression(const CallExpression& expression) {
+    throw Unsupported();
+}
+
+std::any IRBuilder::visit_logical_expression(const LogicalExpression& expression) {
+    if (!expression.r_operand)
+        throw Unsupported();
+    uint32_t l_operand = lower(expression.l_operand);
+    uint32_t r_operand = lower(expression.r_operand);
+    return emit(IROp::LOGICAL, expression.type, l_operand, r_operand);
+}
+
+std::any IRBuilder::visit_bitwise_expression(const BitwiseExpression& expression) {
+    if (!expression.r_operand)
+        throw Unsupported();
+    uint32_t l_operand = lower(expression.l_operand);
+    uint32_t r_operand = lower(expression.r_operand);
+    return emit(IROp::BITWISE, expression.type, l_operand, r_operand);
+}
+
+void IRBuilder::visit_expression_statement(const ExpressionStatement& statement) {
+    lower(statement.expression);
+}
+
+void IRBuilder::visit_print_statement(const PrintStatement& statement) {
+    emit(IROp::PRINT, PRINT, lower(statement.expression));
+}
+
+void IRBuilder::visit_type_statement(const TypeStatement& statement) {
+    emit(IROp::TYPEOF, TYPEOF, lower(statement.expression));
+}
+
+void IRBuilder::visit_block_statement(const BlockStatement& statement) {
+    scopes.push_back({});
+    for (StmtPtr block_statement : statement.statements)
+        lower(block_statement);
+    scopes.pop_back();
+}
+
+void IRBuilder::visit_declare_statement(const DeclareStatement& statement) {
+    if (statement.checked_type != LiteralType::VOID)
+        throw Unsupported();
+    uint32_t value = statement.expression ? lower(statement.expression) : program.add_constant(Value());
+    // A redeclaration in the same scope keeps the original value
+    if (statement.is_redeclaration)
+        return;
+    uint32_t variable = variable_count++;
+    scopes.back()[statement.identifier.lexeme] = variable;
+    write_variable(variable, current, value);
+}
+
+// The else block is there even without an else, so no edge into the end block starts at the branch
+void IRBuilder::visit_if_statement(const IfStatement& statement) {
+    uint32_t condition = lower(statement.expression);
+    uint32_t then_block = new_block(), else_block = new_block(), end = new_block();
+    branch(condition, then_block, else_block);
+    seal(then_block);
+    seal(else_block);
+
+    place(then_block);
+    lower_branch(statement.then_branch);
+    jump(end);
+    place(else_block);
+    if (statement.else_branch)
+        lower_branch(statement.else_branch);
+    jump(end);
+
+    seal(end);
+    place(end);
+}
+
+void IRBuilder::visit_while_statement(const WhileStatement& statement) {
+    uint32_t preheader = new_block();
+    jump(preheader);
+    seal(preheader);
+    place(preheader);
+
+    // The header isn't sealed until the latch jumps back to it
+    uint32_t header = new_block();
+    jump(header);
+    place(header);
+    uint32_t condition = lower(statement.expression);
+    uint32_t body = new_block(), exit = new_block();
+    branch(condition, body, exit);
+    seal(body);
+    seal(exit);
+
+    place(body);
+    lower_branch(statement.statements);
+    uint32_t latch = new_block();
+    jump(latch);
+    seal(latch);
+    place(latch);
+    jump(header);
+    seal(header);
+    program.loops.push_back({preheader, header, latch});
+
+    place(exit);
+}
+
+void IRBuilder::visit_for_statement(const ForStatement& statement) {
+    throw Unsupported();
+}
+
+void IRBuilder::visit_forin_statement(const ForInStatement& statement) {
+    throw Unsupported();
+}
+
+void IRBuilder::visit_switch_statement(const SwitchStatement& statement) {
+    throw Unsupported();
+}
+
+void IRBuilder::visit_return_statement(const ReturnStatement& statement) {
+    throw Unsupported();
+}
+
+void IRBuilder::visit_struct_statement(const StructStatement& statement) {
+    throw Unsupported();
+}
+
+void IRBuilder::visit_function_statement(const FunctionStatement& statement) {
+    throw Unsupported();
+}
\ No newline at end of file
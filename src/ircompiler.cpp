@@ -0,0 +1,414 @@
+#include <stdint.h>
+#include <algorithm>
+#include <numeric>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "ircompiler.hpp"
+#include "bytecode.hpp"
+#include "ir.hpp"
+#include "tilda.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+Chunk IRCompiler::compile(const IRProgram& program) {
+    this->program = &program;
+    chunk = Chunk();
+    jumps.clear();
+    constant_indices.assign(program.constants.size(), UINT32_MAX);
+
+    count_uses();
+    is_stackified.assign(program.instructions.size(), false);
+    for (uint32_t block : program.layout)
+        stackify(program.blocks[block]);
+    find_liveness();
+    assign_slots();
+
+    // Slots are the bottom of the stack, same as the Compiler's locals
+    for (uint32_t i = 0; i < slot_count; i++)
+        emit(OP_VOID);
+
+    block_offsets.assign(program.blocks.size(), 0);
+    for (size_t i = 0; i < program.layout.size(); i++) {
+        uint32_t id = program.layout[i];
+        const IRBlock& block = program.blocks[id];
+        uint32_t next = i + 1 < program.layout.size() ? program.layout[i + 1] : IRProgram::none;
+        block_offsets[id] = chunk.code.size();
+
+        for (uint32_t value : block.instructions) {
+            if (is_stackified[value])
+                continue;
+            emit_instruction(value);
+            if (!at(value).has_value())
+                continue;
+            if (slots[value] != IRProgram::none) {
+                emit(OP_SET_LOCAL, slots[value]);
+                emit(OP_POP);
+            }
+            else
+                emit(OP_POP);
+        }
+
+        switch (block.terminator) {
+            case IRBlock::JUMP:
+                emit_phi_copies(id, block.targets[0]);
+                if (block.targets[0] != next)
+                    emit_jump(OP_JUMP, id, block.targets[0]);
+                break;
+            case IRBlock::BRANCH:
+                emit_value(block.condition);
+                emit_jump(OP_JUMP_IF_FALSE, id, block.targets[1]);
+                if (block.targets[0] != next)
+                    emit_jump(OP_JUMP, id, block.targets[0]);
+                break;
+            case IRBlock::RETURN:
+                emit(OP_RETURN);
+                break;
+        }
+    }
+
+    for (auto [offset, target] : jumps) {
+        // -2 to account for the jump's own operand
+        size_t jump = block_offsets[target] - offset - 2;
+        if (jump > UINT16_MAX)
+            throw_error("Too much code to jump over.");
+        chunk.code[offset] = (jump >> 8) & 0xFF;
+        chunk.code[offset + 1] = jump & 0xFF;
+    }
+    return chunk;
+}
+
+void IRCompiler::count_uses() {
+    uses.assign(program->instructions.size(), 0);
+    for (uint32_t id : program->layout) {
+        const IRBlock& block = program->blocks[id];
+        for (const std::vector<uint32_t>* values : {&block.phis, &block.instructions}) {
+            for (uint32_t value : *values) {
+                for (int i = 0; i < at(value).operand_count(); i++)
+                    uses[at(value).operands[i]]++;
+            }
+        }
+        if (block.terminator == IRBlock::BRANCH)
+            uses[block.condition]++;
+    }
+}
+
+/* Working back from the end of the block, a value whose only use is the
+operand being looked at, and that's the instruction right before it, is
+left on the stack. An operand that isn't is loaded from its slot, which
+doesn't get in the way of the operand before it, so that's tried next */
+void IRCompiler::stackify(const IRBlock& block) {
+    size_t end = block.instructions.size();
+    if (block.terminator == IRBlock::BRANCH)
+        end = stackify_operand(block.instructions, block.condition, end);
+    while (end > 0) {
+        end--;
+        end = stackify_operands(block.instructions, block.instructions[end], end);
+    }
+}
+
+// Returns where the instructions the value is computed with start, or end if it isn't stackified
+size_t IRCompiler::stackify_operand(const std::vector<uint32_t>& instructions, uint32_t value, size_t end) {
+    if (end == 0 || instructions[end - 1] != value || uses[value] != 1)
+        return end;
+    is_stackified[value] = true;
+    return stackify_operands(instructions, value, end - 1);
+}
+
+size_t IRCompiler::stackify_operands(const std::vector<uint32_t>& instructions, uint32_t value, size_t end) {
+    for (int i = at(value).operand_count() - 1; i >= 0; i--)
+        end = stackify_operand(instructions, at(value).operands[i], end);
+    return end;
+}
+
+bool IRCompiler::needs_slot(uint32_t value) const {
+    const IRInstruction& instruction = at(value);
+    if (instruction.is_dead || instruction.op == IROp::CONSTANT)
+        return false;
+    return instruction.op == IROp::PHI || (instruction.has_value() && !is_stackified[value] && uses[value] > 0);
+}
+
+/* Finds the blocks each value is live in by walking back from its uses
+to its definition. A phi's operand is used at the end of the block it
+comes from, which is where its copy into the phi happens */
+void IRCompiler::find_liveness() {
+    size_t size = program->instructions.size();
+    positions.assign(size, 0);
+    block_starts.assign(program->blocks.size(), 0);
+    uint32_t position = 0;
+    for (uint32_t id : program->layout) {
+        const IRBlock& block = program->blocks[id];
+        block_starts[id] = position++;
+        for (uint32_t phi : block.phis)
+            positions[phi] = block_starts[id];
+        for (uint32_t value : block.instructions)
+            positions[value] = position++;
+        position++;
+    }
+
+    // The blocks each value is used in, and whether that's by a phi
+    std::vector<std::vector<std::pair<uint32_t, bool>>> use_blocks(size);
+    for (uint32_t id : program->layout) {
+        const IRBlock& block = program->blocks[id];
+        for (uint32_t phi : block.phis) {
+            for (int i = 0; i < 2; i++)
+                use_blocks[at(phi).operands[i]].push_back({block.predecessors[i], true});
+        }
+        for (uint32_t value : block.instructions) {
+            for (int i = 0; i < at(value).operand_count(); i++)
+                use_blocks[at(value).operands[i]].push_back({id, false});
+        }
+        if (block.terminator == IRBlock::BRANCH)
+            use_blocks[block.condition].push_back({id, false});
+    }
+
+    live_in.assign(size, {});
+    live_out.assign(size, {});
+    std::vector<uint32_t> in_mark(program->blocks.size(), IRProgram::none);
+    std::vector<uint32_t> out_mark(program->blocks.size(), IRProgram::none);
+    std::vector<uint32_t> worklist;
+    for (uint32_t value = 0; value < size; value++) {
+        if (use_blocks[value].empty() || !needs_slot(value))
+            continue;
+        uint32_t definition = at(value).block;
+        auto mark_out = [&](uint32_t block) {
+            if (out_mark[block] != value) {
+                out_mark[block] = value;
+                live_out[value].push_back(block);
+            }
+        };
+        auto mark_in = [&](uint32_t block) {
+            if (block != definition && in_mark[block] != value) {
+                in_mark[block] = value;
+                live_in[value].push_back(block);
+                worklist.push_back(block);
+            }
+        };
+
+        for (auto [block, is_phi_use] : use_blocks[value]) {
+            if (is_phi_use)
+                mark_out(block);
+            mark_in(block);
+        }
+        while (!worklist.empty()) {
+            uint32_t block = worklist.back();
+            worklist.pop_back();
+            for (uint32_t predecessor : program->blocks[block].predecessors) {
+                mark_out(predecessor);
+                mark_in(predecessor);
+            }
+        }
+        std::sort(live_in[value].begin(), live_in[value].end());
+        std::sort(live_out[value].begin(), live_out[value].end());
+    }
+}
+
+// Whether value is still needed after writer writes its slot
+bool IRCompiler::is_clobbered(uint32_t value, uint32_t writer) const {
+    const IRInstruction& instruction = at(writer);
+    // A phi is written at the end of each of its block's predecessors, right before the jump to it
+    if (instruction.op == IROp::PHI) {
+        if (at(value).op == IROp::PHI && at(value).block == instruction.block)
+            return true;
+        return std::binary_search(live_in[value].begin(), live_in[value].end(), instruction.block);
+    }
+
+    uint32_t block = instruction.block;
+    if (!std::binary_search(live_in[value].begin(), live_in[value].end(), block)
+        && (at(value).block != block || positions[value] >= positions[writer]))
+        return false;
+    if (std::binary_search(live_out[value].begin(), live_out[value].end(), block))
+        return true;
+
+    const IRBlock& ir_block = program->blocks[block];
+    if (ir_block.terminator == IRBlock::BRANCH && ir_block.condition == value)
+        return true;
+    for (size_t i = positions[writer] - block_starts[block]; i < ir_block.instructions.size(); i++) {
+        const IRInstruction& user = at(ir_block.instructions[i]);
+        for (int j = 0; j < user.operand_count(); j++) {
+            if (user.operands[j] == value)
+                return true;
+        }
+    }
+    return false;
+}
+
+/* Each phi is merged with its operands into one slot, unless one of them
+is written while another is still needed. Merges are capped so a long
+chain of ifs assigning the same variable doesn't go quadratic */
+void IRCompiler::assign_slots() {
+    static constexpr size_t max_merged = 32;
+    size_t size = program->instructions.size();
+    std::vector<uint32_t> parents(size);
+    std::iota(parents.begin(), parents.end(), 0);
+    std::vector<std::vector<uint32_t>> members(size);
+    auto find = [&](uint32_t value) {
+        while (parents[value] != value)
+            value = parents[value] = parents[parents[value]];
+        return value;
+    };
+
+    for (uint32_t id : program->layout) {
+        for (uint32_t phi : program->blocks[id].phis) {
+            for (uint32_t operand : at(phi).operands) {
+                if (!needs_slot(operand))
+                    continue;
+                uint32_t phi_root = find(phi), operand_root = find(operand);
+                if (phi_root == operand_root)
+                    continue;
+                if (members[phi_root].empty())
+                    members[phi_root].push_back(phi_root);
+                if (members[operand_root].empty())
+                    members[operand_root].push_back(operand_root);
+                if (members[phi_root].size() + members[operand_root].size() > max_merged)
+                    continue;
+
+                bool is_conflict = false;
+                for (uint32_t a : members[phi_root]) {
+                    for (uint32_t b : members[operand_root]) {
+                        if (is_clobbered(a, b) || is_clobbered(b, a)) {
+                            is_conflict = true;
+                            break;
+                        }
+                    }
+                    if (is_conflict)
+                        break;
+                }
+                if (is_conflict)
+                    continue;
+                parents[operand_root] = phi_root;
+                members[phi_root].insert(members[phi_root].end(), members[operand_root].begin(), members[operand_root].end());
+                members[operand_root].clear();
+            }
+        }
+    }
+
+    slots.assign(size, IRProgram::none);
+    std::vector<uint32_t> root_slots(size, IRProgram::none);
+    slot_count = 0;
+    for (uint32_t value = 0; value < size; value++) {
+        if (!needs_slot(value))
+            continue;
+        uint32_t root = find(value);
+        if (root_slots[root] == IRProgram::none) {
+            if (slot_count > UINT16_MAX)
+                throw_error("Too many local variables.");
+            root_slots[root] = slot_count++;
+        }
+        slots[value] = root_slots[root];
+    }
+}
+
+void IRCompiler::emit(uint8_t byte) {
+    chunk.write(byte);
+}
+
+void IRCompiler::emit(OpCode op, uint16_t operand) {
+    chunk.write(op);
+    chunk.write_short(operand);
+}
+
+void IRCompiler::emit_value(uint32_t value) {
+    if (program->is_constant(value)) {
+        const Value& constant = program->constant(value);
+        if (constant.is_void()) {
+            emit(OP_VOID);
+            return;
+        }
+        uint32_t& index = constant_indices[at(value).constant];
+        if (index == UINT32_MAX)
+            index = chunk.add_constant(constant);
+        if (index > UINT16_MAX)
+            throw_error("Too many constants in one program.");
+        emit(OP_CONSTANT, index);
+    }
+    else if (is_stackified[value])
+        emit_instruction(value);
+    else
+        emit(OP_GET_LOCAL, slots[value]);
+}
+
+static OpCode get_opcode(TokenType type) {
+    switch (type) {
+        case ADD: return OP_ADD;
+        case SUB: return OP_SUB;
+        case MUL: return OP_MUL;
+        case DIV: return OP_DIV;
+        case POW: return OP_POW;
+        case MOD: return OP_MOD;
+        case NEG: return OP_NEG;
+        case INC: return OP_INC;
+        case DEC: return OP_DEC;
+        case LESS: return OP_LESS;
+        case GREATER: return OP_GREATER;
+        case LESS_EQ: return OP_LESS_EQ;
+        case GREATER_EQ: return OP_GREATER_EQ;
+        case NOT_EQ: return OP_NOT_EQ;
+        case EQ: return OP_EQ;
+        case L_OR: return OP_L_OR;
+        case L_AND: return OP_L_AND;
+        case L_XOR: return OP_L_XOR;
+        case L_NOT: return OP_L_NOT;
+        case B_OR: return OP_B_OR;
+        case B_AND: return OP_B_AND;
+        case B_XOR: return OP_B_XOR;
+        case B_NOT: return OP_B_NOT;
+        case LSHFT: return OP_LSHFT;
+        case RSHFT: return OP_RSHFT;
+        case CHK: return OP_CHK;
+        case PRINT: return OP_PRINT;
+        default: return OP_TYPEOF;
+    }
+}
+
+void IRCompiler::emit_instruction(uint32_t value) {
+    const IRInstruction& instruction = at(value);
+    for (int i = 0; i < instruction.operand_count(); i++)
+        emit_value(instruction.operands[i]);
+    // Same as the Compiler, with the types the IROptimizer inferred
+    constexpr uint16_t i64 = 1 << static_cast<int>(LiteralType::I64);
+    OpCode op = get_opcode(instruction.type);
+    if (instruction.op == IROp::BINARY && at(instruction.operands[0]).types == i64 && at(instruction.operands[1]).types == i64)
+        op = int_opcode(op);
+    emit(op);
+}
+
+/* Copies the operands of target's phis that come from block into their
+slots. They're all pushed before any is stored, so a phi that's the
+operand of another one is read before it's overwritten */
+void IRCompiler::emit_phi_copies(uint32_t block, uint32_t target) {
+    const IRBlock& target_block = program->blocks[target];
+    int predecessor = target_block.predecessors[0] == block ? 0 : 1;
+    std::vector<uint32_t> copied;
+    for (uint32_t phi : target_block.phis) {
+        uint32_t operand = at(phi).operands[predecessor];
+        if (program->is_constant(operand) || slots[operand] != slots[phi]) {
+            emit_value(operand);
+            copied.push_back(phi);
+        }
+    }
+    for (auto phi = copied.rbegin(); phi != copied.rend(); phi++) {
+        emit(OP_SET_LOCAL, slots[*phi]);
+        emit(OP_POP);
+    }
+}
+
+// Back edges are always to a loop's header, which has already been emitted
+void IRCompiler::emit_jump(OpCode op, uint32_t block, uint32_t target) {
+    if (program->blocks[target].position <= program->blocks[block].position) {
+        // +3 to account for the OP_LOOP instruction itself
+        size_t offset = chunk.code.size() - block_offsets[target] + 3;
+        if (offset > UINT16_MAX)
+            throw_error("Loop body too large.");
+        emit(OP_LOOP, offset);
+        return;
+    }
+    emit(op, 0xFFFF);
+    jumps.push_back({chunk.code.size() - 2, target});
+}
+
+void IRCompiler::throw_error(std::string message) {
+    Tilda::had_error = true;
+    throw std::format("Compile Error: {}", message);
+}
\ No newline at end of file
@@ -0,0 +1,548 @@
+#include <stdint.h>
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <map>
+
+#include "interpreter.hpp"
+#include "iroptimizer.hpp"
+#include "ir.hpp"
+#include "tilda.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+static constexpr uint16_t bit(LiteralType type) {
+    return 1 << static_cast<int>(type);
+}
+
+static constexpr uint16_t numbers = bit(LiteralType::I64) | bit(LiteralType::F64);
+
+void IROptimizer::optimize(IRProgram& program) {
+    this->program = &program;
+    forward.clear();
+    stats = Stats();
+    stats.before = program.size();
+
+    simplify_phis();
+    fold_constants();
+    // Folding both operands of a phi into the same constant makes it trivial
+    simplify_phis();
+    infer_types();
+    fold_identities();
+    find_dominators();
+    eliminate_common_subexpressions();
+    hoist_invariants();
+    reduce_strength();
+    // Strength reduction makes the same multiplies for every use of an induction variable
+    eliminate_common_subexpressions();
+    eliminate_dead_code();
+    stats.after = program.size();
+}
+
+uint32_t IROptimizer::find(uint32_t value) {
+    if (value >= forward.size())
+        return value;
+    uint32_t root = value;
+    while (root < forward.size() && forward[root] != root)
+        root = forward[root];
+    while (value < forward.size() && forward[value] != value) {
+        uint32_t next = forward[value];
+        forward[value] = root;
+        value = next;
+    }
+    return root;
+}
+
+void IROptimizer::replace(uint32_t value, uint32_t replacement) {
+    if (forward.size() < program->instructions.size()) {
+        size_t size = forward.size();
+        forward.resize(program->instructions.size());
+        std::iota(forward.begin() + size, forward.end(), size);
+    }
+    forward[value] = replacement;
+    at(value).is_dead = true;
+}
+
+// Points every operand at what it was replaced with, and drops the replaced instructions
+void IROptimizer::canonicalize() {
+    auto is_dead = [&](uint32_t value) { return at(value).is_dead; };
+    for (IRBlock& block : program->blocks) {
+        std::erase_if(block.phis, is_dead);
+        std::erase_if(block.instructions, is_dead);
+        for (std::vector<uint32_t>* values : {&block.phis, &block.instructions}) {
+            for (uint32_t value : *values) {
+                IRInstruction& instruction = at(value);
+                for (int i = 0; i < instruction.operand_count(); i++)
+                    instruction.operands[i] = find(instruction.operands[i]);
+            }
+        }
+        if (block.terminator == IRBlock::BRANCH)
+            block.condition = find(block.condition);
+    }
+}
+
+bool IROptimizer::is_invariant(const IRLoop& loop, uint32_t value) {
+    return program->is_constant(value) || !loop.contains(*program, at(value).block);
+}
+
+/* Appends an i64 operator to the end of block, for operands that are
+known to be i64, or folds it when they're both constants */
+uint32_t IROptimizer::insert(uint32_t block, IROp op, TokenType type, uint32_t l_operand, uint32_t r_operand) {
+    if (program->is_constant(l_operand) && program->is_constant(r_operand))
+        return program->add_constant(Interpreter::apply_binary(type, program->constant(l_operand), program->constant(r_operand)));
+
+    IRInstruction instruction{op};
+    instruction.type = type;
+    instruction.types = bit(LiteralType::I64);
+    instruction.may_throw = false;
+    instruction.block = block;
+    instruction.operands = {l_operand, r_operand};
+    uint32_t value = program->add(instruction);
+    program->blocks[block].instructions.push_back(value);
+    return value;
+}
+
+/* A phi whose operands are all the same value (or the phi itself) is
+that value. Replacing one can make another trivial, hence the loop */
+void IROptimizer::simplify_phis() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (IRBlock& block : program->blocks) {
+            for (uint32_t phi : block.phis) {
+                if (at(phi).is_dead)
+                    continue;
+                uint32_t same = IRProgram::none;
+                bool is_trivial = true;
+                for (uint32_t operand : at(phi).operands) {
+                    operand = find(operand);
+                    if (operand == phi || operand == same)
+                        continue;
+                    if (same != IRProgram::none)
+                        is_trivial = false;
+                    same = operand;
+                }
+                if (is_trivial && same != IRProgram::none) {
+                    replace(phi, same);
+                    stats.simplified++;
+                    changed = true;
+                }
+            }
+        }
+    }
+    canonicalize();
+}
+
+// Same as the Optimizer, anything that would raise an error is left for the runtime to raise
+void IROptimizer::fold_constants() {
+    for (uint32_t block : program->layout) {
+        for (uint32_t value : program->blocks[block].instructions) {
+            IRInstruction instruction = at(value);
+            if (!instruction.has_value())
+                continue;
+            uint32_t l_operand = find(instruction.operands[0]);
+            uint32_t r_operand = instruction.operand_count() == 2 ? find(instruction.operands[1]) : IRProgram::none;
+            if (!program->is_constant(l_operand) || (r_operand != IRProgram::none && !program->is_constant(r_operand)))
+                continue;
+
+            bool had_runtime_error = Tilda::had_runtime_error;
+            Value result;
+            try {
+                const Value& l = program->constant(l_operand);
+                switch (instruction.op) {
+                    case IROp::UNARY: result = Interpreter::apply_unary(instruction.type, l); break;
+                    case IROp::BINARY: result = Interpreter::apply_binary(instruction.type, l, program->constant(r_operand)); break;
+                    case IROp::LOGICAL: result = Interpreter::apply_logical(instruction.type, l, program->constant(r_operand)); break;
+                    case IROp::BITWISE: result = Interpreter::apply_bitwise(instruction.type, l, program->constant(r_operand)); break;
+                    default: continue;
+                }
+            }
+            catch (std::string message) {
+                Tilda::had_runtime_error = had_runtime_error;
+                continue;
+            }
+            replace(value, program->add_constant(result));
+            stats.folded++;
+        }
+    }
+    canonicalize();
+}
+
+/* The type of the result of an operator on one combination of operand
+types, mirroring Interpreter::apply_*. Sets may_throw for a combination
+that raises an error */
+static uint16_t result_type(const IRInstruction& instruction, LiteralType l_type, LiteralType r_type, bool is_nonzero_divisor, bool& may_throw) {
+    TokenType type = instruction.type;
+    bool is_comparison = type == GREATER || type == GREATER_EQ || type == LESS
+        || type == LESS_EQ || type == EQ || type == NOT_EQ;
+    switch (instruction.op) {
+        case IROp::UNARY:
+            if (type == L_NOT)
+                return bit(LiteralType::BOOL);
+            if (l_type == LiteralType::I64)
+                return bit(LiteralType::I64);
+            if (l_type == LiteralType::F64 && type != B_NOT)
+                return bit(LiteralType::F64);
+            break;
+        case IROp::BINARY:
+            switch (Value::type_pair(l_type, r_type)) {
+                case Value::type_pair(LiteralType::I64, LiteralType::I64):
+                    if ((type == DIV || type == MOD) && !is_nonzero_divisor)
+                        may_throw = true;
+                    return is_comparison ? bit(LiteralType::BOOL) : bit(LiteralType::I64);
+                case Value::type_pair(LiteralType::F64, LiteralType::F64):
+                    return is_comparison ? bit(LiteralType::BOOL) : bit(LiteralType::F64);
+                case Value::type_pair(LiteralType::STR, LiteralType::STR):
+                    if (type == EQ || type == NOT_EQ)
+                        return bit(LiteralType::BOOL);
+                    if (type == ADD)
+                        return bit(LiteralType::STR);
+                    break;
+                case Value::type_pair(LiteralType::BOOL, LiteralType::BOOL):
+                    if (type == EQ || type == NOT_EQ)
+                        return bit(LiteralType::BOOL);
+                    break;
+            }
+            break;
+        case IROp::LOGICAL:
+            return bit(LiteralType::BOOL);
+        case IROp::BITWISE:
+            if (l_type == LiteralType::I64 && r_type == LiteralType::I64)
+                return bit(LiteralType::I64);
+            break;
+        default: break;
+    }
+    may_throw = true;
+    return 0;
+}
+
+/* Finds the types each value can have, as a set of LiteralTypes, and
+whether it can raise an error. Phis start out with no types and grow
+until nothing changes, so a loop's phis get the types of its values */
+void IROptimizer::infer_types() {
+    for (uint32_t block : program->layout) {
+        for (uint32_t phi : program->blocks[block].phis)
+            at(phi).types = 0;
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t block : program->layout) {
+            for (uint32_t phi : program->blocks[block].phis) {
+                IRInstruction& instruction = at(phi);
+                uint16_t types = instruction.types | at(instruction.operands[0]).types | at(instruction.operands[1]).types;
+                changed = changed || types != instruction.types;
+                instruction.types = types;
+            }
+            for (uint32_t value : program->blocks[block].instructions) {
+                IRInstruction& instruction = at(value);
+                if (!instruction.has_value()) {
+                    instruction.may_throw = false;
+                    continue;
+                }
+
+                uint16_t l_types = at(instruction.operands[0]).types;
+                uint16_t r_types = instruction.operand_count() == 2 ? at(instruction.operands[1]).types : bit(LiteralType::VOID);
+                uint32_t r_operand = instruction.operands[1];
+                bool is_nonzero_divisor = instruction.operand_count() == 2 && program->is_constant(r_operand)
+                    && program->constant(r_operand).is_int() && program->constant(r_operand).integer != 0;
+
+                uint16_t types = 0;
+                // Nothing is known about a value whose operands have no types yet
+                bool may_throw = l_types == 0 || r_types == 0;
+                for (int l = 0; l < 16; l++) {
+                    if (!(l_types & (1 << l)))
+                        continue;
+                    for (int r = 0; r < 16; r++) {
+                        if (r_types & (1 << r))
+                            types |= result_type(instruction, static_cast<LiteralType>(l), static_cast<LiteralType>(r), is_nonzero_divisor, may_throw);
+                    }
+                }
+                changed = changed || types != instruction.types;
+                instruction.types = types;
+                instruction.may_throw = may_throw;
+            }
+        }
+    }
+}
+
+/* x + 0, x - 0, x * 1 and x / 1 are x when x is always an i64. Not for
+f64, where -0.0 + 0 is 0.0, or anything else, where they raise errors */
+void IROptimizer::fold_identities() {
+    for (uint32_t block : program->layout) {
+        for (uint32_t value : program->blocks[block].instructions) {
+            const IRInstruction& instruction = at(value);
+            if (instruction.op != IROp::BINARY || !program->is_constant(instruction.operands[1]))
+                continue;
+            uint32_t l_operand = instruction.operands[0];
+            const Value& r_operand = program->constant(instruction.operands[1]);
+            if (at(l_operand).types != bit(LiteralType::I64) || !r_operand.is_int())
+                continue;
+            bool is_identity = r_operand.integer == 0 ? instruction.type == ADD || instruction.type == SUB
+                : r_operand.integer == 1 && (instruction.type == MUL || instruction.type == DIV);
+            if (is_identity) {
+                replace(value, l_operand);
+                stats.folded++;
+            }
+        }
+    }
+    canonicalize();
+}
+
+/* Cooper, Harvey and Kennedy's "A Simple, Fast Dominance Algorithm",
+with the layout as the reverse postorder: every edge but a loop's back
+edge goes forward in it, so a block's dominators all come before it */
+void IROptimizer::find_dominators() {
+    std::vector<IRBlock>& blocks = program->blocks;
+    dominators.assign(blocks.size(), IRProgram::none);
+    dominators[program->layout[0]] = program->layout[0];
+
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b) {
+            while (blocks[a].position > blocks[b].position)
+                a = dominators[a];
+            while (blocks[b].position > blocks[a].position)
+                b = dominators[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < program->layout.size(); i++) {
+            uint32_t block = program->layout[i];
+            uint32_t dominator = IRProgram::none;
+            for (uint32_t predecessor : blocks[block].predecessors) {
+                if (dominators[predecessor] == IRProgram::none)
+                    continue;
+                dominator = dominator == IRProgram::none ? predecessor : intersect(predecessor, dominator);
+            }
+            if (dominators[block] != dominator) {
+                dominators[block] = dominator;
+                changed = true;
+            }
+        }
+    }
+}
+
+static bool is_commutative(const IRInstruction& instruction, uint16_t l_types, uint16_t r_types) {
+    switch (instruction.op) {
+        case IROp::LOGICAL:
+            return true;
+        case IROp::BITWISE:
+            return instruction.type == B_OR || instruction.type == B_AND || instruction.type == B_XOR;
+        case IROp::BINARY:
+            if (instruction.type == EQ || instruction.type == NOT_EQ)
+                return true;
+            // Not for strings, where + concatenates
+            return (instruction.type == ADD || instruction.type == MUL)
+                && (l_types & ~numbers) == 0 && (r_types & ~numbers) == 0;
+        default:
+            return false;
+    }
+}
+
+/* Walks the dominator tree with a table of the operators seen in the
+blocks above, so an operator that's already been computed on the same
+operands on every path here is replaced with the earlier one. An
+operator that raises an error would have raised it the first time */
+void IROptimizer::eliminate_common_subexpressions() {
+    typedef std::tuple<IROp, TokenType, uint32_t, uint32_t> Key;
+    std::map<Key, uint32_t> available;
+    std::vector<Key> added;
+
+    std::vector<std::vector<uint32_t>> children(program->blocks.size());
+    for (size_t i = 1; i < program->layout.size(); i++)
+        children[dominators[program->layout[i]]].push_back(program->layout[i]);
+
+    // The block, how many of its children have been visited, and the size of added when it was entered
+    std::vector<std::tuple<uint32_t, size_t, size_t>> stack;
+    stack.push_back({program->layout[0], 0, 0});
+    bool is_entering = true;
+    while (!stack.empty()) {
+        auto& [block, child, mark] = stack.back();
+        if (is_entering) {
+            mark = added.size();
+            for (uint32_t value : program->blocks[block].instructions) {
+                IRInstruction& instruction = at(value);
+                if (!instruction.has_value())
+                    continue;
+                uint32_t l_operand = find(instruction.operands[0]);
+                uint32_t r_operand = find(instruction.operands[1]);
+                if (instruction.operand_count() == 2 && l_operand > r_operand
+                    && is_commutative(instruction, at(l_operand).types, at(r_operand).types))
+                    std::swap(l_operand, r_operand);
+
+                Key key = {instruction.op, instruction.type, l_operand, r_operand};
+                auto found = available.find(key);
+                if (found != available.end()) {
+                    replace(value, found->second);
+                    stats.cse++;
+                }
+                else {
+                    available.insert({key, value});
+                    added.push_back(key);
+                }
+            }
+        }
+
+        if (child < children[block].size()) {
+            uint32_t next = children[block][child++];
+            stack.push_back({next, 0, 0});
+            is_entering = true;
+        }
+        else {
+            while (added.size() > mark) {
+                available.erase(added.back());
+                added.pop_back();
+            }
+            stack.pop_back();
+            is_entering = false;
+        }
+    }
+    canonicalize();
+}
+
+/* Moves operators whose operands are all defined outside a loop to the
+end of its preheader, inner loops first so their invariants can keep
+moving out. One that can raise an error only moves out of the header,
+and only if nothing before it in there has an effect: the header always
+runs right after the preheader, so the error is raised at the same point */
+void IROptimizer::hoist_invariants() {
+    for (const IRLoop& loop : program->loops) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (uint32_t position = program->blocks[loop.header].position; position <= program->blocks[loop.latch].position; position++) {
+                uint32_t block = program->layout[position];
+                std::vector<uint32_t>& instructions = program->blocks[block].instructions;
+                bool is_after_effect = block != loop.header;
+                for (size_t i = 0; i < instructions.size();) {
+                    uint32_t value = instructions[i];
+                    IRInstruction& instruction = at(value);
+                    bool is_hoistable = instruction.has_value() && (!instruction.may_throw || !is_after_effect);
+                    for (int j = 0; j < instruction.operand_count() && is_hoistable; j++)
+                        is_hoistable = is_invariant(loop, instruction.operands[j]);
+                    if (is_hoistable) {
+                        program->blocks[loop.preheader].instructions.push_back(value);
+                        instruction.block = loop.preheader;
+                        instructions.erase(instructions.begin() + i);
+                        stats.hoisted++;
+                        changed = true;
+                        continue;
+                    }
+                    is_after_effect = is_after_effect || instruction.has_effect();
+                    i++;
+                }
+            }
+        }
+    }
+}
+
+/* An induction variable is a header phi p = [init, p + c] (or p - c),
+where p is always an i64 and c is an invariant i64. Any p * k in the
+loop with an invariant i64 k is then a new phi q = [init * k, q + c * k],
+which trades the multiply for an add. Both sides wrap the same way, so
+they agree even when p * k overflows */
+void IROptimizer::reduce_strength() {
+    for (const IRLoop& loop : program->loops) {
+        size_t phi_count = program->blocks[loop.header].phis.size();
+        for (size_t i = 0; i < phi_count; i++) {
+            uint32_t phi = program->blocks[loop.header].phis[i];
+            if (at(phi).types != bit(LiteralType::I64))
+                continue;
+            uint32_t init = at(phi).operands[0], next = at(phi).operands[1];
+            const IRInstruction& step = at(next);
+            if (step.op != IROp::BINARY || (step.type != ADD && step.type != SUB))
+                continue;
+            uint32_t increment;
+            if (step.operands[0] == phi)
+                increment = step.operands[1];
+            else if (step.type == ADD && step.operands[1] == phi)
+                increment = step.operands[0];
+            else
+                continue;
+            if (at(increment).types != bit(LiteralType::I64) || !is_invariant(loop, increment))
+                continue;
+            TokenType step_type = step.type;
+
+            for (uint32_t position = program->blocks[loop.header].position; position <= program->blocks[loop.latch].position; position++) {
+                uint32_t block = program->layout[position];
+                for (size_t j = 0; j < program->blocks[block].instructions.size(); j++) {
+                    uint32_t value = program->blocks[block].instructions[j];
+                    const IRInstruction& multiply = at(value);
+                    if (multiply.is_dead || multiply.op != IROp::BINARY || multiply.type != MUL)
+                        continue;
+                    uint32_t factor;
+                    if (multiply.operands[0] == phi)
+                        factor = multiply.operands[1];
+                    else if (multiply.operands[1] == phi)
+                        factor = multiply.operands[0];
+                    else
+                        continue;
+                    if (at(factor).types != bit(LiteralType::I64) || !is_invariant(loop, factor))
+                        continue;
+
+                    uint32_t start = insert(loop.preheader, IROp::BINARY, MUL, init, factor);
+                    uint32_t stride = insert(loop.preheader, IROp::BINARY, MUL, increment, factor);
+                    IRInstruction reduced{IROp::PHI};
+                    reduced.types = bit(LiteralType::I64);
+                    reduced.may_throw = false;
+                    reduced.block = loop.header;
+                    uint32_t reduced_phi = program->add(reduced);
+                    program->blocks[loop.header].phis.push_back(reduced_phi);
+                    uint32_t reduced_next = insert(loop.latch, IROp::BINARY, step_type, reduced_phi, stride);
+                    at(reduced_phi).operands = {start, reduced_next};
+                    replace(value, reduced_phi);
+                    stats.reduced++;
+                }
+            }
+        }
+    }
+    canonicalize();
+}
+
+/* Everything that prints, can raise an error, or decides a branch is
+live, and so is everything they use. The rest is removed, which is also
+what's left of dead stores: a variable assigned a value no one reads */
+void IROptimizer::eliminate_dead_code() {
+    std::vector<bool> is_live(program->instructions.size());
+    std::vector<uint32_t> worklist;
+    auto mark = [&](uint32_t value) {
+        if (!is_live[value] && !program->is_constant(value)) {
+            is_live[value] = true;
+            worklist.push_back(value);
+        }
+    };
+
+    for (const IRBlock& block : program->blocks) {
+        for (uint32_t value : block.instructions) {
+            if (at(value).has_effect())
+                mark(value);
+        }
+        if (block.terminator == IRBlock::BRANCH)
+            mark(block.condition);
+    }
+    while (!worklist.empty()) {
+        const IRInstruction& instruction = at(worklist.back());
+        worklist.pop_back();
+        for (int i = 0; i < instruction.operand_count(); i++)
+            mark(instruction.operands[i]);
+    }
+
+    for (IRBlock& block : program->blocks) {
+        for (std::vector<uint32_t>* values : {&block.phis, &block.instructions}) {
+            for (uint32_t value : *values) {
+                if (!is_live[value]) {
+                    at(value).is_dead = true;
+                    stats.removed++;
+                }
+            }
+        }
+    }
+    canonicalize();
+}
\ No newline at end of file
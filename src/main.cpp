@@ -1,25 +1,182 @@
 #include <stdint.h>
+#include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#include <chrono>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <ostream>
+#include <format>
 #include <string>
 #include <vector>
+#include <optional>
+#include <deque>
+#include <span>
+#include <thread>
 
 #include "interpreter.hpp"
+#include "closure.hpp"
+#include "ast.hpp"
 #include "expression.hpp"
 #include "statement.hpp"
+#include "compiler.hpp"
+#include "optimizer.hpp"
+#include "ir.hpp"
+#include "iroptimizer.hpp"
+#include "ircompiler.hpp"
+#include "frontend.hpp"
+#include "cache.hpp"
+#include "source.hpp"
+#include "simd.hpp"
+#include "arena.hpp"
+#include "resolver.hpp"
+#include "typechecker.hpp"
 #include "scanner.hpp"
 #include "parser.hpp"
 #include "tilda.hpp"
 #include "token.hpp"
+#include "vm.hpp"
+#include "regcompiler.hpp"
+#include "regvm.hpp"
 
-void print_token_values(std::vector<Token> toks) {
-    for (Token tok : toks)
-        std::cout << Token::token_type_names[tok.type] << ": " << tok.lexeme << std::endl;
+enum class Engine {
+    INTERPRETER,
+    CLOSURE,
+    VM,
+    REGVM
+};
+
+bool print_stats = false;
+bool stream = false;
+// Threads for the batch front end, set by --jobs
+int jobs = 1;
+// Print the AST after the Optimizer, before it runs
+bool dump_ast = false;
+// Lower a file to the IR and optimize it there, set by -O
+bool optimize_ir = false;
+// Print the IR after the IROptimizer, set by --dump-ir
+bool dump_ir = false;
+// Print the register VM's code as it's compiled, set by --disassemble
+bool disassemble = false;
+
+#ifdef TILDA_COUNT_ALLOCATIONS
+/* In a "make stats" build, every heap allocation in the program goes through here,
+so --stats can show how many the parser makes. Relaxed, since it's only ever read
+as a total. Left out otherwise, so other builds don't pay for it on every allocation */
+std::atomic<size_t> heap_allocations = 0;
+
+// Kept out of line, so GCC doesn't see malloc and free through them and warn they don't match new and delete
+[[gnu::noinline]] void* operator new(size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+#endif
+
+/* Front-end numbers for --stats, taken before the scanner goes out of scope.
+With --stream they're the peaks over every top-level statement */
+struct FrontEndStats {
+    size_t tokens = 0;
+    size_t token_bytes = 0;
+    size_t arena_bytes = 0;
+    // Summed over every parse
+    size_t parse_allocations = 0;
+} front_end_stats;
+
+void record_tokens(const TokenBuffer& tokens) {
+    front_end_stats.tokens = std::max(front_end_stats.tokens, tokens.size());
+    front_end_stats.token_bytes = std::max(front_end_stats.token_bytes, tokens.bytes());
+}
+
+void record_arena(Arena& arena) {
+    front_end_stats.arena_bytes = std::max(front_end_stats.arena_bytes, arena.bytes_used());
+}
+
+// Totals over every section of a --jobs parse
+void record_front_end(FrontEnd& front_end) {
+    front_end_stats.tokens = front_end.tokens();
+    front_end_stats.token_bytes = front_end.token_bytes();
+    front_end_stats.arena_bytes = front_end.arena_bytes();
 }
 
-std::string get_statement_type(ShrStmtPtr statement) {
+// Runs parse and counts the heap allocations it makes
+template<typename F>
+auto count_allocations(F parse) {
+#ifdef TILDA_COUNT_ALLOCATIONS
+    size_t before = heap_allocations.load(std::memory_order_relaxed);
+    auto result = parse();
+    front_end_stats.parse_allocations += heap_allocations.load(std::memory_order_relaxed) - before;
+    return result;
+#else
+    return parse();
+#endif
+}
+
+// Set when -O ran the program from the IR
+std::optional<IROptimizer::Stats> ir_stats;
+
+void report_stats(Engine engine, Interpreter& interpreter) {
+    if (!print_stats)
+        return;
+    std::cout << std::format("[stats] tokens: {} ({} bytes)", front_end_stats.tokens, front_end_stats.token_bytes) << std::endl;
+    std::cout << std::format("[stats] AST arena bytes: {}", front_end_stats.arena_bytes) << std::endl;
+#ifdef TILDA_COUNT_ALLOCATIONS
+    std::cout << std::format("[stats] parser heap allocations: {}", front_end_stats.parse_allocations) << std::endl;
+#endif
+    // The closure engine runs on the Interpreter's scopes, but has no quickened operators
+    if (engine == Engine::INTERPRETER || engine == Engine::CLOSURE) {
+        std::cout << std::format("[stats] scope stack allocations: {}", interpreter.scope_allocations()) << std::endl;
+        if (engine == Engine::INTERPRETER && !ir_stats)
+            std::cout << std::format("[stats] quickened operators: {} specialized ({} statically typed), {} deoptimized",
+                interpreter.specialized(), interpreter.statically_specialized(), interpreter.deoptimized()) << std::endl;
+    }
+    if (ir_stats) {
+        std::cout << std::format("[stats] IR instructions: {} -> {}", ir_stats->before, ir_stats->after) << std::endl;
+        std::cout << std::format("[stats] IR phis simplified: {}, folded: {}, CSE: {}, hoisted: {}, strength reduced: {}, removed: {}",
+            ir_stats->simplified, ir_stats->folded, ir_stats->cse, ir_stats->hoisted, ir_stats->reduced, ir_stats->removed) << std::endl;
+    }
+}
+
+void print_token_values(const TokenBuffer& toks) {
+    for (size_t i = 0; i < toks.size(); i++)
+        std::cout << Token::token_type_names[toks.type(i)] << ": " << toks.lexeme(i) << std::endl;
+}
+
+void print_ast(std::span<const StmtPtr> statements) {
+    AST ast;
+    for (StmtPtr statement : statements)
+        std::cout << ast.print(statement);
+}
+
+bool declares_function(std::span<const StmtPtr> statements) {
+    for (StmtPtr statement : statements)
+        if (dynamic_cast<const FunctionStatement*>(statement))
+            return true;
+    return false;
+}
+
+std::string get_statement_type(StmtPtr statement) {
     if (typeid(*statement) == typeid(Statement))
         return "Statement";
     else if (typeid(*statement) == typeid(ExpressionStatement))
@@ -46,31 +203,177 @@ std::string get_statement_type(ShrStmtPtr statement) {
         return "ReturnStatement";
     else if (typeid(*statement) == typeid(StructStatement))
         return "StructStatement";
+    else if (typeid(*statement) == typeid(FunctionStatement))
+        return "FunctionStatement";
     else
         return "Unknown Statement type";
 }
 
-void from_file(std::string path) {
-    std::fstream fstream(path);
-    std::string src;
+/* Lowers statements to the IR and optimizes them there, for -O. Programs
+with functions can't be lowered, and are left to the AST */
+std::optional<IRProgram> build_ir(std::span<const StmtPtr> statements) {
+    IRBuilder builder;
+    std::optional<IRProgram> program = builder.build(statements);
+    if (!program)
+        return std::nullopt;
+    IROptimizer optimizer;
+    optimizer.optimize(*program);
+    ir_stats = optimizer.get_stats();
+    if (dump_ir)
+        std::cout << program->print();
+    return program;
+}
+
+// Runs path's .tdac if it's fresh, returning false if there isn't one
+bool from_cache(std::string path, std::string_view src, Interpreter& interpreter) {
+    Chunk chunk;
+    std::string cache_path = Cache::path_for(path);
+    if (!Cache::load(cache_path, Cache::hash(src), chunk))
+        return false;
+
+    VM vm;
+    try {
+        vm.run(chunk);
+    }
+    catch (std::string message) {
+        std::cout << message << std::endl;
+    }
+    if (print_stats)
+        std::cout << std::format("[stats] loaded bytecode from {}", cache_path) << std::endl;
+    report_stats(Engine::VM, interpreter);
+    Tilda::had_error = Tilda::had_runtime_error = false;
+    return true;
+}
+
+// The register VM compiles function bodies on their first call, after the same passes as the Interpreter
+void set_passes(RegCompiler& reg_compiler, Resolver& resolver, Typechecker& typechecker, Optimizer& optimizer) {
+    reg_compiler.set_resolver(&resolver);
+    reg_compiler.set_typechecker(&typechecker);
+    reg_compiler.set_optimizer(&optimizer);
+    reg_compiler.set_disassemble(disassemble);
+}
 
+// A fresh cache is only run on the VM, so use_cache is off when the interpreter was asked for
+void from_file(std::string path, Engine engine, bool use_cache) {
+    Source source;
+    Arena arena;
+    FrontEnd front_end;
+    Resolver resolver;
+    Typechecker typechecker;
+    Optimizer optimizer;
     Interpreter interpreter;
+    ClosureCompiler closures(interpreter);
+    Compiler compiler;
+    VM vm;
+    RegCompiler reg_compiler;
+    RegVM reg_vm(reg_compiler);
 
-    if (fstream) {
-        std::ostringstream stringstream;
-        stringstream << fstream.rdbuf() << "\n";
-        src = stringstream.str();
+    if (!source.load(path)) {
+        std::cout << "Input file could not be read" << std::endl;
+        return;
     }
-    else {
+    if (use_cache && !stream && from_cache(path, source.text(), interpreter))
+        return;
+
+    try {
+        if (stream) {
+            /* Each top-level statement runs as soon as it's parsed, then its
+            tokens and AST are thrown away, so statements that ran before an
+            error later in the file have already had their effects */
+            Scanner scanner(source.text(), true);
+            Parser parser(scanner, arena);
+            interpreter.set_resolver(&resolver);
+            interpreter.set_typechecker(&typechecker);
+            interpreter.set_optimizer(&optimizer);
+            set_passes(reg_compiler, resolver, typechecker, optimizer);
+            bool keep_arena = false;
+            while (StmtPtr statement = count_allocations([&] { return parser.parse_next(); })) {
+                record_tokens(scanner.tokens);
+                record_arena(arena);
+                resolver.resolve({&statement, 1});
+                typechecker.check({&statement, 1});
+                std::vector<StmtPtr> statements = optimizer.optimize({&statement, 1});
+                if (dump_ast)
+                    print_ast(statements);
+                if (engine == Engine::VM)
+                    vm.run(compiler.compile(statements));
+                else if (engine == Engine::CLOSURE)
+                    closures.run(statements);
+                else if (engine == Engine::REGVM)
+                    reg_vm.run(reg_compiler.compile(statements));
+                else
+                    interpreter.interpret(statements);
+                // A function's AST has to outlive the statement that declared it
+                keep_arena = keep_arena || declares_function({&statement, 1});
+                if (!keep_arena)
+                    arena.reset();
+            }
+        }
+        else {
+            // The front end outlives the whole run, so function bodies can wait until they're called
+            std::vector<StmtPtr> statements = count_allocations([&] { return front_end.parse(source.text(), jobs); });
+            record_front_end(front_end);
+            interpreter.set_resolver(&resolver);
+            interpreter.set_typechecker(&typechecker);
+            interpreter.set_optimizer(&optimizer);
+            set_passes(reg_compiler, resolver, typechecker, optimizer);
+            resolver.resolve(statements);
+            typechecker.check(statements);
+            statements = optimizer.optimize(statements);
+            if (dump_ast)
+                print_ast(statements);
+            /* The closure engine and the register VM specialize on the typed AST
+            themselves, and running the IR would mean running another engine, so
+            -O doesn't apply to them */
+            bool lower = optimize_ir && engine != Engine::CLOSURE && engine != Engine::REGVM;
+            std::optional<IRProgram> program = lower ? build_ir(statements) : std::nullopt;
+            if (program && engine == Engine::VM) {
+                IRCompiler ir_compiler;
+                vm.run(ir_compiler.compile(*program));
+            }
+            else if (program)
+                interpreter.interpret(*program);
+            else if (engine == Engine::VM)
+                vm.run(compiler.compile(statements));
+            else if (engine == Engine::CLOSURE)
+                closures.run(statements);
+            else if (engine == Engine::REGVM)
+                reg_vm.run(reg_compiler.compile(statements));
+            else
+                interpreter.interpret(statements);
+        }
+    }
+    catch (std::string message) {
+        std::cout << message << std::endl;
+    }
+    report_stats(engine, interpreter);
+    Tilda::had_error = Tilda::had_runtime_error = false;
+}
+
+// "tilda compile file" writes file's bytecode to its .tdac, for from_file to pick up
+void compile_file(std::string path) {
+    Source source;
+    FrontEnd front_end;
+    Resolver resolver;
+    Typechecker typechecker;
+    Optimizer optimizer;
+    Compiler compiler;
+
+    if (!source.load(path)) {
         std::cout << "Input file could not be read" << std::endl;
         return;
     }
 
     try {
-        Scanner scanner(src);
-        Parser parser(scanner.tokens);
-        std::vector<ShrStmtPtr> statements = parser.parse();
-        interpreter.interpret(statements);
+        std::vector<StmtPtr> statements = front_end.parse(source.text(), jobs);
+        resolver.resolve(statements);
+        typechecker.check(statements);
+        statements = optimizer.optimize(statements);
+        std::optional<IRProgram> program = optimize_ir ? build_ir(statements) : std::nullopt;
+        IRCompiler ir_compiler;
+        Chunk chunk = program ? ir_compiler.compile(*program) : compiler.compile(statements);
+        if (!Cache::save(Cache::path_for(path), Cache::hash(source.text()), chunk))
+            std::cout << "Cache file could not be written" << std::endl;
     }
     catch (std::string message) {
         std::cout << message << std::endl;
@@ -78,43 +381,162 @@ void from_file(std::string path) {
     Tilda::had_error = Tilda::had_runtime_error = false;
 }
 
-void from_repl() {
-    std::string line;
+// Scans path repeatedly for about a second and reports the throughput
+void bench_scan(std::string path) {
+    Source source;
+    if (!source.load(path)) {
+        std::cout << "Input file could not be read" << std::endl;
+        return;
+    }
+
+    double megabytes = source.text().length() / (1024.0 * 1024.0);
+    size_t runs = 0, tokens = 0;
+    auto begin = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed;
+    try {
+        do {
+            Scanner scanner(source.text());
+            tokens = scanner.tokens.size();
+            runs++;
+            elapsed = std::chrono::steady_clock::now() - begin;
+        } while (elapsed.count() < 1.0);
+    }
+    catch (std::string message) {
+        std::cout << message << std::endl;
+        return;
+    }
+    std::cout << std::format("scanned {:.2f} MB ({} tokens) {} times in {:.3f}s: {:.1f} MB/s [{}]",
+        megabytes, tokens, runs, elapsed.count(), megabytes * runs / elapsed.count(), Simd::name(Simd::level())) << std::endl;
+}
+
+void from_repl(Engine engine) {
     std::cout << "tilda ~ alpha v0.1" << std::endl;
 
+    /* Nothing holds on to a line's AST once it has run, so one arena is reused
+    for every line. The exception is a function, whose line and AST are kept,
+    since the passes hold on to it and its identifiers point into the line */
+    std::deque<std::string> lines(1);
+    bool keep_arena = false;
+    Arena arena;
+    Resolver resolver;
+    Typechecker typechecker;
+    Optimizer optimizer;
     Interpreter interpreter;
+    ClosureCompiler closures(interpreter);
+    Compiler compiler;
+    VM vm;
+    RegCompiler reg_compiler;
+    RegVM reg_vm(reg_compiler);
+    interpreter.set_resolver(&resolver);
+    interpreter.set_typechecker(&typechecker);
+    interpreter.set_optimizer(&optimizer);
+    set_passes(reg_compiler, resolver, typechecker, optimizer);
 
     // Main loop
-    while (std::cout << ">> " && std::getline(std::cin, line)) {
+    while (std::cout << ">> " && std::getline(std::cin, lines.back())) {
+        std::string& line = lines.back();
         if (line == "q")
             std::exit(0);
-        // stdin consumes newline, so add it back
-        line += "\n";
         // Handle empty line
-        if (line == "\n")
+        if (line.empty())
             continue;
 
+        if (!keep_arena)
+            arena.reset();
         try {
             Scanner scanner(line);
-            Parser parser(scanner.tokens);
-            std::vector<ShrStmtPtr> statements = parser.parse();
-            // Typechecker typechecker(statements);
-            interpreter.interpret(statements);
+            record_tokens(scanner.tokens);
+            Parser parser(scanner.tokens, arena);
+            std::vector<StmtPtr> statements = count_allocations([&] { return parser.parse(); });
+            record_arena(arena);
+            // Before the Resolver sees the function, so an error later in the line can't lose it
+            if (declares_function(statements)) {
+                keep_arena = true;
+                lines.emplace_back();
+            }
+            resolver.resolve(statements);
+            typechecker.check(statements);
+            statements = optimizer.optimize(statements);
+            if (dump_ast)
+                print_ast(statements);
+            if (engine == Engine::VM)
+                vm.run(compiler.compile(statements));
+            else if (engine == Engine::CLOSURE)
+                closures.run(statements);
+            else if (engine == Engine::REGVM)
+                reg_vm.run(reg_compiler.compile(statements));
+            else
+                interpreter.interpret(statements);
         }
         catch (std::string message) {
             std::cout << message << std::endl;
+            if (Tilda::had_runtime_error)
+                typechecker.forget_initializers();
         }
+        report_stats(engine, interpreter);
         Tilda::had_error = Tilda::had_runtime_error = false;
     }
 }
 
 int main(int argc, char* argv[]) {
-    if (argc > 2)
-        std::cout << "usage: tilda [file]" << std::endl;
-    else if (argc == 1) {
-        from_repl();
+    Engine engine = Engine::INTERPRETER;
+    bool engine_chosen = false;
+    bool bench = false;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--engine=vm" || arg == "--engine=regvm" || arg == "--engine=closure" || arg == "--engine=interpreter") {
+            engine = arg == "--engine=vm" ? Engine::VM : arg == "--engine=regvm" ? Engine::REGVM
+                : arg == "--engine=closure" ? Engine::CLOSURE : Engine::INTERPRETER;
+            engine_chosen = true;
+        }
+        else if (arg == "--stats")
+            print_stats = true;
+        else if (arg == "--stream")
+            stream = true;
+        else if (arg.starts_with("--jobs=")) {
+            jobs = std::atoi(arg.c_str() + 7);
+            // --jobs=0 takes one per core
+            if (jobs <= 0)
+                jobs = std::max<int>(std::thread::hardware_concurrency(), 1);
+        }
+        else if (arg == "--dump-ast")
+            dump_ast = true;
+        else if (arg == "-O")
+            optimize_ir = true;
+        else if (arg == "--dump-ir")
+            optimize_ir = dump_ir = true;
+        else if (arg == "--disassemble")
+            disassemble = true;
+        else if (arg == "--bench-scan")
+            bench = true;
+        else if (arg == "--simd=scalar")
+            Simd::use(SimdLevel::SCALAR);
+        else if (arg == "--simd=sse2")
+            Simd::use(SimdLevel::SSE2);
+        else if (arg == "--simd=avx2")
+            Simd::use(SimdLevel::AVX2);
+        else
+            args.push_back(arg);
+    }
+
+    if (args.size() == 2 && args[0] == "compile")
+        compile_file(args[1]);
+    else if (args.size() > 1 || (!args.empty() && args[0].starts_with("-")))
+        std::cout << "usage: tilda [--engine=interpreter|closure|vm|regvm] [--stream] [--jobs=N] [--stats] [--dump-ast] [-O] [--dump-ir] [--disassemble] [--simd=scalar|sse2|avx2] [file]\n"
+            "       tilda compile [-O] file" << std::endl;
+    else if (bench) {
+        if (args.empty())
+            std::cout << "usage: tilda --bench-scan [--simd=scalar|sse2|avx2] file" << std::endl;
+        else
+            bench_scan(args[0]);
+    }
+    else if (args.empty()) {
+        from_repl(engine);
     }
     else {
-        from_file(argv[1]);
+        // A cache has no AST or IR to dump, and -O asks for a fresh compile
+        from_file(args[0], engine, (engine == Engine::VM || !engine_chosen) && !dump_ast && !optimize_ir);
     }
 }
\ No newline at end of file
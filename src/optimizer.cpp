@@ -0,0 +1,293 @@
+#include <optional>
+#include <string>
+#include <vector>
+#include <span>
+#include <any>
+#include <map>
+
+#include "interpreter.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "optimizer.hpp"
+#include "value.hpp"
+#include "tilda.hpp"
+#include "token.hpp"
+
+/* Nodes are only ever visited through const refs, but
+none of them is actually const, so editing them is fine */
+template<typename T>
+static T& edit(const T& node) {
+    return const_cast<T&>(node);
+}
+
+std::vector<StmtPtr> Optimizer::optimize(std::span<const StmtPtr> statements) {
+    // Drop any scopes left open by a previous optimize() that threw
+    scopes.resize(1);
+    is_conditional = false;
+    return optimize_all(statements);
+}
+
+/* A body only sees its own scope, not the global consts: the
+function can be called before the declaration of one has run */
+void Optimizer::optimize_body(const FunctionStatement& function) {
+    std::vector<std::map<std::string, std::optional<Value>, std::less<>>> enclosing = std::move(scopes);
+    bool enclosing_conditional = is_conditional;
+    scopes = {{}, {}};
+    is_conditional = false;
+    for (const Parameter& parameter : function.parameters)
+        scopes.back().insert({std::string(parameter.identifier.lexeme), std::nullopt});
+    function.body = optimize_all(function.body);
+    scopes = std::move(enclosing);
+    is_conditional = enclosing_conditional;
+}
+
+ExprPtr Optimizer::optimize(ExprPtr expression) {
+    return std::any_cast<ExprPtr>(expression->accept(*this));
+}
+
+StmtPtr Optimizer::optimize(StmtPtr statement) {
+    StmtPtr enclosing = replacement;
+    replacement = statement;
+    statement->accept(*this);
+    StmtPtr result = replacement;
+    replacement = enclosing;
+    return result;
+}
+
+std::vector<StmtPtr> Optimizer::optimize_all(std::span<const StmtPtr> statements) {
+    std::vector<StmtPtr> optimized;
+    for (StmtPtr statement : statements)
+        if (StmtPtr result = optimize(statement))
+            optimized.push_back(result);
+    return optimized;
+}
+
+/* The body of an if or a while. One that isn't a block declares its variables
+in the enclosing scope, but only when it runs, so they aren't propagated */
+StmtPtr Optimizer::optimize_branch(StmtPtr statement) {
+    bool enclosing = is_conditional;
+    is_conditional = true;
+    StmtPtr result = optimize(statement);
+    is_conditional = enclosing;
+    return result;
+}
+
+// Folded literals come after the Typechecker, so they're given their type here
+ExprPtr Optimizer::make_literal(const Value& value) {
+    LiteralExpression* literal;
+    switch (value.type) {
+        case LiteralType::BOOL: literal = arena.make<LiteralExpression>(value.boolean ? TRUE : FALSE, value); break;
+        case LiteralType::STR: literal = arena.make<LiteralExpression>(STR, value); break;
+        default: literal = arena.make<LiteralExpression>(NUM, value); break;
+    }
+    literal->static_type = value.type;
+    return literal;
+}
+
+std::optional<Value> Optimizer::constant(ExprPtr expression) {
+    if (const LiteralExpression* literal = dynamic_cast<const LiteralExpression*>(expression))
+        return literal->value;
+    return std::nullopt;
+}
+
+// Replaces expression with the result of apply, unless that raises an error
+template<typename F>
+ExprPtr Optimizer::fold(ExprPtr expression, F apply) {
+    // The error is the runtime's to raise, if the expression ever runs
+    bool had_runtime_error = Tilda::had_runtime_error;
+    try {
+        Value value = apply();
+        if (!value.is_void())
+            expression = make_literal(value);
+    }
+    catch (std::string message) {
+        Tilda::had_runtime_error = had_runtime_error;
+    }
+    return expression;
+}
+
+std::any Optimizer::visit_unary_expression(const UnaryExpression& expression) {
+    edit(expression).operand = optimize(expression.operand);
+    // ++ and -- are left alone, since they're meant to store
+    if (expression.type != NEG && expression.type != L_NOT && expression.type != B_NOT)
+        return ExprPtr(&edit(expression));
+    std::optional<Value> operand = constant(expression.operand);
+    if (!operand)
+        return ExprPtr(&edit(expression));
+    return fold(&edit(expression), [&] { return Interpreter::apply_unary(expression.type, *operand); });
+}
+
+std::any Optimizer::visit_binary_expression(const BinaryExpression& expression) {
+    edit(expression).l_operand = optimize(expression.l_operand);
+    edit(expression).r_operand = optimize(expression.r_operand);
+    std::optional<Value> l_operand = constant(expression.l_operand), r_operand = constant(expression.r_operand);
+    if (!l_operand || !r_operand)
+        return ExprPtr(&edit(expression));
+    return fold(&edit(expression), [&] { return Interpreter::apply_binary(expression.type, *l_operand, *r_operand); });
+}
+
+// Only the branch the condition picks would ever be evaluated
+std::any Optimizer::visit_ternary_expression(const TernaryExpression& expression) {
+    edit(expression).condition = optimize(expression.condition);
+    if (std::optional<Value> condition = constant(expression.condition))
+        return optimize(Interpreter::get_truthiness(*condition) ? expression.l_operand : expression.r_operand);
+    edit(expression).l_operand = optimize(expression.l_operand);
+    edit(expression).r_operand = optimize(expression.r_operand);
+    return ExprPtr(&edit(expression));
+}
+
+std::any Optimizer::visit_literal_expression(const LiteralExpression& expression) {
+    return ExprPtr(&edit(expression));
+}
+
+std::any Optimizer::visit_group_expression(const GroupExpression& expression) {
+    edit(expression).expression = optimize(expression.expression);
+    if (constant(expression.expression))
+        return expression.expression;
+    return ExprPtr(&edit(expression));
+}
+
+std::any Optimizer::visit_variable_expression(const VariableExpression& expression) {
+    for (int i = scopes.size() - 1; i >= 0; i--) {
+        auto found = scopes[i].find(expression.identifier.lexeme);
+        if (found == scopes[i].end())
+            continue;
+        if (found->second)
+            return make_literal(*found->second);
+        break;
+    }
+    return ExprPtr(&edit(expression));
+}
+
+std::any Optimizer::visit_assign_expression(const AssignExpression& expression) {
+    edit(expression).expression = optimize(expression.expression);
+    return ExprPtr(&edit(expression));
+}
+
+std::any Optimizer::visit_range_expression(const RangeExpression& expression) {
+    edit(expression).l_operand = optimize(expression.l_operand);
+    edit(expression).r_operand = optimize(expression.r_operand);
+    return ExprPtr(&edit(expression));
+}
+
+std::any Optimizer::visit_access_expression(const AccessExpression& expression) {
+    edit(expression).l_operand = optimize(expression.l_operand);
+    return ExprPtr(&edit(expression));
+}
+
+std::any Optimizer::visit_call_expression(const CallExpression& expression) {
+    for (ExprPtr& argument : edit(expression).arguments)
+        argument = optimize(argument);
+    return ExprPtr(&edit(expression));
+}
+
+std::any Optimizer::visit_logical_expression(const LogicalExpression& expression) {
+    edit(expression).l_operand = optimize(expression.l_operand);
+    if (expression.r_operand)
+        edit(expression).r_operand = optimize(expression.r_operand);
+    std::optional<Value> l_operand = constant(expression.l_operand), r_operand;
+    if (expression.r_operand)
+        r_operand = constant(expression.r_operand);
+    if (!l_operand || !r_operand)
+        return ExprPtr(&edit(expression));
+    return fold(&edit(expression), [&] { return Interpreter::apply_logical(expression.type, *l_operand, *r_operand); });
+}
+
+std::any Optimizer::visit_bitwise_expression(const BitwiseExpression& expression) {
+    edit(expression).l_operand = optimize(expression.l_operand);
+    if (expression.r_operand)
+        edit(expression).r_operand = optimize(expression.r_operand);
+    std::optional<Value> l_operand = constant(expression.l_operand), r_operand;
+    if (expression.r_operand)
+        r_operand = constant(expression.r_operand);
+    if (!l_operand || !r_operand)
+        return ExprPtr(&edit(expression));
+    return fold(&edit(expression), [&] { return Interpreter::apply_bitwise(expression.type, *l_operand, *r_operand); });
+}
+
+void Optimizer::visit_expression_statement(const ExpressionStatement& statement) {
+    edit(statement).expression = optimize(statement.expression);
+}
+
+void Optimizer::visit_print_statement(const PrintStatement& statement) {
+    edit(statement).expression = optimize(statement.expression);
+}
+
+void Optimizer::visit_type_statement(const TypeStatement& statement) {
+    edit(statement).expression = optimize(statement.expression);
+}
+
+void Optimizer::visit_block_statement(const BlockStatement& statement) {
+    bool enclosing = is_conditional;
+    is_conditional = false;
+    scopes.push_back({});
+    edit(statement).statements = optimize_all(statement.statements);
+    scopes.pop_back();
+    is_conditional = enclosing;
+}
+
+void Optimizer::visit_declare_statement(const DeclareStatement& statement) {
+    // The initializer can still see a shadowed variable of the same name
+    if (statement.expression)
+        edit(statement).expression = optimize(statement.expression);
+
+    // A redeclaration in the same scope keeps the original value
+    if (scopes.back().contains(statement.identifier.lexeme))
+        return;
+    std::optional<Value> value;
+    if (statement.is_const && statement.expression && !is_conditional)
+        value = constant(statement.expression);
+    scopes.back().insert({std::string(statement.identifier.lexeme), value});
+}
+
+void Optimizer::visit_if_statement(const IfStatement& statement) {
+    edit(statement).expression = optimize(statement.expression);
+    if (std::optional<Value> condition = constant(statement.expression)) {
+        StmtPtr branch = Interpreter::get_truthiness(*condition) ? statement.then_branch : statement.else_branch;
+        replacement = branch ? optimize_branch(branch) : nullptr;
+        return;
+    }
+
+    // The then branch can't be removed, but it can be emptied
+    StmtPtr then_branch = optimize_branch(statement.then_branch);
+    edit(statement).then_branch = then_branch ? then_branch : arena.make<BlockStatement>(std::vector<StmtPtr>());
+    if (statement.else_branch)
+        edit(statement).else_branch = optimize_branch(statement.else_branch);
+}
+
+void Optimizer::visit_while_statement(const WhileStatement& statement) {
+    edit(statement).expression = optimize(statement.expression);
+    std::optional<Value> condition = constant(statement.expression);
+    if (condition && !Interpreter::get_truthiness(*condition)) {
+        replacement = nullptr;
+        return;
+    }
+    StmtPtr body = optimize_branch(statement.statements);
+    edit(statement).statements = body ? body : arena.make<BlockStatement>(std::vector<StmtPtr>());
+}
+
+void Optimizer::visit_for_statement(const ForStatement& statement) {
+    ;
+}
+
+void Optimizer::visit_forin_statement(const ForInStatement& statement) {
+    ;
+}
+
+void Optimizer::visit_switch_statement(const SwitchStatement& statement) {
+    ;
+}
+
+void Optimizer::visit_return_statement(const ReturnStatement& statement) {
+    if (statement.expression)
+        edit(statement).expression = optimize(statement.expression);
+}
+
+void Optimizer::visit_struct_statement(const StructStatement& statement) {
+    ;
+}
+
+// Bodies are optimized on the function's first call, see optimize_body
+void Optimizer::visit_function_statement(const FunctionStatement& statement) {
+    ;
+}
\ No newline at end of file
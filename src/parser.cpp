@@ -1,13 +1,13 @@
 #include <iostream>
 #include <cstdlib>
 #include <format>
-#include <memory>
 #include <vector>
 
 #include "expression.hpp"
 #include "statement.hpp"
 #include "common.hpp"
 #include "parser.hpp"
+#include "arena.hpp"
 #include "types.hpp"
 #include "tilda.hpp"
 #include "token.hpp"
@@ -15,92 +15,103 @@
 
 // TODO: where does type assignment to identifiers happen?
 
-Parser::Parser(std::vector<Token> tokens) :
-    tokens(tokens) {}
+Parser::Parser(TokenBuffer& tokens, Arena& arena, bool is_lazy, std::ostream& out) :
+    tokens(tokens), arena(arena), is_lazy(is_lazy), out(out) {}
 
-std::vector<ShrStmtPtr> Parser::parse() {
-    std::vector<ShrStmtPtr> statements;
-    while (!is_at_end())
+Parser::Parser(Scanner& scanner, Arena& arena) :
+    tokens(scanner.tokens), scanner(&scanner), arena(arena), out(std::cout) {}
+
+std::vector<StmtPtr> Parser::parse() {
+    std::vector<StmtPtr> statements;
+    while (!is_at_end()) {
+        // Skip blank lines between statements
+        if (match(NEWLINE))
+            continue;
         statements.push_back(handle_declaration());
+    }
     return statements;
 }
 
+/* Parses a single top-level statement, or returns nullptr at the end
+of the file. The tokens before it are dropped, so in streaming mode the
+buffer only ever holds about one statement's worth of tokens */
+StmtPtr Parser::parse_next() {
+    tokens.discard_before(current);
+    current = 0;
+    while (match(NEWLINE));
+    if (is_at_end())
+        return nullptr;
+    return handle_declaration();
+}
+
+void Parser::fill(size_t index) {
+    while (index >= tokens.size() && scanner && scanner->scan_next());
+}
+
+/* Tokens are only materialized into a Token for nodes that
+keep one and for errors. Everything else just looks at types */
 Token Parser::previous() {
-    return current > 0 ? tokens[current - 1] : tokens[0];
+    return tokens.get(current > 0 ? current - 1 : 0);
+}
+
+std::string_view Parser::previous_lexeme() {
+    return tokens.lexeme(current > 0 ? current - 1 : 0);
+}
+
+TokenType Parser::previous_type() {
+    return tokens.type(current > 0 ? current - 1 : 0);
 }
 
-Token Parser::next() {
+void Parser::advance() {
     if (!is_at_end())
         current++;
-    return previous();
 }
 
 Token Parser::peek() {
-    return tokens[current];
+    fill(current);
+    return tokens.get(current);
 }
 
-Token Parser::peek_next() {
-    if (!is_at_end())
-        return tokens[current + 1];
-    return tokens[tokens.size() - 1];
+TokenType Parser::peek_type(size_t distance) {
+    fill(current + distance);
+    // Looking past the end just sees more of it
+    if (current + distance >= tokens.size())
+        return END_TOKEN;
+    return tokens.type(current + distance);
 }
 
 bool Parser::check(TokenType type) {
     if (is_at_end()) return false;
-    return peek().type == type;
+    return peek_type() == type;
 }
 
 bool Parser::is_at_end() {
-    return tokens[current].type == END_TOKEN;
+    fill(current);
+    return tokens.type(current) == END_TOKEN;
 }
 
-// TODO: make this function not disgusting
+// Compiles down to a chain of comparisons against a single load of the token's type
 template<std::same_as<TokenType>... T>
 bool Parser::match(T... types) {
-    bool is_match = false;
-    std::vector<TokenType> types_to_match;
-    (types_to_match.emplace_back(types), ...);
-
-    for (TokenType type : types_to_match) {
-        if (peek().type == type) {
-            is_match = true;
-            break;
-        }
+    TokenType type = peek_type();
+    if (((type == types) || ...)) {
+        advance();
+        return true;
     }
-    if (is_match && !is_at_end())
-        next();
-
-    return is_match;
+    return false;
 }
 
-template<std::same_as<TokenType>... T>
-bool Parser::match_next(T... types) {
-    bool is_match = false;
-    std::vector<TokenType> types_to_match;
-    (types_to_match.emplace_back(types), ...);
-
-    for (TokenType type : types_to_match) {
-        if (peek_next().type == type) {
-            is_match = true;
-            break;
-        }
-    }
-    if (is_match && !is_at_end())
-        next();
-
-    return is_match;
+// Returns the index of the consumed token, for tokens.get() when a node needs it
+size_t Parser::consume(TokenType type, const char* message) {
+    if (peek_type() != type)
+        throw_error(peek(), message);
+    advance();
+    return current - 1;
 }
 
-Token Parser::consume(TokenType type, std::string message) {
-    if (peek().type == type)
-        return next();
-    throw_error(peek(), message);
-    return Token(); // NULL Token
-}
-
-void Parser::throw_error(Token token, std::string message) {
-    Tilda::had_error = true;
-    throw std::format("[line {}] Error {}: {}", token.line, (token.type == END_TOKEN ? "at end" : "at \"" + token.lexeme + "\""), message);
+void Parser::throw_error(Token token, std::string_view message) {
+    had_error = true;
+    throw std::format("[line {}] Error {}: {}", token.line, (token.type == END_TOKEN ? "at end" : std::format("at \"{}\"", token.lexeme)), message);
     // if (token.type == END_TOKEN)
     //     Error::report(token.line, "at end", message);
     // else
@@ -108,13 +119,13 @@ void Parser::throw_error(Token token, std::string message) {
 }
 
 void Parser::synchronize() {
-    next();
+    advance();
     while (!is_at_end()) {
         /* Because this synchronizes between statements,
         it needs to find the next statement after the one
         that threw the error. So it switches on possible
         tokens that would start a new statement */
-        switch(peek().type) {
+        switch(peek_type()) {
             case STRUCT:
             case TYPE:
             case FOR:
@@ -125,31 +136,39 @@ void Parser::synchronize() {
                 return;
         }
     }
-    next();
+    advance();
 }
 
-ShrStmtPtr Parser::handle_declaration() {
+StmtPtr Parser::handle_declaration() {
+    if (match(FN))
+        return handle_function(LiteralType::VOID);
+    // A typed function, i.e. "str name(...)"
+    if (check(TYPE) && peek_type(1) == IDENTIFIER && peek_type(2) == L_PAREN) {
+        advance();
+        return handle_function(StringToLiteralType::map.find(previous_lexeme(), LiteralType::VOID));
+    }
     if (match(CONST, LET, TYPE))
         return handle_variable();
-    else if (Tilda::had_error) {
+    else if (had_error) {
         synchronize();
         return nullptr;
     }
     return handle_statement();
 }
 
-ShrStmtPtr Parser::handle_variable() {
-    ShrExprPtr expression;
-    bool is_const = previous().type == CONST ? true : false;
-    LiteralType literal_type;
+StmtPtr Parser::handle_variable() {
+    ExprPtr expression = nullptr;
+    bool is_const = previous_type() == CONST ? true : false;
+    // A "let" binding's type is inferred by the Typechecker
+    LiteralType literal_type = LiteralType::VOID;
 
-    // TODO: type inference
-    if (previous().type == TYPE || match(TYPE))
-        literal_type = StringToLiteralType::map[previous().lexeme];
-    else if (previous().type == LET || match(LET))
-        ;
-    
-    Token identifier = consume(IDENTIFIER, "Expected identifier.");
+    if (previous_type() == TYPE || match(TYPE))
+        literal_type = StringToLiteralType::map.find(previous_lexeme(), LiteralType::VOID);
+    // "let" carries no type, so it only has to be consumed if the caller hasn't already
+    else if (previous_type() != LET)
+        match(LET);
+
+    Token identifier = tokens.get(consume(IDENTIFIER, "Expected identifier."));
 
     if (match(ASSIGN))
         expression = handle_expression();
@@ -162,23 +181,77 @@ ShrStmtPtr Parser::handle_variable() {
     else if (check(COMMA))
         consume(COMMA, "Expected comma after \"for\" loop variable declaration.");
     
-    return std::make_shared<DeclareStatement>(identifier, literal_type, expression);
+    return arena.make<DeclareStatement>(identifier, literal_type, expression, is_const);
+}
+
+StmtPtr Parser::handle_function(LiteralType return_type) {
+    Token identifier = tokens.get(consume(IDENTIFIER, "Expected function name."));
+    consume(L_PAREN, "Expected \"(\" after function name.");
+
+    std::vector<Parameter> parameters;
+    if (!check(R_PAREN)) {
+        do {
+            LiteralType type = LiteralType::VOID;
+            if (match(TYPE))
+                type = StringToLiteralType::map.find(previous_lexeme(), LiteralType::VOID);
+            else
+                match(LET);
+            parameters.push_back({tokens.get(consume(IDENTIFIER, "Expected parameter name.")), type});
+        } while (match(COMMA));
+    }
+    consume(R_PAREN, "Expected \")\" after parameters.");
+    consume(L_BRACE, "Expected \"{\" before function body.");
+
+    FunctionStatement* function = arena.make<FunctionStatement>(identifier, parameters, return_type, current);
+    if (is_lazy) {
+        function->parser = this;
+        skip_function_body();
+    }
+    else {
+        function->body = handle_block();
+        function->is_parsed = true;
+    }
+    return function;
+}
+
+// Only matches braces, up to and including the one that closes the body
+void Parser::skip_function_body() {
+    int depth = 1;
+    while (depth > 0) {
+        switch (peek_type()) {
+            case L_BRACE: depth++; break;
+            case R_BRACE: depth--; break;
+            case END_TOKEN: throw_error(peek(), "Expected \"}\" after function body.");
+            default: break;
+        }
+        advance();
+    }
+}
+
+// Called the first time a lazily parsed function is called
+void Parser::parse_body(const FunctionStatement& function) {
+    size_t resume = current;
+    current = function.body_start;
+    function.body = handle_block();
+    function.is_parsed = true;
+    current = resume;
 }
 
-ShrStmtPtr Parser::handle_statement() {
+StmtPtr Parser::handle_statement() {
     if (match(FOR)) return handle_for();
     if (match(IF)) return handle_if();
     if (match(PRINT)) return handle_print();
     if (match(WHILE)) return handle_while();
     if (match(TYPEOF)) return handle_type();
-    if (match(L_BRACE)) return std::make_shared<BlockStatement>(handle_block());
+    if (match(RETURN)) return handle_return();
+    if (match(L_BRACE)) return arena.make<BlockStatement>(handle_block());
     return handle_expression_statement();
 }
 
-ShrStmtPtr Parser::handle_for() {
+StmtPtr Parser::handle_for() {
     consume(L_PAREN, "Expected \"(\" after \"for\".");
 
-    ShrStmtPtr initializer;
+    StmtPtr initializer = nullptr;
     if (match(COMMA))
         initializer = nullptr;
     else if (check(TYPE) || check(LET))
@@ -188,17 +261,17 @@ ShrStmtPtr Parser::handle_for() {
     else
         initializer = handle_expression_statement();
 
-    ShrExprPtr condition = nullptr;
+    ExprPtr condition = nullptr;
     if (!check(COMMA))
         condition = handle_expression();
     consume(COMMA, "Expected \",\" after loop condition.");
 
-    ShrExprPtr increment = nullptr;
+    ExprPtr increment = nullptr;
     if (!check(R_PAREN))
         increment = handle_expression();
     consume(R_PAREN, "Expected \")\" after \"for\" clauses.");
     
-    ShrStmtPtr body = handle_statement();
+    StmtPtr body = handle_statement();
 
     /*
     body:
@@ -208,8 +281,8 @@ ShrStmtPtr Parser::handle_for() {
     */
 
     if (increment != nullptr) {
-        std::vector<ShrStmtPtr> body_statements = {body, std::make_shared<ExpressionStatement>(increment)};
-        body = std::make_shared<BlockStatement>(body_statements);
+        std::vector<StmtPtr> body_statements = {body, arena.make<ExpressionStatement>(increment)};
+        body = arena.make<BlockStatement>(body_statements);
     }
 
     /*
@@ -221,8 +294,8 @@ ShrStmtPtr Parser::handle_for() {
     */
 
     if (condition == nullptr)
-        condition = std::make_shared<LiteralExpression>(TRUE, true);
-    body = std::make_shared<WhileStatement>(condition, body);
+        condition = arena.make<LiteralExpression>(TRUE, true);
+    body = arena.make<WhileStatement>(condition, body);
 
     /*
     body:
@@ -234,8 +307,8 @@ ShrStmtPtr Parser::handle_for() {
     */
 
     if (initializer != nullptr) {
-        std::vector<ShrStmtPtr> body_statements = {initializer, body};
-        body = std::make_shared<BlockStatement>(body_statements);
+        std::vector<StmtPtr> body_statements = {initializer, body};
+        body = arena.make<BlockStatement>(body_statements);
     }
 
     /*
@@ -254,54 +327,66 @@ ShrStmtPtr Parser::handle_for() {
     return body;
 }
 
-ShrStmtPtr Parser::handle_if() {
-    consume(L_PAREN, "Expected \"(\" after \"if\".");
-    ShrExprPtr expression = handle_expression();
+// Also parses an elif, as an if statement in the else branch of the one before it
+StmtPtr Parser::handle_if() {
+    consume(L_PAREN, previous_type() == ELIF ? "Expected \"(\" after \"elif\"." : "Expected \"(\" after \"if\".");
+    ExprPtr expression = handle_expression();
     consume(R_PAREN, "Expected \")\" after expresion.");
 
-    ShrStmtPtr then_branch = handle_statement();
+    StmtPtr then_branch = handle_statement();
 
-    // TODO: elif statements
-
-    ShrStmtPtr else_branch = nullptr;
-    if (match(ELSE))
+    StmtPtr else_branch = nullptr;
+    if (match(ELIF))
+        else_branch = handle_if();
+    else if (match(ELSE))
         else_branch = handle_statement();
 
-    return std::make_shared<IfStatement>(expression, then_branch, else_branch);
+    return arena.make<IfStatement>(expression, then_branch, else_branch);
 }
 
-ShrStmtPtr Parser::handle_while() {
+StmtPtr Parser::handle_while() {
     consume(L_PAREN, "Expected \"(\" after \"while\".");
-    ShrExprPtr expression = handle_expression();
+    ExprPtr expression = handle_expression();
     consume(R_PAREN, "Expected \")\" after expresion.");
 
-    ShrStmtPtr statements = handle_statement();
+    StmtPtr statements = handle_statement();
 
-    return std::make_shared<WhileStatement>(expression, statements);
+    return arena.make<WhileStatement>(expression, statements);
 }
 
-ShrStmtPtr Parser::handle_print() {
-    ShrExprPtr expression = handle_expression();
+StmtPtr Parser::handle_print() {
+    ExprPtr expression = handle_expression();
     // TODO: should commas be allowed as statement delimiters?
     consume(NEWLINE, "Expected newline after value.");
-    return std::make_shared<PrintStatement>(expression);
+    return arena.make<PrintStatement>(expression);
+}
+
+StmtPtr Parser::handle_return() {
+    ExprPtr expression = nullptr;
+    if (!check(NEWLINE))
+        expression = handle_expression();
+    consume(NEWLINE, "Expected newline after return value.");
+    return arena.make<ReturnStatement>(expression);
 }
 
-ShrStmtPtr Parser::handle_type() {
-    ShrExprPtr expression = handle_expression();
+StmtPtr Parser::handle_type() {
+    ExprPtr expression = handle_expression();
     // TODO: should commas be allowed as statement delimiters?
     consume(NEWLINE, "Expected newline after value.");
-    return std::make_shared<TypeStatement>(expression);
+    return arena.make<TypeStatement>(expression);
 }
 
-std::vector<ShrStmtPtr> Parser::handle_block() {
-    std::vector<ShrStmtPtr> statements;
+std::vector<StmtPtr> Parser::handle_block() {
+    std::vector<StmtPtr> statements;
 
     if (check(NEWLINE))
         match(NEWLINE);
 
-    while (!check(R_BRACE) && !is_at_end())
+    while (!check(R_BRACE) && !is_at_end()) {
+        if (match(NEWLINE))
+            continue;
         statements.push_back(handle_declaration());
+    }
     consume(R_BRACE, "Expected \"}\" after block.");
 
     if (check(NEWLINE))
@@ -310,192 +395,171 @@ std::vector<ShrStmtPtr> Parser::handle_block() {
     return statements;
 }
 
-ShrStmtPtr Parser::handle_expression_statement() {
-    ShrExprPtr expression = handle_expression();
+StmtPtr Parser::handle_expression_statement() {
+    ExprPtr expression = handle_expression();
     // TODO: should commas be allowed as statement delimiters?
     if (check(NEWLINE))
         consume(NEWLINE, "Expected newline or comma after expression.");
     // else if (check(COMMA))
     //     consume(COMMA, "Expected newline or comma after expression.");
-    return std::make_shared<ExpressionStatement>(expression);
-}
-
-ShrExprPtr Parser::handle_expression() {
-    return handle_assignment();
-}
-
-ShrExprPtr Parser::handle_assignment() {
-    ShrExprPtr expression = handle_logical_or();
-
-    if (match(ASSIGN)) {
-        Token target = previous();
-        ShrExprPtr value = handle_assignment();
-
-        if (VariableExpression* v = dynamic_cast<VariableExpression*>(expression.get())) {
-            Token identifier = v->identifier;
-            return std::make_shared<AssignExpression>(identifier, value);
-        }
-        // Report error
-        std::cout << std::format("Invalid assignment target: \"{}\"", target.lexeme);
+    return arena.make<ExpressionStatement>(expression);
+}
+
+constexpr std::array<Parser::ParseRule, END_TOKEN + 1> Parser::make_rules() {
+    std::array<ParseRule, END_TOKEN + 1> rules{};
+    // Operands
+    rules[L_PAREN] = {&Parser::handle_grouping, &Parser::handle_call, Precedence::CALL};
+    for (TokenType type : {NUM, STR, TRUE, FALSE, TYPE})
+        rules[type] = {&Parser::handle_literal, nullptr, Precedence::NONE};
+    rules[IDENTIFIER] = {&Parser::handle_identifier, nullptr, Precedence::NONE};
+    // Assignment is right-associative, and the compound forms desugar to it
+    for (TokenType type : {ASSIGN, ADD_EQ, SUB_EQ, MUL_EQ, DIV_EQ, POW_EQ, MOD_EQ, B_OR_EQ, B_AND_EQ, B_XOR_EQ})
+        rules[type] = {nullptr, &Parser::handle_assignment, Precedence::ASSIGNMENT};
+    rules[L_OR] = {nullptr, &Parser::handle_logical, Precedence::LOGICAL_OR};
+    rules[L_AND] = {nullptr, &Parser::handle_logical, Precedence::LOGICAL_AND};
+    rules[L_XOR] = {nullptr, &Parser::handle_logical, Precedence::LOGICAL_XOR};
+    rules[T_IF] = {nullptr, &Parser::handle_ternary, Precedence::TERNARY};
+    for (TokenType type : {EQ, NOT_EQ})
+        rules[type] = {nullptr, &Parser::handle_binary, Precedence::EQUALITY};
+    for (TokenType type : {LESS, GREATER, LESS_EQ, GREATER_EQ})
+        rules[type] = {nullptr, &Parser::handle_binary, Precedence::COMPARISON};
+    for (TokenType type : {B_OR, B_AND, B_XOR, CHK, LSHFT, RSHFT})
+        rules[type] = {nullptr, &Parser::handle_bitwise, Precedence::BITWISE};
+    rules[ADD] = {nullptr, &Parser::handle_binary, Precedence::TERM};
+    rules[SUB] = {nullptr, &Parser::handle_binary, Precedence::TERM};
+    for (TokenType type : {MUL, DIV, POW, MOD})
+        rules[type] = {nullptr, &Parser::handle_binary, Precedence::FACTOR};
+    // The Scanner can't tell "a -1" from "-1", so NEG is also a subtraction
+    rules[NEG] = {&Parser::handle_unary, &Parser::handle_binary, Precedence::TERM};
+    for (TokenType type : {L_NOT, B_NOT})
+        rules[type] = {&Parser::handle_unary, nullptr, Precedence::NONE};
+    for (TokenType type : {INC, DEC})
+        rules[type] = {&Parser::handle_unary, &Parser::handle_postfix, Precedence::POSTFIX};
+    return rules;
+}
+
+const std::array<Parser::ParseRule, END_TOKEN + 1> Parser::rules = Parser::make_rules();
+
+// Operators bind their left operand when they're at least as tight as precedence
+static Precedence tighter(Precedence precedence) {
+    return static_cast<Precedence>(static_cast<int>(precedence) + 1);
+}
+
+ExprPtr Parser::handle_expression() {
+    return parse_precedence(Precedence::ASSIGNMENT);
+}
+
+/* Parses an operand, then keeps folding it into the left side of
+every following operator that binds at least as tight as precedence.
+Recursion only happens for operands, not once per precedence level */
+ExprPtr Parser::parse_precedence(Precedence precedence) {
+    PrefixHandler prefix = rules[peek_type()].prefix;
+    if (!prefix) {
+        throw_error(peek(), "Expected expression.");
+        return nullptr;
     }
+    advance();
+    ExprPtr expression = (this->*prefix)();
 
-    return expression;
-}
-
-ShrExprPtr Parser::handle_logical_or() {
-    ShrExprPtr expression = handle_logical_and();
-
-    while (match(L_OR)) {
-        TokenType type = previous().type;
-        ShrExprPtr r_expression = handle_logical_and();
-        expression = std::make_shared<LogicalExpression>(type, expression, r_expression);
+    while (precedence <= rules[peek_type()].precedence) {
+        advance();
+        expression = (this->*rules[previous_type()].infix)(expression);
     }
-
     return expression;
 }
 
-ShrExprPtr Parser::handle_logical_and() {
-    ShrExprPtr expression = handle_logical_xor();
-
-    while (match(L_AND)) {
-        TokenType type = previous().type;
-        ShrExprPtr r_expression = handle_logical_xor();
-        expression = std::make_shared<LogicalExpression>(type, expression, r_expression);
-    }
-
+ExprPtr Parser::handle_grouping() {
+    ExprPtr expression = handle_expression();
+    consume(R_PAREN, "Expected ')' after expression.");
     return expression;
 }
 
-ShrExprPtr Parser::handle_logical_xor() {
-    ShrExprPtr expression = handle_ternary();
-
-    while (match(L_XOR)) {
-        TokenType type = previous().type;
-        ShrExprPtr r_expression = handle_ternary();
-        expression = std::make_shared<LogicalExpression>(type, expression, r_expression);
-    }
-
-    return expression;
+ExprPtr Parser::handle_literal() {
+    // Type names used as values evaluate to their name
+    if (previous_type() == TYPE)
+        return arena.make<LiteralExpression>(TYPE, Value(previous_lexeme()));
+    return arena.make<LiteralExpression>(previous_type(), tokens.literal(current - 1));
 }
 
-ShrExprPtr Parser::handle_ternary() {
-    ShrExprPtr expression = handle_equality();
-
-    if (match(T_IF)) {
-        TokenType type = previous().type == T_IF ? TERN : previous().type; // in case somehow another ternary operator is added to the lang
-        ShrExprPtr l_expression = handle_equality();
-        consume(T_ELSE, "Expected ':' after expression.");
-        ShrExprPtr r_expression = handle_ternary();
-        expression = std::make_shared<TernaryExpression>(type, expression, l_expression, r_expression);
-    }
-    return expression;
+ExprPtr Parser::handle_identifier() {
+    return arena.make<VariableExpression>(previous());
 }
 
-ShrExprPtr Parser::handle_equality() {
-    ShrExprPtr expression = handle_comparison();
-
-    if (match(EQ, NOT_EQ)) {
-        TokenType type = previous().type;
-        ShrExprPtr r_expression = handle_comparison();
-        expression = std::make_shared<BinaryExpression>(type, expression, r_expression);
-    }
-    return expression;
+ExprPtr Parser::handle_unary() {
+    TokenType type = previous_type();
+    ExprPtr operand = parse_precedence(Precedence::UNARY);
+    return arena.make<UnaryExpression>(type, operand, false);
 }
 
-ShrExprPtr Parser::handle_comparison() {
-    ShrExprPtr expression = handle_bitwise();
-
-    if (match(GREATER, GREATER_EQ, LESS, LESS_EQ)) {
-        TokenType type = previous().type;
-        ShrExprPtr r_expression = handle_bitwise();
-        expression = std::make_shared<BinaryExpression>(type, expression, r_expression);
-    }
-    return expression;
+ExprPtr Parser::handle_binary(ExprPtr l_operand) {
+    TokenType type = previous_type() == NEG ? SUB : previous_type();
+    ExprPtr r_operand = parse_precedence(tighter(rules[previous_type()].precedence));
+    return arena.make<BinaryExpression>(type, l_operand, r_operand);
 }
 
-ShrExprPtr Parser::handle_bitwise() {
-    ShrExprPtr expression = handle_term();
+// Bitwise operators are right-associative
+ExprPtr Parser::handle_bitwise(ExprPtr l_operand) {
+    TokenType type = previous_type();
+    ExprPtr r_operand = parse_precedence(Precedence::BITWISE);
+    return arena.make<BitwiseExpression>(type, l_operand, r_operand);
+}
 
-    if (match(TokenType::B_OR, B_AND, B_XOR, CHK, LSHFT, RSHFT)) {
-        TokenType type = previous().type;
-        ShrExprPtr r_expression = handle_bitwise();
-        expression = std::make_shared<BitwiseExpression>(type, expression, r_expression);
-    }
-    return expression;
+ExprPtr Parser::handle_logical(ExprPtr l_operand) {
+    TokenType type = previous_type();
+    ExprPtr r_operand = parse_precedence(tighter(rules[type].precedence));
+    return arena.make<LogicalExpression>(type, l_operand, r_operand);
 }
 
-ShrExprPtr Parser::handle_term() {
-    ShrExprPtr expression = handle_factor();
+ExprPtr Parser::handle_ternary(ExprPtr condition) {
+    ExprPtr l_operand = parse_precedence(Precedence::EQUALITY);
+    consume(T_ELSE, "Expected ':' after expression.");
+    ExprPtr r_operand = parse_precedence(Precedence::TERNARY);
+    return arena.make<TernaryExpression>(TERN, condition, l_operand, r_operand);
+}
 
-    if (match(SUB, ADD)) {
-        TokenType type = previous().type;
-        ShrExprPtr r_expression = handle_factor();
-        expression = std::make_shared<BinaryExpression>(type, expression, r_expression);
-    }
-    return expression;
+ExprPtr Parser::handle_postfix(ExprPtr operand) {
+    return arena.make<UnaryExpression>(previous_type(), operand, true);
 }
 
-ShrExprPtr Parser::handle_factor() {
-    ShrExprPtr expression = handle_unary();
+ExprPtr Parser::handle_call(ExprPtr callee) {
+    // Functions aren't values, so only a name can be called
+    VariableExpression* variable = dynamic_cast<VariableExpression*>(callee);
+    if (!variable)
+        throw_error(previous(), "Only functions can be called.");
 
-    if (match(DIV, MUL, POW, MOD)) {
-        TokenType type = previous().type;
-        ShrExprPtr r_expression = handle_unary();
-        expression = std::make_shared<BinaryExpression>(type, expression, r_expression);
+    std::vector<ExprPtr> arguments;
+    if (!check(R_PAREN)) {
+        do {
+            arguments.push_back(handle_expression());
+        } while (match(COMMA));
     }
-    return expression;
+    consume(R_PAREN, "Expected \")\" after arguments.");
+    return arena.make<CallExpression>(variable->identifier, arguments);
 }
 
-ShrExprPtr Parser::handle_unary() {
-    /* Try to handle a unary expression.
-    If it doesn't find one, then handle
-    the expression of next highest precedence
-    (primary expression) */
-    if (match(L_NOT, B_NOT, NEG, INC, DEC)) {
-        TokenType type = previous().type;
-        ShrExprPtr expression = handle_unary();
-        return std::make_shared<UnaryExpression>(type, expression, false);
-    }
-    // Don't allow chaining INC and DEC operators
-    if (match(INC, DEC)) {
-        TokenType type = previous().type;
-        ShrExprPtr expression = handle_primary();
-        return std::make_shared<UnaryExpression>(type, expression, false);
-    }
-    return handle_unary_postfix();
-}
+ExprPtr Parser::handle_assignment(ExprPtr target) {
+    TokenType type = previous_type();
+    size_t assign = current - 1;
+    ExprPtr value = parse_precedence(Precedence::ASSIGNMENT);
 
-// idea to handle postfix operators like this stolen from https://github.com/svtm/jlox/
-ShrExprPtr Parser::handle_unary_postfix() {
-    if (match_next(INC, DEC)) {
-        TokenType type = peek().type;
-        current--;
-        ShrExprPtr expression = handle_primary();
-        next();
-        return std::make_shared<UnaryExpression>(type, expression, true);
-    }
-    return handle_primary();
-}
-
-ShrExprPtr Parser::handle_primary() {
-    ShrExprPtr expression;
-    if (match(TYPE, NUM, STR, TRUE, FALSE, L_PAREN/*, NIL*/)) {
-        TokenType type = previous().type;
-        // Handle grouped expression
-        if (type == L_PAREN) {
-            ShrExprPtr grouped_expression = handle_expression();
-            consume(R_PAREN, "Expected ')' after expression.");
-            expression = grouped_expression;
-        }
-        else {
-            expression = std::make_shared<LiteralExpression>(type, previous().literal);
-        }
+    VariableExpression* variable = dynamic_cast<VariableExpression*>(target);
+    if (!variable) {
+        // Report error
+        out << std::format("Invalid assignment target: \"{}\"", tokens.lexeme(assign));
+        return target;
     }
-    else if (match(IDENTIFIER))
-        return std::make_shared<VariableExpression>(previous());
-    else {
-        throw_error(peek(), "Expected expression.");
-        return nullptr;
+    // "a += b" is parsed as "a = a + b"
+    switch (type) {
+        case ADD_EQ: value = arena.make<BinaryExpression>(ADD, target, value); break;
+        case SUB_EQ: value = arena.make<BinaryExpression>(SUB, target, value); break;
+        case MUL_EQ: value = arena.make<BinaryExpression>(MUL, target, value); break;
+        case DIV_EQ: value = arena.make<BinaryExpression>(DIV, target, value); break;
+        case POW_EQ: value = arena.make<BinaryExpression>(POW, target, value); break;
+        case MOD_EQ: value = arena.make<BinaryExpression>(MOD, target, value); break;
+        case B_OR_EQ: value = arena.make<BitwiseExpression>(B_OR, target, value); break;
+        case B_AND_EQ: value = arena.make<BitwiseExpression>(B_AND, target, value); break;
+        case B_XOR_EQ: value = arena.make<BitwiseExpression>(B_XOR, target, value); break;
+        default: break;
     }
-    return expression;
+    return arena.make<AssignExpression>(variable->identifier, value);
 }
\ No newline at end of file
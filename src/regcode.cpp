@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <format>
+#include <string>
+#include <vector>
+#include <cctype>
+
+#include "regcode.hpp"
+#include "interpreter.hpp"
+#include "value.hpp"
+
+#define REG_NAME(op) #op,
+static const char* reg_op_names[] = {
+    REG_OPCODES(REG_NAME)
+};
+#undef REG_NAME
+
+uint32_t RegFunction::add_constant(const Value& value) {
+    auto [found, inserted] = constant_indices.insert({value.key(), constants.size()});
+    if (inserted)
+        constants.push_back(value);
+    return found->second;
+}
+
+// One instruction per line, i.e. "   3  add_int      r2, r0, 1"
+std::string RegFunction::disassemble(const std::vector<std::string>& global_names, const std::vector<std::string>& function_names) const {
+    auto operand = [&](uint16_t operand) {
+        if (!is_constant(operand))
+            return std::format("r{}", operand);
+        const Value& constant = constants[operand & ~constant_bit];
+        if (constant.type == LiteralType::STR)
+            return std::format("\"{}\"", constant.as_str());
+        return Interpreter::to_string(constant);
+    };
+    auto global = [&](uint16_t slot) {
+        return slot < global_names.size() ? global_names[slot] : std::format("g{}", slot);
+    };
+
+    std::string text = std::format("{} ({} registers):\n", statement ? std::format("fn {}", statement->identifier.lexeme) : "<script>", register_count);
+    for (size_t i = 0; i < code.size(); i++) {
+        const RegInstruction& instruction = code[i];
+        std::string name = reg_op_names[instruction.op] + 4;
+        for (char& c : name)
+            c = std::tolower(c);
+
+        std::string operands;
+        switch (instruction.op) {
+            case REG_MOVE:
+            case REG_NEG: case REG_INC: case REG_DEC: case REG_L_NOT: case REG_B_NOT:
+                operands = std::format("r{}, {}", instruction.a, operand(instruction.b));
+                break;
+            case REG_VOID:
+                operands = std::format("r{}", instruction.a);
+                break;
+            case REG_DECLARE_GLOBAL:
+                operands = global(instruction.a);
+                break;
+            case REG_GET_GLOBAL:
+                operands = std::format("r{}, {}", instruction.a, global(instruction.b));
+                break;
+            case REG_SET_GLOBAL:
+                operands = std::format("{}, {}", global(instruction.a), operand(instruction.b));
+                if (static_cast<LiteralType>(instruction.c) != LiteralType::VOID)
+                    operands += std::format(", {}", literal_type_names[instruction.c]);
+                break;
+            case REG_DEFINE_GLOBAL:
+                operands = std::format("{}, {}", global(instruction.a), operand(instruction.b));
+                break;
+            case REG_CHECK_TYPE:
+                operands = std::format("{}, {}", operand(instruction.a), literal_type_names[instruction.b]);
+                break;
+            case REG_ADD_INT_IMM:
+                operands = std::format("r{}, {}, {}", instruction.a, operand(instruction.b), static_cast<int16_t>(instruction.c));
+                break;
+            case REG_JUMP_UNLESS_LESS_INT: case REG_JUMP_UNLESS_GREATER_INT:
+            case REG_JUMP_UNLESS_LESS_EQ_INT: case REG_JUMP_UNLESS_GREATER_EQ_INT:
+            case REG_JUMP_UNLESS_NOT_EQ_INT: case REG_JUMP_UNLESS_EQ_INT:
+                operands = std::format("{}, {} -> {}", operand(instruction.b), operand(instruction.c), instruction.a);
+                break;
+            case REG_JUMP:
+                operands = std::format("-> {}", instruction.a);
+                break;
+            case REG_JUMP_UNLESS:
+                operands = std::format("{} -> {}", operand(instruction.b), instruction.a);
+                break;
+            case REG_CALL:
+                operands = std::format("r{}, {}(r{}..)", instruction.a, function_names[instruction.b], instruction.c);
+                break;
+            case REG_RETURN:
+            case REG_PRINT:
+            case REG_TYPEOF:
+                operands = operand(instruction.a);
+                break;
+            case REG_RETURN_VOID:
+            case REG_HALT:
+                break;
+            default:
+                operands = std::format("r{}, {}, {}", instruction.a, operand(instruction.b), operand(instruction.c));
+                break;
+        }
+        if (operands.empty())
+            text += std::format("  {:>4}  {}\n", i, name);
+        else
+            text += std::format("  {:>4}  {:<28} {}\n", i, name, operands);
+    }
+    return text;
+}
\ No newline at end of file
@@ -0,0 +1,549 @@
+#include <iostream>
+#include <stdint.h>
+#include <algorithm>
+#include <format>
+#include <string>
+#include <vector>
+#include <any>
+
+#include "regcompiler.hpp"
+#include "regcode.hpp"
+#include "resolver.hpp"
+#include "typechecker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "tilda.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+RegFunction RegCompiler::compile(std::span<const StmtPtr> statements) {
+    RegFunction script;
+    function = &script;
+    scopes.clear();
+    next_register = 0;
+    target = -1;
+
+    for (StmtPtr statement : statements)
+        compile(statement);
+    emit(REG_HALT);
+    script.is_compiled = true;
+    function = nullptr;
+
+    if (is_disassembling)
+        std::cout << script.disassemble(global_names, function_names);
+    return script;
+}
+
+/* Runs the same passes as Interpreter::prepare_body, then compiles the
+body into a frame whose first registers are the parameters */
+RegFunction& RegCompiler::get_function(uint16_t index) {
+    RegFunction& body = *functions[index];
+    if (body.is_compiled)
+        return body;
+
+    const FunctionStatement& statement = *body.statement;
+    if (!statement.is_resolved) {
+        if (!statement.is_parsed)
+            statement.parser->parse_body(statement);
+        resolver->resolve_body(statement);
+        if (typechecker)
+            typechecker->check_body(statement);
+        if (optimizer)
+            optimizer->optimize_body(statement);
+    }
+
+    // Called while the VM runs, possibly from the middle of compiling a REPL line's callers
+    RegFunction* enclosing_function = function;
+    std::vector<Scope> enclosing_scopes = std::move(scopes);
+    uint16_t enclosing_next_register = next_register;
+    int enclosing_target = target;
+
+    uint16_t parameters = statement.parameters.size();
+    body.code.clear();
+    body.constants.clear();
+    body.constant_indices.clear();
+    body.register_count = parameters;
+    function = &body;
+    scopes = {{0, parameters}};
+    next_register = parameters;
+    target = -1;
+    for (StmtPtr body_statement : statement.body)
+        compile(body_statement);
+    emit(REG_RETURN_VOID);
+    body.is_compiled = true;
+
+    function = enclosing_function;
+    scopes = std::move(enclosing_scopes);
+    next_register = enclosing_next_register;
+    target = enclosing_target;
+
+    if (is_disassembling)
+        std::cout << body.disassemble(global_names, function_names);
+    return body;
+}
+
+void RegCompiler::set_resolver(Resolver* resolver) {
+    this->resolver = resolver;
+}
+
+void RegCompiler::set_typechecker(Typechecker* typechecker) {
+    this->typechecker = typechecker;
+}
+
+void RegCompiler::set_optimizer(Optimizer* optimizer) {
+    this->optimizer = optimizer;
+}
+
+void RegCompiler::set_disassemble(bool is_disassembling) {
+    this->is_disassembling = is_disassembling;
+}
+
+/* Returns the operand holding the expression's value, which is in
+register target if there is one. Without one, it's whatever is cheapest:
+a constant, a variable's own register, or a new temporary */
+uint16_t RegCompiler::compile(ExprPtr expression, int target) {
+    int enclosing = this->target;
+    this->target = target;
+    uint16_t operand = std::any_cast<uint16_t>(expression->accept(*this));
+    this->target = enclosing;
+    return operand;
+}
+
+void RegCompiler::compile(StmtPtr statement) {
+    statement->accept(*this);
+    // Temporaries only live as long as the statement that needed them
+    next_register = scopes.empty() ? 0 : scopes.back().base + scopes.back().size;
+}
+
+size_t RegCompiler::emit(RegOp op, uint16_t a, uint16_t b, uint16_t c) {
+    function->code.push_back({op, a, b, c});
+    return function->code.size() - 1;
+}
+
+uint16_t RegCompiler::allocate() {
+    if (next_register >= RegFunction::constant_bit - 1)
+        throw_error("Too many registers in one function.");
+    function->register_count = std::max<uint16_t>(function->register_count, next_register + 1);
+    return next_register++;
+}
+
+// The operand for value in the current function's constants
+uint16_t RegCompiler::constant(const Value& value) {
+    uint32_t index = function->add_constant(value);
+    if (index >= RegFunction::constant_bit)
+        throw_error("Too many constants in one function.");
+    return RegFunction::constant(index);
+}
+
+uint16_t RegCompiler::destination(int target) {
+    return target >= 0 ? target : allocate();
+}
+
+// Moves operand into target, when there is one and it isn't there already
+uint16_t RegCompiler::place(uint16_t operand) {
+    if (target < 0 || operand == target)
+        return operand;
+    emit(REG_MOVE, target, operand);
+    return target;
+}
+
+/* An operand read straight from a variable's register (below mark, where
+the expression's temporaries start) has to be copied out first when the
+operand after it could assign to the variable, i.e. "a + (a = 1)" */
+uint16_t RegCompiler::keep(uint16_t operand, uint16_t mark, ExprPtr later) {
+    if (RegFunction::is_constant(operand) || operand >= mark || !assigns(later))
+        return operand;
+    uint16_t copy = allocate();
+    emit(REG_MOVE, copy, operand);
+    return copy;
+}
+
+bool RegCompiler::assigns(ExprPtr expression) {
+    if (dynamic_cast<AssignExpression*>(expression))
+        return true;
+    if (GroupExpression* group = dynamic_cast<GroupExpression*>(expression))
+        return assigns(group->expression);
+    if (UnaryExpression* unary = dynamic_cast<UnaryExpression*>(expression))
+        return assigns(unary->operand);
+    if (BinaryExpression* binary = dynamic_cast<BinaryExpression*>(expression))
+        return assigns(binary->l_operand) || assigns(binary->r_operand);
+    if (LogicalExpression* logical = dynamic_cast<LogicalExpression*>(expression))
+        return assigns(logical->l_operand) || assigns(logical->r_operand);
+    if (BitwiseExpression* bitwise = dynamic_cast<BitwiseExpression*>(expression))
+        return assigns(bitwise->l_operand) || assigns(bitwise->r_operand);
+    if (TernaryExpression* ternary = dynamic_cast<TernaryExpression*>(expression))
+        return assigns(ternary->condition) || assigns(ternary->l_operand) || assigns(ternary->r_operand);
+    // A function only sees its own locals, so its body can't, only its arguments
+    if (CallExpression* call = dynamic_cast<CallExpression*>(expression))
+        return std::any_of(call->arguments.begin(), call->arguments.end(), assigns);
+    return false;
+}
+
+// Same lookup as Environment::index
+uint16_t RegCompiler::local_register(int depth, int slot) {
+    return scopes[scopes.size() - 1 - depth].base + slot;
+}
+
+void RegCompiler::name_global(int slot, std::string_view name) {
+    if (slot > UINT16_MAX)
+        throw_error("Too many global variables.");
+    if (global_names.size() <= static_cast<size_t>(slot))
+        global_names.resize(slot + 1);
+    global_names[slot] = name;
+}
+
+uint16_t RegCompiler::function_index(const FunctionStatement& statement) {
+    auto found_function = function_indices.find(&statement);
+    if (found_function != function_indices.end())
+        return found_function->second;
+
+    if (functions.size() > UINT16_MAX)
+        throw_error("Too many functions.");
+    functions.push_back(std::make_unique<RegFunction>());
+    functions.back()->statement = &statement;
+    function_names.push_back(std::string(statement.identifier.lexeme));
+    function_indices.insert({&statement, functions.size() - 1});
+    return functions.size() - 1;
+}
+
+/* Compiles a jump to be patched, taken when condition is falsy. A
+comparison of two i64s is fused into the jump, so a loop's "i < n"
+is one instruction */
+size_t RegCompiler::compile_jump_unless(ExprPtr condition) {
+    uint16_t mark = next_register;
+    ExprPtr inner = condition;
+    while (GroupExpression* group = dynamic_cast<GroupExpression*>(inner))
+        inner = group->expression;
+
+    BinaryExpression* binary = dynamic_cast<BinaryExpression*>(inner);
+    if (binary && binary->l_operand->static_type == LiteralType::I64 && binary->r_operand->static_type == LiteralType::I64) {
+        RegOp op = REG_HALT;
+        switch (binary->type) {
+            case LESS: op = REG_JUMP_UNLESS_LESS_INT; break;
+            case GREATER: op = REG_JUMP_UNLESS_GREATER_INT; break;
+            case LESS_EQ: op = REG_JUMP_UNLESS_LESS_EQ_INT; break;
+            case GREATER_EQ: op = REG_JUMP_UNLESS_GREATER_EQ_INT; break;
+            case NOT_EQ: op = REG_JUMP_UNLESS_NOT_EQ_INT; break;
+            case EQ: op = REG_JUMP_UNLESS_EQ_INT; break;
+            default: break;
+        }
+        if (op != REG_HALT) {
+            uint16_t l_operand = keep(compile(binary->l_operand), mark, binary->r_operand);
+            uint16_t r_operand = compile(binary->r_operand);
+            next_register = mark;
+            return emit(op, 0, l_operand, r_operand);
+        }
+    }
+
+    uint16_t value = compile(condition);
+    next_register = mark;
+    return emit(REG_JUMP_UNLESS, 0, value);
+}
+
+void RegCompiler::patch_jump(size_t jump) {
+    if (function->code.size() > UINT16_MAX)
+        throw_error("Too much code to jump over.");
+    function->code[jump].a = function->code.size();
+}
+
+void RegCompiler::begin_scope() {
+    scopes.push_back({next_register, 0});
+}
+
+void RegCompiler::end_scope() {
+    scopes.pop_back();
+}
+
+void RegCompiler::throw_error(std::string message) {
+    Tilda::had_error = true;
+    throw std::format("Compile Error: {}", message);
+}
+
+std::any RegCompiler::visit_unary_expression(const UnaryExpression& expression) {
+    uint16_t mark = next_register;
+    uint16_t operand = compile(expression.operand);
+    next_register = mark;
+    uint16_t a = destination(target);
+
+    // "i + 1" without the constant, INC and DEC don't store either way
+    if (expression.operand->static_type == LiteralType::I64 && !RegFunction::is_constant(operand)
+        && (expression.type == INC || expression.type == DEC)) {
+        emit(REG_ADD_INT_IMM, a, operand, static_cast<uint16_t>(expression.type == INC ? 1 : -1));
+        return a;
+    }
+
+    RegOp op;
+    switch (expression.type) {
+        case NEG: op = REG_NEG; break;
+        case L_NOT: op = REG_L_NOT; break;
+        case B_NOT: op = REG_B_NOT; break;
+        case INC: op = REG_INC; break;
+        case DEC: op = REG_DEC; break;
+        default: op = REG_MOVE; break;
+    }
+    emit(op, a, operand);
+    return a;
+}
+
+std::any RegCompiler::visit_binary_expression(const BinaryExpression& expression) {
+    uint16_t mark = next_register;
+    bool is_int = expression.l_operand->static_type == LiteralType::I64 && expression.r_operand->static_type == LiteralType::I64;
+    uint16_t l_operand = keep(compile(expression.l_operand), mark, expression.r_operand);
+
+    // Adding or subtracting a small literal from an i64 register is a single instruction with no constant
+    LiteralExpression* literal = dynamic_cast<LiteralExpression*>(expression.r_operand);
+    if (is_int && literal && !RegFunction::is_constant(l_operand) && (expression.type == ADD || expression.type == SUB)) {
+        int64_t immediate = expression.type == ADD ? literal->value.integer : -literal->value.integer;
+        if (immediate >= INT16_MIN && immediate <= INT16_MAX) {
+            next_register = mark;
+            uint16_t a = destination(target);
+            emit(REG_ADD_INT_IMM, a, l_operand, static_cast<uint16_t>(immediate));
+            return a;
+        }
+    }
+
+    uint16_t r_operand = compile(expression.r_operand);
+    next_register = mark;
+    RegOp op;
+    switch (expression.type) {
+        case GREATER: op = is_int ? REG_GREATER_INT : REG_GREATER; break;
+        case GREATER_EQ: op = is_int ? REG_GREATER_EQ_INT : REG_GREATER_EQ; break;
+        case LESS: op = is_int ? REG_LESS_INT : REG_LESS; break;
+        case LESS_EQ: op = is_int ? REG_LESS_EQ_INT : REG_LESS_EQ; break;
+        case EQ: op = is_int ? REG_EQ_INT : REG_EQ; break;
+        case NOT_EQ: op = is_int ? REG_NOT_EQ_INT : REG_NOT_EQ; break;
+        case ADD: op = is_int ? REG_ADD_INT : REG_ADD; break;
+        case SUB: op = is_int ? REG_SUB_INT : REG_SUB; break;
+        case MUL: op = is_int ? REG_MUL_INT : REG_MUL; break;
+        case DIV: op = REG_DIV; break;
+        case POW: op = REG_POW; break;
+        case MOD: op = REG_MOD; break;
+        default: op = REG_ADD; break;
+    }
+    uint16_t a = destination(target);
+    emit(op, a, l_operand, r_operand);
+    return a;
+}
+
+// Both branches leave their value in the same register
+std::any RegCompiler::visit_ternary_expression(const TernaryExpression& expression) {
+    uint16_t a = destination(target);
+    size_t else_jump = compile_jump_unless(expression.condition);
+    compile(expression.l_operand, a);
+    size_t end_jump = emit(REG_JUMP);
+    patch_jump(else_jump);
+    compile(expression.r_operand, a);
+    patch_jump(end_jump);
+    return a;
+}
+
+std::any RegCompiler::visit_literal_expression(const LiteralExpression& expression) {
+    return place(constant(expression.value));
+}
+
+std::any RegCompiler::visit_group_expression(const GroupExpression& expression) {
+    return compile(expression.expression, target);
+}
+
+std::any RegCompiler::visit_variable_expression(const VariableExpression& expression) {
+    if (expression.depth >= 0)
+        return place(local_register(expression.depth, expression.slot));
+    name_global(expression.slot, expression.identifier.lexeme);
+    uint16_t a = destination(target);
+    emit(REG_GET_GLOBAL, a, expression.slot);
+    return a;
+}
+
+std::any RegCompiler::visit_assign_expression(const AssignExpression& expression) {
+    if (expression.depth < 0) {
+        // The store checks the type itself, after it checks the global is defined like the Interpreter does
+        uint16_t value = compile(expression.expression);
+        name_global(expression.slot, expression.identifier.lexeme);
+        emit(REG_SET_GLOBAL, expression.slot, value, static_cast<uint16_t>(expression.checked_type));
+        return place(value);
+    }
+
+    // A local's check can come after the store, a runtime error ends the program or REPL line
+    uint16_t variable = local_register(expression.depth, expression.slot);
+    compile(expression.expression, variable);
+    if (expression.checked_type != LiteralType::VOID)
+        emit(REG_CHECK_TYPE, variable, static_cast<uint16_t>(expression.checked_type));
+    return place(variable);
+}
+
+// Like the Interpreter, ranges and member access don't do anything yet
+std::any RegCompiler::visit_range_expression(const RangeExpression& expression) {
+    uint16_t a = destination(target);
+    emit(REG_VOID, a);
+    return a;
+}
+
+std::any RegCompiler::visit_access_expression(const AccessExpression& expression) {
+    uint16_t a = destination(target);
+    emit(REG_VOID, a);
+    return a;
+}
+
+/* Arguments go in consecutive registers at the top of the caller's
+frame, which become the callee's first registers, so nothing is copied.
+Each one is checked against its parameter's type right after it's
+evaluated, same as the Interpreter, unless the Typechecker proved it */
+std::any RegCompiler::visit_call_expression(const CallExpression& expression) {
+    const FunctionStatement& callee = *expression.function;
+    uint16_t index = function_index(callee);
+    uint16_t base = next_register;
+    for (size_t i = 0; i < expression.arguments.size(); i++)
+        allocate();
+    for (size_t i = 0; i < expression.arguments.size(); i++) {
+        compile(expression.arguments[i], base + i);
+        LiteralType type = Typechecker::runtime_type(callee.parameters[i].type);
+        if (type != LiteralType::VOID && expression.arguments[i]->static_type != type)
+            emit(REG_CHECK_TYPE, base + i, static_cast<uint16_t>(type));
+    }
+    next_register = base;
+    uint16_t a = destination(target);
+    emit(REG_CALL, a, index, base);
+    return a;
+}
+
+std::any RegCompiler::visit_logical_expression(const LogicalExpression& expression) {
+    // Both operands are always evaluated, same as the Interpreter
+    uint16_t mark = next_register;
+    uint16_t l_operand = keep(compile(expression.l_operand), mark, expression.r_operand);
+    uint16_t r_operand = compile(expression.r_operand);
+    next_register = mark;
+    RegOp op;
+    switch (expression.type) {
+        case L_OR: op = REG_L_OR; break;
+        case L_AND: op = REG_L_AND; break;
+        default: op = REG_L_XOR; break;
+    }
+    uint16_t a = destination(target);
+    emit(op, a, l_operand, r_operand);
+    return a;
+}
+
+std::any RegCompiler::visit_bitwise_expression(const BitwiseExpression& expression) {
+    uint16_t mark = next_register;
+    uint16_t l_operand = keep(compile(expression.l_operand), mark, expression.r_operand);
+    uint16_t r_operand = compile(expression.r_operand);
+    next_register = mark;
+    RegOp op;
+    switch (expression.type) {
+        case B_OR: op = REG_B_OR; break;
+        case B_AND: op = REG_B_AND; break;
+        case B_XOR: op = REG_B_XOR; break;
+        case LSHFT: op = REG_LSHFT; break;
+        case RSHFT: op = REG_RSHFT; break;
+        default: op = REG_CHK; break;
+    }
+    uint16_t a = destination(target);
+    emit(op, a, l_operand, r_operand);
+    return a;
+}
+
+void RegCompiler::visit_expression_statement(const ExpressionStatement& statement) {
+    compile(statement.expression);
+}
+
+void RegCompiler::visit_print_statement(const PrintStatement& statement) {
+    emit(REG_PRINT, compile(statement.expression));
+}
+
+void RegCompiler::visit_type_statement(const TypeStatement& statement) {
+    emit(REG_TYPEOF, compile(statement.expression));
+}
+
+void RegCompiler::visit_block_statement(const BlockStatement& statement) {
+    begin_scope();
+    for (StmtPtr block_statement : statement.statements)
+        compile(block_statement);
+    end_scope();
+}
+
+void RegCompiler::visit_declare_statement(const DeclareStatement& statement) {
+    if (scopes.empty()) {
+        if (!statement.is_redeclaration) {
+            name_global(statement.slot, statement.identifier.lexeme);
+            emit(REG_DECLARE_GLOBAL, statement.slot);
+        }
+        uint16_t value = statement.expression ? compile(statement.expression) : constant(Value());
+        if (statement.checked_type != LiteralType::VOID)
+            emit(REG_CHECK_TYPE, value, static_cast<uint16_t>(statement.checked_type));
+        if (!statement.is_redeclaration)
+            emit(REG_DEFINE_GLOBAL, statement.slot, value);
+        return;
+    }
+
+    /* Redeclaring a variable in the same scope keeps the original
+    value, so the initializer is evaluated and then discarded */
+    if (statement.is_redeclaration) {
+        if (statement.expression)
+            compile(statement.expression);
+        return;
+    }
+
+    // The new local's register is taken before its initializer, so no temporary lands on it
+    Scope& scope = scopes.back();
+    uint16_t variable = scope.base + statement.slot;
+    scope.size = statement.slot + 1;
+    next_register = variable;
+    allocate();
+    if (statement.expression)
+        compile(statement.expression, variable);
+    else
+        emit(REG_VOID, variable);
+    if (statement.checked_type != LiteralType::VOID)
+        emit(REG_CHECK_TYPE, variable, static_cast<uint16_t>(statement.checked_type));
+}
+
+void RegCompiler::visit_if_statement(const IfStatement& statement) {
+    size_t else_jump = compile_jump_unless(statement.expression);
+    compile(statement.then_branch);
+    if (statement.else_branch) {
+        size_t end_jump = emit(REG_JUMP);
+        patch_jump(else_jump);
+        compile(statement.else_branch);
+        patch_jump(end_jump);
+    }
+    else
+        patch_jump(else_jump);
+}
+
+void RegCompiler::visit_while_statement(const WhileStatement& statement) {
+    size_t loop_start = function->code.size();
+    size_t exit_jump = compile_jump_unless(statement.expression);
+    compile(statement.statements);
+    emit(REG_JUMP, loop_start);
+    patch_jump(exit_jump);
+}
+
+void RegCompiler::visit_for_statement(const ForStatement& statement) {
+    ;
+}
+
+void RegCompiler::visit_forin_statement(const ForInStatement& statement) {
+    ;
+}
+
+void RegCompiler::visit_switch_statement(const SwitchStatement& statement) {
+    ;
+}
+
+void RegCompiler::visit_return_statement(const ReturnStatement& statement) {
+    if (statement.expression)
+        emit(REG_RETURN, compile(statement.expression));
+    else
+        emit(REG_RETURN_VOID);
+}
+
+void RegCompiler::visit_struct_statement(const StructStatement& statement) {
+    ;
+}
+
+// The Resolver already knows about the function, and its body is compiled on its first call
+void RegCompiler::visit_function_statement(const FunctionStatement& statement) {
+    ;
+}
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include <iostream>
+#include <stdint.h>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "interpreter.hpp"
+#include "regcode.hpp"
+#include "regcompiler.hpp"
+#include "token.hpp"
+#include "tilda.hpp"
+#include "value.hpp"
+#include "regvm.hpp"
+
+/* GCC and Clang can jump straight from one handler to the next through
+a table of label addresses, which gives every handler its own indirect
+branch instead of sharing the switch's. -DTILDA_SWITCH_DISPATCH forces
+the portable switch */
+#if defined(__GNUC__) && !defined(TILDA_SWITCH_DISPATCH)
+#define TILDA_COMPUTED_GOTO 1
+#endif
+
+void RegVM::throw_error(std::string message) {
+    Interpreter::throw_error(message);
+}
+
+void RegVM::run(const RegFunction& script) {
+    // Same as Interpreter::visit_declare_statement, a global whose initializer failed (on the last REPL line) is still defined
+    if (declaring >= 0) {
+        globals[declaring].is_defined = true;
+        declaring = -1;
+    }
+    frames.clear();
+    if (registers.size() < script.register_count)
+        registers.resize(script.register_count);
+    if (globals.size() < compiler.get_global_names().size())
+        globals.resize(compiler.get_global_names().size());
+
+    const RegFunction* function = &script;
+    const RegInstruction* code = script.code.data();
+    const RegInstruction* ip = code;
+    const RegInstruction* instruction;
+    const Value* constants = script.constants.data();
+    size_t base = 0;
+    Value* frame = registers.data();
+
+    #define A instruction->a
+    #define B instruction->b
+    #define C instruction->c
+    #define R(operand) frame[operand]
+    #define RK(operand) (RegFunction::is_constant(operand) ? constants[(operand) & ~RegFunction::constant_bit] : frame[operand])
+    #define UNARY_OP(type) R(A) = Interpreter::apply_unary(type, RK(B))
+    #define BINARY_OP(apply, type) R(A) = Interpreter::apply(type, RK(B), RK(C))
+    // No type checks, the Typechecker proved both operands are i64
+    #define INT_OP(op) R(A) = RK(B).integer op RK(C).integer
+    // Same, for arithmetic, which wraps around through Value's helpers
+    #define WRAPPING_OP(wrapping) R(A) = Value::wrapping(RK(B).integer, RK(C).integer)
+    #define JUMP_UNLESS_INT(op) if (!(RK(B).integer op RK(C).integer)) ip = code + A
+
+#ifdef TILDA_COMPUTED_GOTO
+    #define REG_LABEL(op) &&LABEL_##op,
+    static const void* const dispatch[] = {
+        REG_OPCODES(REG_LABEL)
+    };
+    #undef REG_LABEL
+    #define CASE(op) LABEL_##op:
+    #define NEXT() instruction = ip++; goto *dispatch[instruction->op]
+    NEXT();
+#else
+    #define CASE(op) case op:
+    #define NEXT() continue
+    while (true) {
+        instruction = ip++;
+        switch (instruction->op) {
+#endif
+            CASE(REG_MOVE) R(A) = RK(B); NEXT();
+            CASE(REG_VOID) R(A) = Value(); NEXT();
+            CASE(REG_GET_GLOBAL) {
+                if (!globals[B].is_defined)
+                    throw_error(std::format("Undefined variable: \"{}\".", compiler.get_global_names()[B]));
+                R(A) = globals[B].value;
+                NEXT();
+            }
+            CASE(REG_SET_GLOBAL) {
+                if (!globals[A].is_defined)
+                    throw_error(std::format("Undefined variable: \"{}\".", compiler.get_global_names()[A]));
+                if (static_cast<LiteralType>(C) != LiteralType::VOID)
+                    Interpreter::check_type(static_cast<LiteralType>(C), RK(B));
+                globals[A].value = RK(B);
+                NEXT();
+            }
+            CASE(REG_DEFINE_GLOBAL) {
+                globals[A].value = RK(B);
+                globals[A].is_defined = true;
+                declaring = -1;
+                NEXT();
+            }
+            CASE(REG_DECLARE_GLOBAL) declaring = A; NEXT();
+            CASE(REG_CHECK_TYPE) Interpreter::check_type(static_cast<LiteralType>(B), RK(A)); NEXT();
+            CASE(REG_ADD) BINARY_OP(apply_binary, ADD); NEXT();
+            CASE(REG_SUB) BINARY_OP(apply_binary, SUB); NEXT();
+            CASE(REG_MUL) BINARY_OP(apply_binary, MUL); NEXT();
+            CASE(REG_DIV) BINARY_OP(apply_binary, DIV); NEXT();
+            CASE(REG_POW) BINARY_OP(apply_binary, POW); NEXT();
+            CASE(REG_MOD) BINARY_OP(apply_binary, MOD); NEXT();
+            CASE(REG_LESS) BINARY_OP(apply_binary, LESS); NEXT();
+            CASE(REG_GREATER) BINARY_OP(apply_binary, GREATER); NEXT();
+            CASE(REG_LESS_EQ) BINARY_OP(apply_binary, LESS_EQ); NEXT();
+            CASE(REG_GREATER_EQ) BINARY_OP(apply_binary, GREATER_EQ); NEXT();
+            CASE(REG_NOT_EQ) BINARY_OP(apply_binary, NOT_EQ); NEXT();
+            CASE(REG_EQ) BINARY_OP(apply_binary, EQ); NEXT();
+            CASE(REG_L_OR) BINARY_OP(apply_logical, L_OR); NEXT();
+            CASE(REG_L_AND) BINARY_OP(apply_logical, L_AND); NEXT();
+            CASE(REG_L_XOR) BINARY_OP(apply_logical, L_XOR); NEXT();
+            CASE(REG_B_OR) BINARY_OP(apply_bitwise, B_OR); NEXT();
+            CASE(REG_B_AND) BINARY_OP(apply_bitwise, B_AND); NEXT();
+            CASE(REG_B_XOR) BINARY_OP(apply_bitwise, B_XOR); NEXT();
+            CASE(REG_LSHFT) BINARY_OP(apply_bitwise, LSHFT); NEXT();
+            CASE(REG_RSHFT) BINARY_OP(apply_bitwise, RSHFT); NEXT();
+            CASE(REG_CHK) BINARY_OP(apply_bitwise, CHK); NEXT();
+            CASE(REG_NEG) UNARY_OP(NEG); NEXT();
+            CASE(REG_INC) UNARY_OP(INC); NEXT();
+            CASE(REG_DEC) UNARY_OP(DEC); NEXT();
+            CASE(REG_L_NOT) UNARY_OP(L_NOT); NEXT();
+            CASE(REG_B_NOT) UNARY_OP(B_NOT); NEXT();
+            CASE(REG_ADD_INT) WRAPPING_OP(wrapping_add); NEXT();
+            CASE(REG_SUB_INT) WRAPPING_OP(wrapping_sub); NEXT();
+            CASE(REG_MUL_INT) WRAPPING_OP(wrapping_mul); NEXT();
+            CASE(REG_LESS_INT) INT_OP(<); NEXT();
+            CASE(REG_GREATER_INT) INT_OP(>); NEXT();
+            CASE(REG_LESS_EQ_INT) INT_OP(<=); NEXT();
+            CASE(REG_GREATER_EQ_INT) INT_OP(>=); NEXT();
+            CASE(REG_NOT_EQ_INT) INT_OP(!=); NEXT();
+            CASE(REG_EQ_INT) INT_OP(==); NEXT();
+            CASE(REG_ADD_INT_IMM) R(A) = Value::wrapping_add(R(B).integer, static_cast<int16_t>(C)); NEXT();
+            CASE(REG_JUMP_UNLESS_LESS_INT) JUMP_UNLESS_INT(<); NEXT();
+            CASE(REG_JUMP_UNLESS_GREATER_INT) JUMP_UNLESS_INT(>); NEXT();
+            CASE(REG_JUMP_UNLESS_LESS_EQ_INT) JUMP_UNLESS_INT(<=); NEXT();
+            CASE(REG_JUMP_UNLESS_GREATER_EQ_INT) JUMP_UNLESS_INT(>=); NEXT();
+            CASE(REG_JUMP_UNLESS_NOT_EQ_INT) JUMP_UNLESS_INT(!=); NEXT();
+            CASE(REG_JUMP_UNLESS_EQ_INT) JUMP_UNLESS_INT(==); NEXT();
+            CASE(REG_JUMP) ip = code + A; NEXT();
+            CASE(REG_JUMP_UNLESS) {
+                if (!Interpreter::get_truthiness(RK(B)))
+                    ip = code + A;
+                NEXT();
+            }
+            CASE(REG_CALL) {
+                // Compiling the body can name more globals
+                const RegFunction& callee = compiler.get_function(B);
+                if (globals.size() < compiler.get_global_names().size())
+                    globals.resize(compiler.get_global_names().size());
+                if (frames.size() == Interpreter::max_call_depth)
+                    throw_error(std::format("Stack overflow in \"{}\".", callee.statement->identifier.lexeme));
+
+                frames.push_back({function, ip, base, A});
+                base += C;
+                if (registers.size() < base + callee.register_count)
+                    registers.resize(base + callee.register_count);
+                function = &callee;
+                code = callee.code.data();
+                ip = code;
+                constants = callee.constants.data();
+                frame = registers.data() + base;
+                NEXT();
+            }
+            CASE(REG_RETURN) {
+                Value result = std::move(RK(A));
+                Frame& caller = frames.back();
+                function = caller.function;
+                code = function->code.data();
+                ip = caller.ip;
+                constants = function->constants.data();
+                base = caller.base;
+                frame = registers.data() + base;
+                R(caller.result) = std::move(result);
+                frames.pop_back();
+                NEXT();
+            }
+            CASE(REG_RETURN_VOID) {
+                Frame& caller = frames.back();
+                function = caller.function;
+                code = function->code.data();
+                ip = caller.ip;
+                constants = function->constants.data();
+                base = caller.base;
+                frame = registers.data() + base;
+                R(caller.result) = Value();
+                frames.pop_back();
+                NEXT();
+            }
+            CASE(REG_PRINT) std::cout << Interpreter::to_string(RK(A)) << std::endl; NEXT();
+            CASE(REG_TYPEOF) std::cout << std::format("Type: {}", Interpreter::get_type(RK(A))) << std::endl; NEXT();
+            CASE(REG_HALT) return;
+#ifndef TILDA_COMPUTED_GOTO
+        }
+    }
+#endif
+
+    #undef A
+    #undef B
+    #undef C
+    #undef R
+    #undef RK
+    #undef UNARY_OP
+    #undef BINARY_OP
+    #undef INT_OP
+    #undef WRAPPING_OP
+    #undef JUMP_UNLESS_INT
+    #undef CASE
+    #undef NEXT
+}
\ No newline at end of file
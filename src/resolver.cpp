@@ -0,0 +1,224 @@
+#include <format>
+#include <string>
+#include <vector>
+#include <any>
+#include <map>
+
+#include "expression.hpp"
+#include "statement.hpp"
+#include "resolver.hpp"
+#include "tilda.hpp"
+#include "token.hpp"
+
+void Resolver::resolve(std::span<const StmtPtr> statements) {
+    // Drop any scopes left open by a previous resolve() that threw
+    scopes.resize(1);
+    in_function = false;
+    for (StmtPtr statement : statements)
+        resolve(statement);
+}
+
+// Called by the Interpreter on the function's first call
+void Resolver::resolve_body(const FunctionStatement& function) {
+    bool enclosing = in_function;
+    in_function = true;
+    begin_scope();
+    // Parameters are the first slots of the function's scope
+    for (const Parameter& parameter : function.parameters) {
+        if (scopes.back().contains(parameter.identifier.lexeme))
+            throw_error(std::format("Duplicate parameter: \"{}\".", parameter.identifier.lexeme));
+        scopes.back().insert({std::string(parameter.identifier.lexeme), {static_cast<int>(scopes.back().size()), false}});
+    }
+    for (StmtPtr statement : function.body)
+        resolve(statement);
+    end_scope();
+    in_function = enclosing;
+    function.is_resolved = true;
+}
+
+void Resolver::resolve(ExprPtr expression) {
+    expression->accept(*this);
+}
+
+void Resolver::resolve(StmtPtr statement) {
+    statement->accept(*this);
+}
+
+void Resolver::begin_scope() {
+    scopes.push_back({});
+}
+
+void Resolver::end_scope() {
+    scopes.pop_back();
+}
+
+bool Resolver::resolve_identifier(Token identifier, int& depth, int& slot) {
+    for (int i = scopes.size() - 1; i >= 0; i--) {
+        auto found_slot = scopes[i].find(identifier.lexeme);
+        if (found_slot != scopes[i].end()) {
+            depth = i == 0 ? -1 : scopes.size() - 1 - i;
+            slot = found_slot->second.slot;
+            return found_slot->second.is_const;
+        }
+    }
+    throw_error(std::format("Undefined variable: \"{}\".", identifier.lexeme));
+    return false;
+}
+
+void Resolver::throw_error(std::string message) {
+    Tilda::had_error = true;
+    throw message;
+}
+
+std::any Resolver::visit_unary_expression(const UnaryExpression& expression) {
+    resolve(expression.operand);
+    return std::any();
+}
+
+std::any Resolver::visit_binary_expression(const BinaryExpression& expression) {
+    resolve(expression.l_operand);
+    resolve(expression.r_operand);
+    return std::any();
+}
+
+std::any Resolver::visit_ternary_expression(const TernaryExpression& expression) {
+    resolve(expression.condition);
+    resolve(expression.l_operand);
+    resolve(expression.r_operand);
+    return std::any();
+}
+
+std::any Resolver::visit_literal_expression(const LiteralExpression& expression) {
+    return std::any();
+}
+
+std::any Resolver::visit_group_expression(const GroupExpression& expression) {
+    resolve(expression.expression);
+    return std::any();
+}
+
+std::any Resolver::visit_variable_expression(const VariableExpression& expression) {
+    resolve_identifier(expression.identifier, expression.depth, expression.slot);
+    return std::any();
+}
+
+std::any Resolver::visit_assign_expression(const AssignExpression& expression) {
+    resolve(expression.expression);
+    if (resolve_identifier(expression.identifier, expression.depth, expression.slot))
+        throw_error(std::format("Can't assign to const \"{}\".", expression.identifier.lexeme));
+    return std::any();
+}
+
+std::any Resolver::visit_range_expression(const RangeExpression& expression) {
+    resolve(expression.l_operand);
+    resolve(expression.r_operand);
+    return std::any();
+}
+
+std::any Resolver::visit_access_expression(const AccessExpression& expression) {
+    resolve(expression.l_operand);
+    return std::any();
+}
+
+std::any Resolver::visit_call_expression(const CallExpression& expression) {
+    auto found = functions.find(expression.function_name.lexeme);
+    if (found == functions.end())
+        throw_error(std::format("Undefined function: \"{}\".", expression.function_name.lexeme));
+    const FunctionStatement* function = found->second;
+    if (function->parameters.size() != expression.arguments.size())
+        throw_error(std::format("\"{}\" expects {} arguments but got {}.",
+            expression.function_name.lexeme, function->parameters.size(), expression.arguments.size()));
+    expression.function = function;
+    for (ExprPtr argument : expression.arguments)
+        resolve(argument);
+    return std::any();
+}
+
+std::any Resolver::visit_logical_expression(const LogicalExpression& expression) {
+    resolve(expression.l_operand);
+    resolve(expression.r_operand);
+    return std::any();
+}
+
+std::any Resolver::visit_bitwise_expression(const BitwiseExpression& expression) {
+    resolve(expression.l_operand);
+    resolve(expression.r_operand);
+    return std::any();
+}
+
+void Resolver::visit_expression_statement(const ExpressionStatement& statement) {
+    resolve(statement.expression);
+}
+
+void Resolver::visit_print_statement(const PrintStatement& statement) {
+    resolve(statement.expression);
+}
+
+void Resolver::visit_type_statement(const TypeStatement& statement) {
+    resolve(statement.expression);
+}
+
+void Resolver::visit_block_statement(const BlockStatement& statement) {
+    begin_scope();
+    for (StmtPtr block_statement : statement.statements)
+        resolve(block_statement);
+    end_scope();
+}
+
+void Resolver::visit_declare_statement(const DeclareStatement& statement) {
+    // The initializer can still see a shadowed variable of the same name
+    if (statement.expression)
+        resolve(statement.expression);
+
+    std::map<std::string, Variable, std::less<>>& scope = scopes.back();
+    auto found_slot = scope.find(statement.identifier.lexeme);
+    if (found_slot != scope.end()) {
+        statement.slot = found_slot->second.slot;
+        statement.is_redeclaration = true;
+        return;
+    }
+    statement.slot = scope.size();
+    scope.insert({std::string(statement.identifier.lexeme), {statement.slot, statement.is_const}});
+}
+
+void Resolver::visit_if_statement(const IfStatement& statement) {
+    resolve(statement.expression);
+    resolve(statement.then_branch);
+    if (statement.else_branch)
+        resolve(statement.else_branch);
+}
+
+void Resolver::visit_while_statement(const WhileStatement& statement) {
+    resolve(statement.expression);
+    resolve(statement.statements);
+}
+
+void Resolver::visit_for_statement(const ForStatement& statement) {
+    ;
+}
+
+void Resolver::visit_forin_statement(const ForInStatement& statement) {
+    ;
+}
+
+void Resolver::visit_switch_statement(const SwitchStatement& statement) {
+    ;
+}
+
+void Resolver::visit_return_statement(const ReturnStatement& statement) {
+    if (!in_function)
+        throw_error("Can't return from outside a function.");
+    if (statement.expression)
+        resolve(statement.expression);
+}
+
+void Resolver::visit_struct_statement(const StructStatement& statement) {
+    ;
+}
+
+void Resolver::visit_function_statement(const FunctionStatement& statement) {
+    // Bodies only see their own scope and the globals, so there's nothing to close over
+    if (scopes.size() > 1)
+        throw_error("Functions can only be declared at the top level.");
+    functions.insert_or_assign(std::string(statement.identifier.lexeme), &statement);
+}
\ No newline at end of file
@@ -1,17 +1,21 @@
+#include <algorithm>
 #include <stdint.h>
 #include <iostream>
-#include <variant>
+#include <charconv>
+#include <string_view>
 #include <format>
 #include <string>
-#include <any>
 
 #include "scanner.hpp"
+#include "simd.hpp"
 #include "tilda.hpp"
 #include "token.hpp"
+#include "value.hpp"
 
-Scanner::Scanner(std::string src) {
-    this->src = src;
-    scan_tokens();
+Scanner::Scanner(std::string_view src, bool is_lazy, int first_line) :
+    src(src), line(first_line), tokens(src) {
+    if (!is_lazy)
+        scan_tokens();
 }
 
 /* Advance the loop by getting the next
@@ -19,13 +23,13 @@ character in the source code */
 char Scanner::next() {
     if (!is_at_end())
         current++;
-    return src.at(current - 1);
+    return src[current - 1];
 }
 
 /* Observes the current character without
 advancing the character pointer */
 char Scanner::peek() {
-    return src.at(current - 1);
+    return src[current - 1];
 }
 
 /* Observes the next character without
@@ -33,7 +37,7 @@ advancing the character pointer */
 char Scanner::peek_next() {
     if (is_at_end())
         return '\0';
-    return src.at(current);
+    return src[current];
 }
 
 /* Returns true if the current character
@@ -43,95 +47,137 @@ bool Scanner::is_at_end() {
 }
 
 void Scanner::handle_string() {
-    do {
-        if (peek_next() == '\n')
-            line++;
-        next();
-    } while (peek() != '"' && !is_at_end());
+    size_t closing_quote = Simd::find(src, current, '"');
+    // Strings can span lines
+    line += std::count(src.begin() + current, src.begin() + closing_quote, '\n');
+    current = closing_quote;
 
-    if (peek() != '"' && is_at_end()) {
+    if (is_at_end()) {
         throw_error("Unterminated string!");
         return;
     }
+    // Consume the closing quote
+    current++;
 
     // Literal should cut off quotes
-    std::string literal = src.substr(start + 1, current - start - 2);
+    std::string literal(src.substr(start + 1, current - start - 2));
     add_token(STR, literal);
 }
 
+// Consumes a run of digits, which may be split up by single '_' separators
+void Scanner::handle_digits() {
+    current = Simd::skip_digits(src, current);
+    while (peek_next() == '_' && current + 1 < src.length() && isdigit(src[current + 1]))
+        current = Simd::skip_digits(src, current + 1);
+}
+
 void Scanner::handle_number() {
     bool is_hex = false, is_binary = false, is_float = false;
-    do {
-        next();
-    } while (isdigit(peek()) && !is_at_end());
-        // next();
+    handle_digits();
+    // The characters right after the leading digits
+    char denoter = peek_next();
+    char after_denoter = current + 1 < src.length() ? src[current + 1] : '\0';
 
     // Look for floating point
-    if (peek() == '.' && isdigit(peek_next())) {
+    if (denoter == '.' && isdigit(after_denoter)) {
         is_float = true;
-        // Just consume that '.'
-        next();
-        while (isdigit(peek_next()) && !is_at_end())
-            next();
+        current++;
+        handle_digits();
     }
     // Look for 'x' denoter
-    else if (peek() == 'x' && isalnum(peek_next())) {
+    else if (denoter == 'x' && isalnum(after_denoter)) {
         is_hex = true;
-        // Consume!
-        next();
-        while (isalnum(peek_next()) && !is_at_end())
-            next();
+        // Consume everything that could be meant as a digit, so bad ones get reported
+        current++;
+        while (isalnum(peek_next()) || peek_next() == '_')
+            current++;
     }
     // Look for 'b' denoter
-    else if (peek() == 'b' && isdigit(peek_next())) {
+    else if (denoter == 'b' && isdigit(after_denoter)) {
         is_binary = true;
-        // Consume!
-        next();
-        while (isdigit(peek_next()) && !is_at_end())
-            next();
+        current++;
+        while (isdigit(peek_next()) || peek_next() == '_')
+            current++;
     }
 
-    if (!is_float && !is_hex && !is_binary)
-        current--;
-
-    std::variant<int64_t, double> literal;
-    if (is_float)
-        literal = std::stod(src.substr(start, current - start));
-    else if (is_hex)
-        literal = std::stoll(src.substr(start + 2, current - start - 2), nullptr, 16);
-    else if (is_binary)
-        literal = std::stoll(src.substr(start + 2, current - start - 2), nullptr, 2);
+    std::string_view lexeme = src.substr(start, current - start);
+    if (is_hex || is_binary) {
+        if (lexeme[0] != '0' || lexeme[1] != (is_hex ? 'x' : 'b'))
+            throw_error(std::format("Expected \"0{}\" at the start of \"{}\".", is_hex ? 'x' : 'b', lexeme));
+        add_token(NUM, decode_radix(lexeme.substr(2), is_hex ? 4 : 1));
+    }
     else
-        literal = std::stoll(src.substr(start, current - start));
-    add_token(NUM, is_float ? std::any(std::get<double>(literal)) : std::any(std::get<int64_t>(literal)));
+        add_token(NUM, decode_decimal(lexeme, is_float));
 }
 
-// TODO: unicode support
-void Scanner::handle_identifier_or_type() {
-    while ((isalnum(peek_next()) || peek_next() == '_') && !is_at_end())
-        next();
+/* Hex (4 bits per digit) and binary (1) literals can use all 64 bits, i.e. 0xFFFFFFFFFFFFFFFF is -1.
+Like decimal ones, their digits may be split up by single '_' separators */
+Value Scanner::decode_radix(std::string_view digits, int bits_per_digit) {
+    const char* radix_name = bits_per_digit == 4 ? "hex" : "binary";
+    uint64_t value = 0;
+    for (size_t i = 0; i < digits.length(); i++) {
+        char c = digits[i];
+        if (c == '_') {
+            if (i == 0 || i + 1 == digits.length() || digits[i + 1] == '_')
+                throw_error(std::format("Misplaced \"_\" in {} literal.", radix_name));
+            continue;
+        }
+        uint64_t digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            digit = UINT64_MAX;
+        if (digit >> bits_per_digit)
+            throw_error(std::format("Invalid digit \"{}\" in {} literal.", c, radix_name));
+        if (value >> (64 - bits_per_digit))
+            throw_error(std::format("The {} literal doesn't fit in 64 bits.", radix_name));
+        value = (value << bits_per_digit) | digit;
+    }
+    return Value(static_cast<int64_t>(value));
+}
 
-    std::string lexeme = src.substr(start, current - start);
-    TokenType type;
+Value Scanner::decode_decimal(std::string_view digits, bool is_float) {
+    // from_chars doesn't know about separators, so strip them into a stack buffer
+    char buffer[128];
+    if (digits.find('_') != std::string_view::npos) {
+        size_t length = 0;
+        for (char c : digits) {
+            if (c == '_')
+                continue;
+            if (length == sizeof(buffer))
+                throw_error("Number literal is too long.");
+            buffer[length++] = c;
+        }
+        digits = std::string_view(buffer, length);
+    }
 
-    auto found_keyword = keywords.find(lexeme);
-    if (found_keyword != keywords.end())
-        type = found_keyword->second;
+    const char* end = digits.data() + digits.length();
+    std::from_chars_result result;
+    Value value;
+    if (is_float) {
+        double floating;
+        result = std::from_chars(digits.data(), end, floating);
+        value = Value(floating);
+    }
     else {
-        for (std::string data_type : types) {
-            if (lexeme == data_type)
-                type = TYPE;
-        }
-        if (type != TYPE) {
-            // TODO: remove
-            if (lexeme == "print")
-                type = PRINT;
-            else if (lexeme == "type")
-                type = TYPEOF;
-            else
-                type = IDENTIFIER;
-        }
+        int64_t integer;
+        result = std::from_chars(digits.data(), end, integer);
+        value = Value(integer);
     }
+    if (result.ec == std::errc::result_out_of_range)
+        throw_error(std::format("{} literal \"{}\" is out of range.", is_float ? "Float" : "Integer", src.substr(start, current - start)));
+    return value;
+}
+
+// TODO: unicode support
+void Scanner::handle_identifier_or_type() {
+    current = Simd::skip_identifier(src, current);
+
+    TokenType type = keywords.find(src.substr(start, current - start), IDENTIFIER);
     // bool handling (is this sloppy?)
     if (type == TRUE)
         add_token(type, true);
@@ -148,13 +194,13 @@ void Scanner::handle_two_char_operator(TokenType type, char next_char) {
 }
 
 void Scanner::add_token(TokenType type) {
-    add_token(type, std::any()); // NULL std::any value
+    tokens.push(type, start, current - start, line);
+    last_type = type;
 }
 
-void Scanner::add_token(TokenType type, std::any literal) {
-    std::string lexeme = src.substr(start, current - start);
-    std::any value = literal.has_value() ? literal : lexeme;
-    tokens.emplace_back(Token(type, lexeme, value, line));
+void Scanner::add_token(TokenType type, Value literal) {
+    tokens.push(type, start, current - start, line, literal);
+    last_type = type;
 }
 
 void Scanner::scan_token() {
@@ -168,31 +214,36 @@ void Scanner::scan_token() {
         case ']': add_token(R_BRACKET); break;
         case '"': handle_string(); break;
         case ',': add_token(COMMA); break;
-        case '+': peek_next() == '+' ? handle_two_char_operator(INC, '+') : add_token(ADD); break;
+        case '+': peek_next() == '+' ? handle_two_char_operator(INC, '+') : peek_next() == '=' ? handle_two_char_operator(ADD_EQ, '=') : add_token(ADD); break;
         // TODO: how to handle whitespace between a negation operator and its operand?
-        case '-': peek_next() == '-' ? handle_two_char_operator(DEC, '-') :
+        case '-': peek_next() == '-' ? handle_two_char_operator(DEC, '-') : peek_next() == '=' ? handle_two_char_operator(SUB_EQ, '=') :
             (isalnum(peek_next()) || peek_next() == '(') ? add_token(NEG) : add_token(SUB); break;
-        case '*': peek_next() == '*' ? handle_two_char_operator(POW, '*') : add_token(MUL); break;
-        case '/':
-            if (peek_next() == '/') {
-                while (peek() != '\n' && !is_at_end())
-                    next();
-                if (peek() == '\n')
-                    line++;
+        case '*':
+            // "**=" is the only three character operator
+            if (peek_next() == '*') {
+                next();
+                peek_next() == '=' ? handle_two_char_operator(POW_EQ, '=') : handle_two_char_operator(POW, '*');
             }
             else
-                add_token(DIV);
+                peek_next() == '=' ? handle_two_char_operator(MUL_EQ, '=') : add_token(MUL);
+            break;
+        case '/':
+            // Comments run to the end of the line, which still ends the statement
+            if (peek_next() == '/')
+                current = Simd::find(src, current, '\n');
+            else
+                peek_next() == '=' ? handle_two_char_operator(DIV_EQ, '=') : add_token(DIV);
             break;
         case ';': add_token(SEMICOLON); break;
-        case '%': add_token(MOD); break;
+        case '%': peek_next() == '=' ? handle_two_char_operator(MOD_EQ, '=') : add_token(MOD); break;
         case '.': peek_next() == '.' ? handle_two_char_operator(RANGE, '.') : add_token(ACCESS); break;
         case '=': peek_next() == '=' ? handle_two_char_operator(EQ, '=') : add_token(ASSIGN); break;
         case '<': peek_next() == '=' ? handle_two_char_operator(LESS_EQ, '=') : peek_next() == '<' ? handle_two_char_operator(LSHFT, '<') : add_token(LESS); break;
         case '>': peek_next() == '=' ? handle_two_char_operator(GREATER_EQ, '=') : peek_next() == '>' ? handle_two_char_operator(RSHFT, '>') : add_token(GREATER); break;
         case '!': peek_next() == '=' ? handle_two_char_operator(NOT_EQ, '=') : add_token(L_NOT); break;
-        case '|': peek_next() == '|' ? handle_two_char_operator(L_OR, '|') : add_token(B_OR); break;
-        case '&': peek_next() == '&' ? handle_two_char_operator(L_AND, '&') : add_token(B_AND); break;
-        case '^': peek_next() == '^' ? handle_two_char_operator(L_XOR, '^') : add_token(B_XOR); break;
+        case '|': peek_next() == '|' ? handle_two_char_operator(L_OR, '|') : peek_next() == '=' ? handle_two_char_operator(B_OR_EQ, '=') : add_token(B_OR); break;
+        case '&': peek_next() == '&' ? handle_two_char_operator(L_AND, '&') : peek_next() == '=' ? handle_two_char_operator(B_AND_EQ, '=') : add_token(B_AND); break;
+        case '^': peek_next() == '^' ? handle_two_char_operator(L_XOR, '^') : peek_next() == '=' ? handle_two_char_operator(B_XOR_EQ, '=') : add_token(B_XOR); break;
         case '~': add_token(B_NOT); break;
         case '?': add_token(T_IF); break;
         case ':': add_token(T_ELSE); break;
@@ -216,14 +267,35 @@ void Scanner::scan_token() {
 }
 
 void Scanner::scan_tokens() {
-    while (!is_at_end()) {
+    while (scan_next());
+}
+
+/* Scans up to and including the next token, so a lazy Scanner
+only runs as far ahead of the Parser as it has to. Returns false
+once the END_TOKEN is in the buffer */
+bool Scanner::scan_next() {
+    if (is_finished)
+        return false;
+    size_t count = tokens.size();
+    // Comments don't add a token, so keep going until something does
+    while (tokens.size() == count) {
+        // Whitespace is skipped in runs rather than a character per scan_token()
+        current = Simd::skip_whitespace(src, current);
+        if (is_at_end()) {
+            // The last statement doesn't need a trailing newline
+            if (last_type != NEWLINE)
+                tokens.push(NEWLINE, src.length(), 0, line);
+            tokens.push(END_TOKEN, src.length(), 0, line);
+            is_finished = true;
+            break;
+        }
         start = current;
         scan_token();
     }
-    tokens.push_back(Token(END_TOKEN, "", NULL, line));
+    return true;
 }
 
 void Scanner::throw_error(std::string message) {
-    Tilda::had_error = true;
+    had_error = true;
     throw std::format("Error on line {}: {}", line, message);
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include <string_view>
+#include <stdint.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define TILDA_X86 1
+#include <immintrin.h>
+#endif
+
+#include "simd.hpp"
+
+namespace {
+
+typedef size_t (*Kernel)(const char* data, size_t index, size_t end);
+
+struct Kernels {
+    Kernel skip_whitespace;
+    Kernel skip_identifier;
+    Kernel skip_digits;
+    size_t (*find)(const char* data, size_t index, size_t end, char c);
+};
+
+inline bool is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\\';
+}
+
+inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline bool is_identifier(char c) {
+    return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+size_t scalar_skip_whitespace(const char* data, size_t index, size_t end) {
+    while (index < end && is_whitespace(data[index]))
+        index++;
+    return index;
+}
+
+size_t scalar_skip_identifier(const char* data, size_t index, size_t end) {
+    while (index < end && is_identifier(data[index]))
+        index++;
+    return index;
+}
+
+size_t scalar_skip_digits(const char* data, size_t index, size_t end) {
+    while (index < end && is_digit(data[index]))
+        index++;
+    return index;
+}
+
+size_t scalar_find(const char* data, size_t index, size_t end, char c) {
+    while (index < end && data[index] != c)
+        index++;
+    return index;
+}
+
+#ifdef TILDA_X86
+/* Each vector version builds a mask of the bytes that belong
+to the run, and stops at the first block where it isn't all
+ones. The last partial block is left to the scalar loop, so
+nothing is ever read past the end of the source */
+
+// x in [lo, hi], as a byte mask (bytes >= 0x80 are negative, so never in an ASCII range)
+inline __m128i sse2_in_range(__m128i x, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(x, _mm_set1_epi8(hi + 1)));
+}
+
+inline __m128i sse2_whitespace(__m128i x) {
+    return _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+        _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))));
+}
+
+inline __m128i sse2_identifier(__m128i x) {
+    // Setting bit 5 folds upper case onto lower case
+    __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+    return _mm_or_si128(
+        _mm_or_si128(sse2_in_range(x, '0', '9'), sse2_in_range(lower, 'a', 'z')),
+        _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+}
+
+template<__m128i (*matches)(__m128i)>
+size_t sse2_skip(const char* data, size_t index, size_t end, Kernel scalar) {
+    for (; index + 16 <= end; index += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+        uint32_t mask = _mm_movemask_epi8(matches(block)) ^ 0xFFFF;
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+    return scalar(data, index, end);
+}
+
+inline __m128i sse2_digit(__m128i x) {
+    return sse2_in_range(x, '0', '9');
+}
+
+size_t sse2_skip_whitespace(const char* data, size_t index, size_t end) {
+    return sse2_skip<sse2_whitespace>(data, index, end, scalar_skip_whitespace);
+}
+
+size_t sse2_skip_identifier(const char* data, size_t index, size_t end) {
+    return sse2_skip<sse2_identifier>(data, index, end, scalar_skip_identifier);
+}
+
+size_t sse2_skip_digits(const char* data, size_t index, size_t end) {
+    return sse2_skip<sse2_digit>(data, index, end, scalar_skip_digits);
+}
+
+size_t sse2_find(const char* data, size_t index, size_t end, char c) {
+    __m128i target = _mm_set1_epi8(c);
+    for (; index + 16 <= end; index += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, target));
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+    return scalar_find(data, index, end, c);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 inline __m256i avx2_in_range(__m256i x, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), x));
+}
+
+AVX2 inline __m256i avx2_whitespace(__m256i x) {
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))));
+}
+
+AVX2 inline __m256i avx2_identifier(__m256i x) {
+    __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(
+        _mm256_or_si256(avx2_in_range(x, '0', '9'), avx2_in_range(lower, 'a', 'z')),
+        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')));
+}
+
+AVX2 inline __m256i avx2_digit(__m256i x) {
+    return avx2_in_range(x, '0', '9');
+}
+
+template<__m256i (*matches)(__m256i)>
+AVX2 size_t avx2_skip(const char* data, size_t index, size_t end, Kernel tail) {
+    for (; index + 32 <= end; index += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+        uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(matches(block)));
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+    return tail(data, index, end);
+}
+
+AVX2 size_t avx2_skip_whitespace(const char* data, size_t index, size_t end) {
+    return avx2_skip<avx2_whitespace>(data, index, end, sse2_skip_whitespace);
+}
+
+AVX2 size_t avx2_skip_identifier(const char* data, size_t index, size_t end) {
+    return avx2_skip<avx2_identifier>(data, index, end, sse2_skip_identifier);
+}
+
+AVX2 size_t avx2_skip_digits(const char* data, size_t index, size_t end) {
+    return avx2_skip<avx2_digit>(data, index, end, sse2_skip_digits);
+}
+
+AVX2 size_t avx2_find(const char* data, size_t index, size_t end, char c) {
+    __m256i target = _mm256_set1_epi8(c);
+    for (; index + 32 <= end; index += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target));
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+    return sse2_find(data, index, end, c);
+}
+
+#undef AVX2
+#endif
+
+const Kernels scalar_kernels = {scalar_skip_whitespace, scalar_skip_identifier, scalar_skip_digits, scalar_find};
+#ifdef TILDA_X86
+const Kernels sse2_kernels = {sse2_skip_whitespace, sse2_skip_identifier, sse2_skip_digits, sse2_find};
+const Kernels avx2_kernels = {avx2_skip_whitespace, avx2_skip_identifier, avx2_skip_digits, avx2_find};
+#endif
+
+const Kernels& kernels_for(SimdLevel level) {
+#ifdef TILDA_X86
+    if (level == SimdLevel::AVX2)
+        return avx2_kernels;
+    if (level == SimdLevel::SSE2)
+        return sse2_kernels;
+#endif
+    return scalar_kernels;
+}
+
+SimdLevel current_level = Simd::detect();
+const Kernels* kernels = &kernels_for(current_level);
+
+}
+
+SimdLevel Simd::detect() {
+#ifdef TILDA_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::SCALAR;
+}
+
+SimdLevel Simd::level() {
+    return current_level;
+}
+
+void Simd::use(SimdLevel level) {
+    if (level > detect())
+        level = detect();
+    current_level = level;
+    kernels = &kernels_for(level);
+}
+
+const char* Simd::name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+size_t Simd::skip_whitespace(std::string_view src, size_t index) {
+    return kernels->skip_whitespace(src.data(), index, src.length());
+}
+
+size_t Simd::skip_identifier(std::string_view src, size_t index) {
+    return kernels->skip_identifier(src.data(), index, src.length());
+}
+
+size_t Simd::skip_digits(std::string_view src, size_t index) {
+    return kernels->skip_digits(src.data(), index, src.length());
+}
+
+size_t Simd::find(std::string_view src, size_t index, char c) {
+    return kernels->find(src.data(), index, src.length(), c);
+}
\ No newline at end of file
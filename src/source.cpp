@@ -0,0 +1,128 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "source.hpp"
+
+Source::~Source() {
+    unmap();
+}
+
+bool Source::load(const std::string& path) {
+    unmap();
+    if (map(path))
+        return true;
+    // Fall back to a plain read, i.e. for pipes and other unmappable files
+    return read(path);
+}
+
+std::string_view Source::text() const {
+    return std::string_view(data, size);
+}
+
+bool Source::mapped() const {
+    return is_mapped;
+}
+
+#ifdef _WIN32
+bool Source::map(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle = file;
+    mapping_handle = mapping;
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(file_size.QuadPart);
+    is_mapped = true;
+    return true;
+}
+
+void Source::unmap() {
+    if (is_mapped) {
+        UnmapViewOfFile(data);
+        CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+    }
+    data = nullptr;
+    size = 0;
+    is_mapped = false;
+    buffer.clear();
+}
+#else
+bool Source::map(const std::string& path) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat file_stat;
+    // Only regular, non-empty files can be mapped
+    if (fstat(file, &file_stat) < 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size == 0) {
+        close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(file);
+    if (view == MAP_FAILED)
+        return false;
+
+    madvise(view, file_stat.st_size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(file_stat.st_size);
+    is_mapped = true;
+    return true;
+}
+
+void Source::unmap() {
+    if (is_mapped)
+        munmap(const_cast<char*>(data), size);
+    data = nullptr;
+    size = 0;
+    is_mapped = false;
+    buffer.clear();
+}
+#endif
+
+bool Source::read(const std::string& path) {
+    std::ifstream fstream(path, std::ios::binary);
+    if (!fstream)
+        return false;
+
+    std::ostringstream stringstream;
+    stringstream << fstream.rdbuf();
+    buffer = stringstream.str();
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+}
\ No newline at end of file
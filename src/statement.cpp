@@ -2,86 +2,93 @@
 #include "statement.hpp"
 #include <any>
 
-ExpressionStatement::ExpressionStatement(ShrExprPtr expression) :
+ExpressionStatement::ExpressionStatement(ExprPtr expression) :
     expression(expression) {}
 
-void ExpressionStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_expression_statement(shared_from_this());
+void ExpressionStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_expression_statement(*this);
 }
 
-PrintStatement::PrintStatement(ShrExprPtr expression) :
+PrintStatement::PrintStatement(ExprPtr expression) :
     expression(expression) {}
 
-void PrintStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_print_statement(shared_from_this());
+void PrintStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_print_statement(*this);
 }
 
-TypeStatement::TypeStatement(ShrExprPtr expression) :
+TypeStatement::TypeStatement(ExprPtr expression) :
     expression(expression) {}
 
-void TypeStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_type_statement(shared_from_this());
+void TypeStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_type_statement(*this);
 }
 
-BlockStatement::BlockStatement(std::vector<ShrStmtPtr> statements) :
+BlockStatement::BlockStatement(std::vector<StmtPtr> statements) :
     statements(statements) {}
 
-void BlockStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_block_statement(shared_from_this());
+void BlockStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_block_statement(*this);
 }
 
-DeclareStatement::DeclareStatement(Token identifier, LiteralType literal_type, ShrExprPtr expression) :
-    identifier(identifier), literal_type(literal_type), expression(expression) {}
+DeclareStatement::DeclareStatement(Token identifier, LiteralType literal_type, ExprPtr expression, bool is_const) :
+    identifier(identifier), literal_type(literal_type), expression(expression), is_const(is_const) {}
 
-void DeclareStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_declare_statement(shared_from_this());
+void DeclareStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_declare_statement(*this);
 }
 
-IfStatement::IfStatement(ShrExprPtr expression, ShrStmtPtr then_branch, ShrStmtPtr else_branch) :
+IfStatement::IfStatement(ExprPtr expression, StmtPtr then_branch, StmtPtr else_branch) :
     expression(expression), then_branch(then_branch), else_branch(else_branch) {}
 
-void IfStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_if_statement(shared_from_this());
+void IfStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_if_statement(*this);
 }
 
-WhileStatement::WhileStatement(ShrExprPtr expression, ShrStmtPtr statements) :
+WhileStatement::WhileStatement(ExprPtr expression, StmtPtr statements) :
     expression(expression), statements(statements) {}
 
-void WhileStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_while_statement(shared_from_this());
+void WhileStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_while_statement(*this);
 }
 
-ForStatement::ForStatement(ShrExprPtr expression) :
+ForStatement::ForStatement(ExprPtr expression) :
     expression(expression) {}
 
-void ForStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_for_statement(shared_from_this());
+void ForStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_for_statement(*this);
 }
 
-ForInStatement::ForInStatement(ShrExprPtr expression) :
+ForInStatement::ForInStatement(ExprPtr expression) :
     expression(expression) {}
 
-void ForInStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_forin_statement(shared_from_this());
+void ForInStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_forin_statement(*this);
 }
 
-SwitchStatement::SwitchStatement(ShrExprPtr expression) :
+SwitchStatement::SwitchStatement(ExprPtr expression) :
     expression(expression) {}
 
-void SwitchStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_switch_statement(shared_from_this());
+void SwitchStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_switch_statement(*this);
 }
 
-ReturnStatement::ReturnStatement(ShrExprPtr expression) :
+ReturnStatement::ReturnStatement(ExprPtr expression) :
     expression(expression) {}
 
-void ReturnStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_return_statement(shared_from_this());
+void ReturnStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_return_statement(*this);
 }
 
-StructStatement::StructStatement(ShrExprPtr expression) :
+StructStatement::StructStatement(ExprPtr expression) :
     expression(expression) {}
 
-void StructStatement::accept(StatementVisitor& visitor) {
-    return visitor.visit_struct_statement(shared_from_this());
+void StructStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_struct_statement(*this);
+}
+
+FunctionStatement::FunctionStatement(Token identifier, std::vector<Parameter> parameters, LiteralType return_type, size_t body_start) :
+    identifier(identifier), parameters(parameters), return_type(return_type), body_start(body_start) {}
+
+void FunctionStatement::accept(StatementVisitor& visitor) const {
+    return visitor.visit_function_statement(*this);
 }
@@ -1,86 +1,89 @@
-#include <iostream>
-#include <map>
+#include <algorithm>
 
 #include "token.hpp"
 
-Token::Token(TokenType type, std::string lexeme, std::any literal, int line) :
-    type(type), lexeme(lexeme), literal(literal), line(line) {}
+Token::Token(TokenType type, std::string_view lexeme, Value literal, int line) :
+    type(type), literal(literal), lexeme(lexeme), line(line) {}
 
-std::map<TokenType, std::string> Token::token_type_names = {
-    // Syntax
-    {L_PAREN, "("},
-    {R_PAREN, ")"},
-    {L_BRACE, "{"},
-    {R_BRACE, "}"},
-    {L_BRACKET, "["},
-    {R_BRACKET, "]"},
-    {COMMA, ","},
-    {ASSIGN, "="},
-    {RANGE, ".."},
-    {ACCESS, "."},
-    {COMMENT, "//"},
-    {SEMICOLON, ";"},
-    // Keywords
-    {IF, "if"},
-    {ELIF, "elif"},
-    {ELSE, "else"},
-    {WHILE, "while"},
-    {FOR, "for"},
-    {IN, "in"},
-    {SWITCH, "switch"},
-    {RETURN, "return"},
-    {TRUE, "true"},
-    {FALSE, "false"},
-    {LET, "let"},
-    {CONST, "const"},
-    {STRUCT, "struct"},
-    {FN, "fn"},
-    // Values
-    {IDENTIFIER, "identifier"},
-    {TYPE, "type"},
-    {STR, "string"},
-    {NUM, "number"},
-    // Math Operators
-    {ADD, "+"},
-    {SUB, "-"},
-    {MUL, "*"},
-    {DIV, "/"},
-    {POW, "**"},
-    {NEG, "-"},
-    {MOD, "%"},
-    {ADD_EQ, "+="},
-    {SUB_EQ, "-="},
-    {MUL_EQ, "*="},
-    {DIV_EQ, "/="},
-    {POW_EQ, "**="},
-    {INC, "++"},
-    {DEC, "--"},
-    // Logical Operators
-    {LESS, "<"},
-    {GREATER, ">"},
-    {LESS_EQ, "<="},
-    {GREATER_EQ, ">="},
-    {NOT_EQ, "!="},
-    {EQ, "=="},
-    {L_OR, "||"},
-    {L_AND, "&&"},
-    {L_XOR, "^^"},
-    {L_NOT, "!"},
-    // Ternary Logical Operators
-    {TERN, "?:"},
-    {T_IF, "?"},
-    {T_ELSE, ":"},
-    // Bitwise Operators
-    {B_OR, "|"},
-    {B_AND, "&"},
-    {B_XOR, "^"},
-    {B_NOT, "~"},
-    {LSHFT, "<<"},
-    {RSHFT, ">>"},
-    {CHK, "@"},
-    // Built-in Functions
-    {PRINT, "print"},
-    {TYPEOF, "type"},
-    // End-of-file
-    {END_TOKEN, "eof"}
-};
\ No newline at end of file
+TokenBuffer::TokenBuffer(std::string_view src) :
+    src(src) {}
+
+void TokenBuffer::push(TokenType type, uint32_t offset, uint32_t length, int line) {
+    if (lines.empty() || lines.back().line != line)
+        lines.push_back({static_cast<uint32_t>(types.size()), line});
+    types.push_back(static_cast<uint8_t>(type));
+    offsets.push_back(offset);
+    lengths.push_back(length);
+}
+
+void TokenBuffer::push(TokenType type, uint32_t offset, uint32_t length, int line, Value literal) {
+    literal_indices.push_back(types.size());
+    literals.push_back(std::move(literal));
+    push(type, offset, length, line);
+}
+
+size_t TokenBuffer::size() const {
+    return types.size();
+}
+
+TokenType TokenBuffer::type(size_t index) const {
+    return static_cast<TokenType>(types[index]);
+}
+
+std::string_view TokenBuffer::lexeme(size_t index) const {
+    // The NEWLINE the Scanner adds after the last statement isn't in the source
+    if (types[index] == NEWLINE && lengths[index] == 0)
+        return "\n";
+    return src.substr(offsets[index], lengths[index]);
+}
+
+Value TokenBuffer::literal(size_t index) const {
+    switch (types[index]) {
+        case NUM: case STR: case TRUE: case FALSE: break;
+        default: return Value();
+    }
+    auto found = std::lower_bound(literal_indices.begin(), literal_indices.end(), index);
+    if (found == literal_indices.end() || *found != index)
+        return Value();
+    return literals[found - literal_indices.begin()];
+}
+
+int TokenBuffer::line(size_t index) const {
+    auto run = std::upper_bound(lines.begin(), lines.end(), index,
+        [](size_t index, const LineRun& run) { return index < run.first_token; });
+    return (run - 1)->line;
+}
+
+Token TokenBuffer::get(size_t index) const {
+    return Token(type(index), lexeme(index), literal(index), line(index));
+}
+
+void TokenBuffer::discard_before(size_t index) {
+    if (index == 0)
+        return;
+    types.erase(types.begin(), types.begin() + index);
+    offsets.erase(offsets.begin(), offsets.begin() + index);
+    lengths.erase(lengths.begin(), lengths.begin() + index);
+
+    auto first_kept = std::lower_bound(literal_indices.begin(), literal_indices.end(), index);
+    literals.erase(literals.begin(), literals.begin() + (first_kept - literal_indices.begin()));
+    literal_indices.erase(literal_indices.begin(), first_kept);
+    for (uint32_t& literal_index : literal_indices)
+        literal_index -= index;
+
+    // The run index falls in becomes the first one, even if none of its tokens are left
+    auto run = std::upper_bound(lines.begin(), lines.end(), index,
+        [](size_t index, const LineRun& run) { return index < run.first_token; });
+    lines.erase(lines.begin(), run - 1);
+    for (LineRun& line_run : lines)
+        line_run.first_token = line_run.first_token > index ? line_run.first_token - index : 0;
+}
+
+size_t TokenBuffer::bytes() const {
+    return types.capacity() * sizeof(uint8_t)
+        + offsets.capacity() * sizeof(uint32_t)
+        + lengths.capacity() * sizeof(uint32_t)
+        + literal_indices.capacity() * sizeof(uint32_t)
+        + literals.capacity() * sizeof(Value)
+        + lines.capacity() * sizeof(LineRun);
+}
\ No newline at end of file
@@ -1,8 +1,364 @@
+#include <format>
+#include <string>
 #include <vector>
+#include <any>
+#include <map>
 
 #include "typechecker.hpp"
+#include "expression.hpp"
 #include "statement.hpp"
+#include "tilda.hpp"
+#include "token.hpp"
 
-Typechecker::Typechecker(std::vector<ShrStmtPtr> statements) {
+void Typechecker::check(std::span<const StmtPtr> statements) {
+    // Drop any scopes left open by a previous check() that threw
+    scopes.resize(1);
+    function = nullptr;
+    for (StmtPtr statement : statements)
+        check(statement);
+}
+
+/* Called by the Interpreter on the function's first call, after the
+Resolver. The Interpreter checks typed parameters' arguments on every
+call, so they're known to have their type */
+void Typechecker::check_body(const FunctionStatement& function) {
+    scopes.resize(1);
+    this->function = &function;
+    begin_scope();
+    for (const Parameter& parameter : function.parameters)
+        scopes.back().insert({std::string(parameter.identifier.lexeme), {runtime_type(parameter.type), true}});
+    for (StmtPtr statement : function.body)
+        check(statement);
+    end_scope();
+    this->function = nullptr;
+}
+
+void Typechecker::forget_initializers() {
+    for (auto& [name, variable] : scopes[0])
+        variable.is_initialized = false;
+}
+
+LiteralType Typechecker::runtime_type(LiteralType type) {
+    return type == LiteralType::INT ? LiteralType::I64 : type;
+}
+
+// Same names as Interpreter::get_type
+std::string Typechecker::type_name(LiteralType type) {
+    if (type == LiteralType::VOID)
+        return "unknown";
+    return std::string(literal_type_names[static_cast<int>(type)]);
+}
+
+LiteralType Typechecker::check(ExprPtr expression) {
+    expression->static_type = std::any_cast<LiteralType>(expression->accept(*this));
+    return expression->static_type;
+}
+
+void Typechecker::check(StmtPtr statement) {
+    statement->accept(*this);
+}
+
+void Typechecker::begin_scope() {
+    scopes.push_back({});
+}
+
+void Typechecker::end_scope() {
+    scopes.pop_back();
+}
+
+// nullptr if the declaration never got checked, i.e. it was on a REPL line with a type error
+Typechecker::Variable* Typechecker::find_variable(std::string_view name) {
+    for (int i = scopes.size() - 1; i >= 0; i--) {
+        auto found = scopes[i].find(name);
+        if (found != scopes[i].end())
+            return &found->second;
+    }
+    return nullptr;
+}
+
+/* Whether expression is made of nothing but number literals, which
+can be any width, so the literals can be given type (see adapt) */
+bool Typechecker::is_adaptable(ExprPtr expression, LiteralType type) {
+    LiteralType from = expression->static_type;
+    if (from == LiteralType::I64 ? !is_integer_type(type) : from != LiteralType::F64 || !is_float_type(type))
+        return false;
+    if (dynamic_cast<LiteralExpression*>(expression))
+        return true;
+    if (GroupExpression* group = dynamic_cast<GroupExpression*>(expression))
+        return is_adaptable(group->expression, type);
+    if (UnaryExpression* unary = dynamic_cast<UnaryExpression*>(expression))
+        return unary->type != L_NOT && is_adaptable(unary->operand, type);
+    // Not comparisons, their operands' type isn't theirs
+    if (BinaryExpression* binary = dynamic_cast<BinaryExpression*>(expression))
+        return binary_type(binary->type, from) == from && is_adaptable(binary->l_operand, type) && is_adaptable(binary->r_operand, type);
+    if (BitwiseExpression* bitwise = dynamic_cast<BitwiseExpression*>(expression))
+        return is_adaptable(bitwise->l_operand, type) && is_adaptable(bitwise->r_operand, type);
+    return false;
+}
+
+// Literals are i64 or f64 unless they're used as another width, i.e. the 1 in "x + 1" for a u8 x
+void Typechecker::adapt(ExprPtr expression, LiteralType type) {
+    expression->static_type = type;
+    if (LiteralExpression* literal = dynamic_cast<LiteralExpression*>(expression))
+        literal->value = is_integer_type(type) ? Value::of_integer(type, literal->value.integer) : Value::of_float(type, literal->value.floating);
+    else if (GroupExpression* group = dynamic_cast<GroupExpression*>(expression))
+        adapt(group->expression, type);
+    else if (UnaryExpression* unary = dynamic_cast<UnaryExpression*>(expression))
+        adapt(unary->operand, type);
+    else if (BinaryExpression* binary = dynamic_cast<BinaryExpression*>(expression)) {
+        adapt(binary->l_operand, type);
+        adapt(binary->r_operand, type);
+    }
+    else if (BitwiseExpression* bitwise = dynamic_cast<BitwiseExpression*>(expression)) {
+        adapt(bitwise->l_operand, type);
+        adapt(bitwise->r_operand, type);
+    }
+}
+
+// Adapts whichever of the two operands is made of literals to the other one's type
+void Typechecker::adapt_operands(ExprPtr l_operand, ExprPtr r_operand) {
+    if (l_operand->static_type == LiteralType::VOID || r_operand->static_type == LiteralType::VOID
+        || l_operand->static_type == r_operand->static_type)
+        return;
+    if (is_adaptable(r_operand, l_operand->static_type))
+        adapt(r_operand, l_operand->static_type);
+    else if (is_adaptable(l_operand, r_operand->static_type))
+        adapt(l_operand, r_operand->static_type);
+}
+
+void Typechecker::check_store(LiteralType type, ExprPtr expression, Token identifier, LiteralType& checked_type) {
+    checked_type = LiteralType::VOID;
+    if (type == LiteralType::VOID)
+        return;
+    if (is_adaptable(expression, type))
+        adapt(expression, type);
+    LiteralType value_type = expression->static_type;
+    if (value_type == LiteralType::VOID)
+        checked_type = type;
+    else if (value_type != type)
+        throw_error(std::format("Cannot store {} value in \"{}\" of type {}.", type_name(value_type), identifier.lexeme, type_name(type)));
+}
+
+/* The type of a binary operator's result when both operands have
+operand_type, mirroring Interpreter::apply_binary. VOID if it raises
+an error */
+LiteralType Typechecker::binary_type(TokenType type, LiteralType operand_type) {
+    switch (type) {
+        case GREATER: case GREATER_EQ: case LESS: case LESS_EQ:
+            return is_integer_type(operand_type) || is_float_type(operand_type) ? LiteralType::BOOL : LiteralType::VOID;
+        case EQ: case NOT_EQ:
+            return LiteralType::BOOL;
+        case ADD:
+            if (operand_type == LiteralType::STR)
+                return LiteralType::STR;
+            [[fallthrough]];
+        default:
+            return is_integer_type(operand_type) || is_float_type(operand_type) ? operand_type : LiteralType::VOID;
+    }
+}
+
+void Typechecker::throw_error(std::string message) {
+    Tilda::had_error = true;
+    throw std::format("Type Error: {}", message);
+}
+
+std::any Typechecker::visit_unary_expression(const UnaryExpression& expression) {
+    LiteralType operand = check(expression.operand);
+    // Anything has a truthiness
+    if (expression.type == L_NOT)
+        return LiteralType::BOOL;
+    if (expression.type == B_NOT) {
+        if (operand != LiteralType::VOID && !is_integer_type(operand))
+            throw_error("Operand of \"~\" must be an integer.");
+        return operand;
+    }
+    if (operand != LiteralType::VOID && !is_integer_type(operand) && !is_float_type(operand))
+        throw_error(std::format("Operand of \"{}\" must be a number.", Token::token_type_names[expression.type]));
+    return operand;
+}
+
+std::any Typechecker::visit_binary_expression(const BinaryExpression& expression) {
+    check(expression.l_operand);
+    check(expression.r_operand);
+    adapt_operands(expression.l_operand, expression.r_operand);
+    LiteralType l_operand = expression.l_operand->static_type;
+    LiteralType r_operand = expression.r_operand->static_type;
+    if (l_operand == LiteralType::VOID || r_operand == LiteralType::VOID) {
+        // The operands have to end up the same type, or it's a runtime error
+        LiteralType known = l_operand == LiteralType::VOID ? r_operand : l_operand;
+        if (known == LiteralType::VOID)
+            return binary_type(expression.type, LiteralType::I64) == LiteralType::BOOL ? LiteralType::BOOL : LiteralType::VOID;
+        return binary_type(expression.type, known);
+    }
+    if (l_operand != r_operand)
+        throw_error(std::format("Cannot perform \"{}\" on {} and {}.",
+            Token::token_type_names[expression.type], type_name(l_operand), type_name(r_operand)));
+    LiteralType type = binary_type(expression.type, l_operand);
+    if (type == LiteralType::VOID)
+        throw_error(std::format("Operands of \"{}\" must be numbers.", Token::token_type_names[expression.type]));
+    return type;
+}
+
+std::any Typechecker::visit_ternary_expression(const TernaryExpression& expression) {
+    check(expression.condition);
+    LiteralType l_operand = check(expression.l_operand);
+    LiteralType r_operand = check(expression.r_operand);
+    return l_operand == r_operand ? l_operand : LiteralType::VOID;
+}
+
+std::any Typechecker::visit_literal_expression(const LiteralExpression& expression) {
+    return expression.value.type;
+}
+
+std::any Typechecker::visit_group_expression(const GroupExpression& expression) {
+    return check(expression.expression);
+}
+
+std::any Typechecker::visit_variable_expression(const VariableExpression& expression) {
+    Variable* variable = find_variable(expression.identifier.lexeme);
+    return variable && variable->is_initialized ? variable->type : LiteralType::VOID;
+}
+
+std::any Typechecker::visit_assign_expression(const AssignExpression& expression) {
+    LiteralType value = check(expression.expression);
+    Variable* variable = find_variable(expression.identifier.lexeme);
+    if (!variable || variable->type == LiteralType::VOID) {
+        expression.checked_type = LiteralType::VOID;
+        return value;
+    }
+    check_store(variable->type, expression.expression, expression.identifier, expression.checked_type);
+    return variable->type;
+}
+
+std::any Typechecker::visit_range_expression(const RangeExpression& expression) {
+    check(expression.l_operand);
+    check(expression.r_operand);
+    return LiteralType::VOID;
+}
+
+std::any Typechecker::visit_access_expression(const AccessExpression& expression) {
+    check(expression.l_operand);
+    return LiteralType::VOID;
+}
+
+// The Resolver has already matched the call to its function
+std::any Typechecker::visit_call_expression(const CallExpression& expression) {
+    const std::vector<Parameter>& parameters = expression.function->parameters;
+    for (size_t i = 0; i < expression.arguments.size(); i++) {
+        check(expression.arguments[i]);
+        LiteralType parameter = runtime_type(parameters[i].type);
+        if (parameter != LiteralType::VOID && is_adaptable(expression.arguments[i], parameter))
+            adapt(expression.arguments[i], parameter);
+        LiteralType argument = expression.arguments[i]->static_type;
+        if (argument != LiteralType::VOID && parameter != LiteralType::VOID && argument != parameter)
+            throw_error(std::format("\"{}\" expects {} for \"{}\" but got {}.", expression.function_name.lexeme,
+                type_name(parameter), parameters[i].identifier.lexeme, type_name(argument)));
+    }
+    // Return values aren't checked at runtime
+    return LiteralType::VOID;
+}
+
+std::any Typechecker::visit_logical_expression(const LogicalExpression& expression) {
+    check(expression.l_operand);
+    check(expression.r_operand);
+    return LiteralType::BOOL;
+}
+
+std::any Typechecker::visit_bitwise_expression(const BitwiseExpression& expression) {
+    check(expression.l_operand);
+    check(expression.r_operand);
+    adapt_operands(expression.l_operand, expression.r_operand);
+    LiteralType l_operand = expression.l_operand->static_type;
+    LiteralType r_operand = expression.r_operand->static_type;
+    if ((l_operand != LiteralType::VOID && !is_integer_type(l_operand))
+        || (r_operand != LiteralType::VOID && !is_integer_type(r_operand)))
+        throw_error("Can only perform bitwise operations on integer types.");
+    if (l_operand != LiteralType::VOID && r_operand != LiteralType::VOID && l_operand != r_operand)
+        throw_error(std::format("Cannot perform \"{}\" on {} and {}.",
+            Token::token_type_names[expression.type], type_name(l_operand), type_name(r_operand)));
+    return l_operand == LiteralType::VOID ? r_operand : l_operand;
+}
+
+void Typechecker::visit_expression_statement(const ExpressionStatement& statement) {
+    check(statement.expression);
+}
+
+void Typechecker::visit_print_statement(const PrintStatement& statement) {
+    check(statement.expression);
+}
+
+void Typechecker::visit_type_statement(const TypeStatement& statement) {
+    check(statement.expression);
+}
+
+void Typechecker::visit_block_statement(const BlockStatement& statement) {
+    begin_scope();
+    for (StmtPtr block_statement : statement.statements)
+        check(block_statement);
+    end_scope();
+}
+
+void Typechecker::visit_declare_statement(const DeclareStatement& statement) {
+    LiteralType value = statement.expression ? check(statement.expression) : LiteralType::VOID;
+    std::map<std::string, Variable, std::less<>>& scope = scopes.back();
+    statement.checked_type = LiteralType::VOID;
+
+    // A redeclaration in the same scope keeps the original value, and so its type
+    if (statement.is_redeclaration) {
+        if (!scope.contains(statement.identifier.lexeme))
+            scope.insert({std::string(statement.identifier.lexeme), {LiteralType::VOID, false}});
+        return;
+    }
+
+    LiteralType type = runtime_type(statement.literal_type);
+    if (type == LiteralType::VOID)
+        type = value;
+    else if (statement.expression)
+        check_store(type, statement.expression, statement.identifier, statement.checked_type);
+    scope.insert_or_assign(std::string(statement.identifier.lexeme), Variable{type, statement.expression != nullptr});
+}
+
+void Typechecker::visit_if_statement(const IfStatement& statement) {
+    check(statement.expression);
+    check(statement.then_branch);
+    if (statement.else_branch)
+        check(statement.else_branch);
+}
+
+void Typechecker::visit_while_statement(const WhileStatement& statement) {
+    check(statement.expression);
+    check(statement.statements);
+}
+
+void Typechecker::visit_for_statement(const ForStatement& statement) {
+    ;
+}
+
+void Typechecker::visit_forin_statement(const ForInStatement& statement) {
+    ;
+}
+
+void Typechecker::visit_switch_statement(const SwitchStatement& statement) {
+    ;
+}
+
+void Typechecker::visit_return_statement(const ReturnStatement& statement) {
+    if (!statement.expression)
+        return;
+    check(statement.expression);
+    LiteralType type = function ? runtime_type(function->return_type) : LiteralType::VOID;
+    if (type != LiteralType::VOID && is_adaptable(statement.expression, type))
+        adapt(statement.expression, type);
+    LiteralType value = statement.expression->static_type;
+    if (value != LiteralType::VOID && type != LiteralType::VOID && value != type)
+        throw_error(std::format("\"{}\" returns {}, not {}.", function->identifier.lexeme, type_name(type), type_name(value)));
+}
+
+void Typechecker::visit_struct_statement(const StructStatement& statement) {
+    ;
+}
+
+// Bodies are checked on the function's first call, same as they're resolved
+void Typechecker::visit_function_statement(const FunctionStatement& statement) {
     ;
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <stdint.h>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "interpreter.hpp"
+#include "bytecode.hpp"
+#include "token.hpp"
+#include "tilda.hpp"
+#include "value.hpp"
+#include "vm.hpp"
+
+void VM::push(Value value) {
+    stack.push_back(std::move(value));
+}
+
+Value VM::pop() {
+    Value value = std::move(stack.back());
+    stack.pop_back();
+    return value;
+}
+
+Value& VM::peek() {
+    return stack.back();
+}
+
+void VM::throw_error(std::string message) {
+    Tilda::had_runtime_error = true;
+    throw message;
+}
+
+void VM::run(const Chunk& chunk) {
+    const uint8_t* ip = chunk.code.data();
+    stack.clear();
+    if (globals.size() < chunk.global_names.size())
+        globals.resize(chunk.global_names.size());
+
+    #define READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+    #define UNARY_OP(type) peek() = Interpreter::apply_unary(type, peek())
+    #define BINARY_OP(apply, type) { \
+        Value r_operand = pop(); \
+        peek() = Interpreter::apply(type, peek(), r_operand); \
+    }
+    // No type checks, the Typechecker proved both operands are i64
+    #define INT_OP(op) { \
+        int64_t r_operand = pop().integer; \
+        peek() = peek().integer op r_operand; \
+    }
+    // Same, for arithmetic, which wraps around through Value's helpers
+    #define WRAPPING_OP(wrapping) { \
+        int64_t r_operand = pop().integer; \
+        peek() = Value::wrapping(peek().integer, r_operand); \
+    }
+
+    while (true) {
+        switch (*ip++) {
+            case OP_CONSTANT: push(chunk.constants[READ_SHORT()]); break;
+            case OP_VOID: push(Value()); break;
+            case OP_POP: stack.pop_back(); break;
+            case OP_DEFINE_GLOBAL: {
+                Global& global = globals[READ_SHORT()];
+                // Same as Environment::define, a redefinition keeps the original value
+                if (!global.is_defined) {
+                    global.value = peek();
+                    global.is_defined = true;
+                }
+                stack.pop_back();
+                break;
+            }
+            case OP_GET_GLOBAL: {
+                uint16_t slot = READ_SHORT();
+                if (!globals[slot].is_defined)
+                    throw_error(std::format("Undefined variable: \"{}\".", chunk.global_names[slot]));
+                push(globals[slot].value);
+                break;
+            }
+            case OP_SET_GLOBAL: {
+                uint16_t slot = READ_SHORT();
+                if (!globals[slot].is_defined)
+                    throw_error(std::format("Undefined variable: \"{}\".", chunk.global_names[slot]));
+                globals[slot].value = peek();
+                break;
+            }
+            case OP_GET_LOCAL: push(stack[READ_SHORT()]); break;
+            case OP_SET_LOCAL: stack[READ_SHORT()] = peek(); break;
+            case OP_CHECK_TYPE: Interpreter::check_type(static_cast<LiteralType>(READ_SHORT()), peek()); break;
+            case OP_ADD: BINARY_OP(apply_binary, ADD); break;
+            case OP_SUB: BINARY_OP(apply_binary, SUB); break;
+            case OP_MUL: BINARY_OP(apply_binary, MUL); break;
+            case OP_DIV: BINARY_OP(apply_binary, DIV); break;
+            case OP_POW: BINARY_OP(apply_binary, POW); break;
+            case OP_MOD: BINARY_OP(apply_binary, MOD); break;
+            case OP_NEG: UNARY_OP(NEG); break;
+            case OP_INC: UNARY_OP(INC); break;
+            case OP_DEC: UNARY_OP(DEC); break;
+            case OP_LESS: BINARY_OP(apply_binary, LESS); break;
+            case OP_GREATER: BINARY_OP(apply_binary, GREATER); break;
+            case OP_LESS_EQ: BINARY_OP(apply_binary, LESS_EQ); break;
+            case OP_GREATER_EQ: BINARY_OP(apply_binary, GREATER_EQ); break;
+            case OP_NOT_EQ: BINARY_OP(apply_binary, NOT_EQ); break;
+            case OP_EQ: BINARY_OP(apply_binary, EQ); break;
+            case OP_L_OR: BINARY_OP(apply_logical, L_OR); break;
+            case OP_L_AND: BINARY_OP(apply_logical, L_AND); break;
+            case OP_L_XOR: BINARY_OP(apply_logical, L_XOR); break;
+            case OP_L_NOT: UNARY_OP(L_NOT); break;
+            case OP_B_OR: BINARY_OP(apply_bitwise, B_OR); break;
+            case OP_B_AND: BINARY_OP(apply_bitwise, B_AND); break;
+            case OP_B_XOR: BINARY_OP(apply_bitwise, B_XOR); break;
+            case OP_B_NOT: UNARY_OP(B_NOT); break;
+            case OP_LSHFT: BINARY_OP(apply_bitwise, LSHFT); break;
+            case OP_RSHFT: BINARY_OP(apply_bitwise, RSHFT); break;
+            case OP_CHK: BINARY_OP(apply_bitwise, CHK); break;
+            case OP_ADD_INT: WRAPPING_OP(wrapping_add); break;
+            case OP_SUB_INT: WRAPPING_OP(wrapping_sub); break;
+            case OP_MUL_INT: WRAPPING_OP(wrapping_mul); break;
+            case OP_LESS_INT: INT_OP(<); break;
+            case OP_GREATER_INT: INT_OP(>); break;
+            case OP_LESS_EQ_INT: INT_OP(<=); break;
+            case OP_GREATER_EQ_INT: INT_OP(>=); break;
+            case OP_NOT_EQ_INT: INT_OP(!=); break;
+            case OP_EQ_INT: INT_OP(==); break;
+            case OP_JUMP: {
+                uint16_t offset = READ_SHORT();
+                ip += offset;
+                break;
+            }
+            case OP_JUMP_IF_FALSE: {
+                uint16_t offset = READ_SHORT();
+                if (!Interpreter::get_truthiness(pop()))
+                    ip += offset;
+                break;
+            }
+            case OP_LOOP: {
+                uint16_t offset = READ_SHORT();
+                ip -= offset;
+                break;
+            }
+            case OP_PRINT:
+                std::cout << Interpreter::to_string(pop()) << std::endl;
+                break;
+            case OP_TYPEOF:
+                std::cout << std::format("Type: {}", Interpreter::get_type(pop())) << std::endl;
+                break;
+            case OP_RETURN:
+                return;
+        }
+    }
+
+    #undef READ_SHORT
+    #undef UNARY_OP
+    #undef BINARY_OP
+    #undef INT_OP
+    #undef WRAPPING_OP
+}
\ No newline at end of file
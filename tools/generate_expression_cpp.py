@@ -1,8 +1,8 @@
 import re
 
-type_names = ['TokenType', 'Token', 'LiteralType', 'const', 'std::any', '=', 'ShrExprPtr', 'std::vector<ShrExprPtr>', 'bool']
+type_names = ['TokenType', 'Token', 'LiteralType', 'const', 'std::any', 'Value', '=', 'ExprPtr', 'std::vector<ExprPtr>', 'bool']
 
-expr_type_pattern = re.compile(r'struct (?P<type>[A-Za-z0-9]+) : Expression, public std::enable_shared_from_this<[A-Za-z]+> {')
+expr_type_pattern = re.compile(r'struct (?P<type>[A-Za-z0-9]+) : Expression {')
 expr_constructor_pattern = r'\((?P<args>[\w,\*;:<>_ ]+)\);'
 
 def generate_expr_dict() -> dict[str: str]:
@@ -11,7 +11,7 @@ def generate_expr_dict() -> dict[str: str]:
     with open('include\\expression.hpp', 'r') as header_file:
         for line in header_file:
             if 'struct' in line and 'ExpressionVisitor' not in line \
-                and line.count('Expression') > 2:
+                and line.count('Expression') >= 2:
                     expr_type = expr_type_pattern.search(line).group('type')
                     continue
             if expr_type and expr_type in line and '//' not in line:
@@ -38,8 +38,12 @@ def write_expression_cpp(expr_types: dict) -> None:
 {expr_type}::{expr_type}({expr_args}) :
     {param_assignments}
 
-std::any {expr_type}::accept(ExpressionVisitor<std::any>& visitor) {{
-    return visitor.visit_{expr_type_name}_expression(shared_from_this());
+std::any {expr_type}::accept(ExpressionVisitor<std::any>& visitor) const {{
+    return visitor.visit_{expr_type_name}_expression(*this);
+}}
+
+Value {expr_type}::accept(ExpressionVisitor<Value>& visitor) const {{
+    return visitor.visit_{expr_type_name}_expression(*this);
 }}
 ''')
             
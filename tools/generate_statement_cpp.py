@@ -1,8 +1,8 @@
 import re
 
-type_names = ['TokenType', 'Token', 'LiteralType', 'const', 'std::any', '=', 'ShrStmtPtr', 'ShrExprPtr', 'std::vector<ShrStmtPtr>', 'bool']
+type_names = ['TokenType', 'Token', 'LiteralType', 'const', 'std::any', '=', 'StmtPtr', 'ExprPtr', 'std::vector<StmtPtr>', 'std::vector<Parameter>', 'size_t', 'bool']
 
-stmt_type_pattern = re.compile(r'struct (?P<type>[A-Za-z0-9]+) : Statement, public std::enable_shared_from_this<[A-Za-z]+> {')
+stmt_type_pattern = re.compile(r'struct (?P<type>[A-Za-z0-9]+) : Statement {')
 stmt_constructor_pattern = r'\((?P<args>[\w,\*;:<>_ ]+)\);'
 
 def generate_stmt_dict() -> dict[str: str]:
@@ -11,7 +11,7 @@ def generate_stmt_dict() -> dict[str: str]:
     with open('include\\statement.hpp', 'r') as header_file:
         for line in header_file:
             if 'struct' in line and 'StatementVisitor' not in line \
-                and line.count('Statement') > 2:
+                and line.count('Statement') >= 2:
                     stmt_type = stmt_type_pattern.search(line).group('type')
                     continue
             if stmt_type and stmt_type in line and '//' not in line:
@@ -38,8 +38,8 @@ def write_statement_cpp(stmt_types: dict) -> None:
 {stmt_type}::{stmt_type}({stmt_args}) :
     {param_assignments}
 
-void {stmt_type}::accept(StatementVisitor& visitor) {{
-    return visitor.visit_{stmt_type_name}_statement(shared_from_this());
+void {stmt_type}::accept(StatementVisitor& visitor) const {{
+    return visitor.visit_{stmt_type_name}_statement(*this);
 }}
 ''')
             